@@ -0,0 +1,3 @@
+#!/bin/bash
+bash build.sh
+./build/CollisionBench "$@"
\ No newline at end of file
@@ -0,0 +1,446 @@
+// Headless timings of the collision and physics code, no window or Vulkan. Every scene is generated
+// from a fixed seed so two runs on different commits time exactly the same work, the results are
+// written as JSON to diff between commits.
+//
+// CollisionBench [-o results.json] [-n 1000,10000,100000] [-s steps] [-t workers] [--seed n]
+//
+// -o - writes the JSON to stdout, progress always goes to stderr. -t is the number of worker threads
+// next to the main one, at least 1; without it there is one per hardware thread.
+
+#include "../src/collision/broad_phase.h"
+#include "../src/collision/mesh_bvh.h"
+#include "../src/collision/narrow_phase.h"
+#include "../src/collision/spatial_hash.h"
+#include "../src/collision/voxel_world.h"
+#include "../src/core/job_system.h"
+#include "../src/physics/physics_world.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+const float    STEP_DT       = 1.0f / 60.0f;
+const uint32_t RAYS_PER_STEP = 10000;
+const uint32_t RAYS_PER_JOB  = 256;
+const uint32_t QUERY_COUNT   = 10000;
+const uint32_t STACK_HEIGHT  = 10;
+
+// xorshift, std distributions differ between standard libraries and the scenes have to match everywhere
+struct Random {
+    uint64_t state;
+
+    uint32_t next() {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return (uint32_t)(state >> 32);
+    }
+    float range(float min, float max) { return min + (max - min) * (next() >> 8) * (1.0f / 16777216.0f); }
+    glm::vec3 range(glm::vec3 min, glm::vec3 max) { return glm::vec3(range(min.x, max.x), range(min.y, max.y), range(min.z, max.z)); }
+    glm::vec3 direction() {
+        glm::vec3 d;
+        do {
+            d = range(glm::vec3(-1.0f), glm::vec3(1.0f));
+        } while (glm::dot(d, d) < 0.01f || glm::dot(d, d) > 1.0f);
+        return glm::normalize(d);
+    }
+};
+
+enum class SceneKind { Uniform, Clustered, Stacked, Fast };
+
+const char *scene_name(SceneKind kind) {
+    switch (kind) {
+    case SceneKind::Uniform:
+        return "uniform";
+    case SceneKind::Clustered:
+        return "clustered";
+    case SceneKind::Stacked:
+        return "stacked";
+    case SceneKind::Fast:
+        return "fast";
+    }
+    return "";
+}
+
+struct BodyDesc {
+    glm::vec3 position;
+    glm::quat orientation;
+    glm::vec3 halfExtents;
+    glm::vec3 velocity;
+};
+
+struct Scene {
+    SceneKind             kind;
+    std::vector<BodyDesc> bodies;
+    ChunkStore            world;
+    glm::vec3             min, max; // region the bodies start in
+};
+
+/*Scenes*/
+
+static void make_scene(Scene &scene, SceneKind kind, uint32_t count, uint64_t seed) {
+    Random random{seed * 0x9E3779B97F4A7C15ull + (uint64_t)kind + 1};
+    scene.kind = kind;
+    scene.bodies.resize(count);
+
+    // about one body per 27 cubic meters keeps the pair count per body the same at every size
+    float side = std::cbrt((float)count) * 3.0f;
+    scene.min  = glm::vec3(0.0f);
+    scene.max  = glm::vec3(side);
+
+    auto random_box = [&](BodyDesc &body) {
+        body.orientation = glm::angleAxis(random.range(0.0f, 6.2831853f), random.direction());
+        body.halfExtents = random.range(glm::vec3(0.2f), glm::vec3(0.8f));
+    };
+
+    switch (kind) {
+    case SceneKind::Uniform:
+        for (BodyDesc &body : scene.bodies) {
+            random_box(body);
+            body.position = random.range(scene.min, scene.max);
+            body.velocity = random.direction() * random.range(0.0f, 2.0f);
+        }
+        break;
+
+    case SceneKind::Clustered: {
+        // a few dense clumps, the sweep axis sees long runs of overlapping intervals
+        uint32_t               clusterCount = std::max(1u, count / 500);
+        std::vector<glm::vec3> centers(clusterCount);
+        for (glm::vec3 &center : centers) {
+            center = random.range(scene.min, scene.max);
+        }
+
+        float spread = std::cbrt(500.0f) * 1.2f;
+        for (BodyDesc &body : scene.bodies) {
+            random_box(body);
+            glm::vec3 offset = random.range(glm::vec3(-1.0f), glm::vec3(1.0f)) + random.range(glm::vec3(-1.0f), glm::vec3(1.0f));
+            body.position    = centers[random.next() % clusterCount] + offset * (spread * 0.5f);
+            body.velocity    = random.direction() * random.range(0.0f, 1.0f);
+        }
+        break;
+    }
+
+    case SceneKind::Stacked: {
+        // columns of resting cubes on a floor of blocks
+        uint32_t columns = (count + STACK_HEIGHT - 1) / STACK_HEIGHT;
+        uint32_t width   = (uint32_t)std::ceil(std::sqrt((float)columns));
+        float    spacing = 1.5f;
+
+        scene.max = glm::vec3(width * spacing, STACK_HEIGHT * 1.0f, width * spacing);
+        for (int32_t x = -1; x <= (int32_t)(width * spacing) + 1; x++) {
+            for (int32_t z = -1; z <= (int32_t)(width * spacing) + 1; z++) {
+                scene.world.set_solid(glm::ivec3(x, -1, z), true);
+            }
+        }
+
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t  column = i / STACK_HEIGHT;
+            BodyDesc &body   = scene.bodies[i];
+            body.orientation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+            body.halfExtents = glm::vec3(0.5f);
+            body.position    = glm::vec3((column % width + 0.5f) * spacing, 0.5f + (i % STACK_HEIGHT) * 1.0f, (column / width + 0.5f) * spacing);
+            body.velocity    = glm::vec3(0.0f);
+        }
+        break;
+    }
+
+    case SceneKind::Fast:
+        // small boxes moving many times their size per step, the case continuous collision is for
+        for (BodyDesc &body : scene.bodies) {
+            random_box(body);
+            body.halfExtents *= 0.5f;
+            body.position = random.range(scene.min, scene.max);
+            body.velocity = random.direction() * random.range(20.0f, 60.0f);
+        }
+        break;
+    }
+}
+
+// moves every body by its velocity and wraps it back into the scene so the density stays the same
+static void advance(Scene &scene) {
+    glm::vec3 size = scene.max - scene.min;
+    for (BodyDesc &body : scene.bodies) {
+        body.position += body.velocity * STEP_DT;
+        for (int axis = 0; axis < 3; axis++) {
+            if (body.position[axis] < scene.min[axis]) {
+                body.position[axis] += size[axis];
+            } else if (body.position[axis] > scene.max[axis]) {
+                body.position[axis] -= size[axis];
+            }
+        }
+    }
+}
+
+/*Timing*/
+
+struct Timing {
+    double   total   = 0.0;
+    double   min     = 1e30;
+    double   max     = 0.0;
+    uint32_t samples = 0;
+
+    void add(double ms) {
+        total += ms;
+        min   = std::min(min, ms);
+        max   = std::max(max, ms);
+        samples++;
+    }
+    double mean() const { return samples > 0 ? total / samples : 0.0; }
+};
+
+template <typename Fn> static double time_ms(Fn &&fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+struct Result {
+    std::string scene;
+    uint32_t    count;
+
+    Timing   broadPhase;
+    uint64_t pairs = 0;
+
+    Timing   narrowPhase;
+    uint64_t manifolds = 0;
+
+    Timing   bvhBuild;
+    Timing   rays;
+    uint64_t rayHits = 0;
+
+    Timing   hashUpdate;
+    Timing   hashRadius;
+    Timing   hashNearest;
+    uint64_t hashFound = 0;
+
+    Timing   solverStep;
+    uint32_t islands = 0;
+};
+
+static void box_triangles(const OBB &box, std::vector<glm::vec3> &positions) {
+    static const int faces[6][4] = {{0, 1, 3, 2}, {4, 6, 7, 5}, {0, 4, 5, 1}, {2, 3, 7, 6}, {0, 2, 6, 4}, {1, 5, 7, 3}};
+
+    glm::vec3 corners[8];
+    for (int i = 0; i < 8; i++) {
+        glm::vec3 sign((i & 4) ? 1.0f : -1.0f, (i & 2) ? 1.0f : -1.0f, (i & 1) ? 1.0f : -1.0f);
+        corners[i] = box.center + box.axes * (sign * box.halfExtents);
+    }
+    for (const auto &face : faces) {
+        positions.insert(positions.end(), {corners[face[0]], corners[face[1]], corners[face[2]], corners[face[0]], corners[face[2]], corners[face[3]]});
+    }
+}
+
+static void run_collision(Scene &scene, uint32_t steps, JobSystem &jobs, Result &result) {
+    uint32_t count = (uint32_t)scene.bodies.size();
+
+    SweepAndPrune          broadPhase;
+    NarrowPhase            narrowPhase;
+    SpatialHash            hash;
+    std::vector<OBB>       boxes(count);
+    std::vector<AABB>      bounds(count);
+    std::vector<glm::vec3> centers(count);
+    std::vector<uint32_t>  worldQueries;
+    std::vector<uint32_t>  found;
+    std::vector<MeshHit>   hits(RAYS_PER_STEP);
+    std::vector<uint8_t>   hitFlags(RAYS_PER_STEP);
+    std::vector<glm::vec3> triangles;
+    Random                 random{0x5EED + count};
+
+    if (scene.kind == SceneKind::Stacked) {
+        for (uint32_t i = 0; i < count; i++) {
+            worldQueries.push_back(i);
+        }
+    }
+    hash.init(2.0f, count);
+
+    // the first step fills the persistent state (sort order, previous manifolds) and is not counted
+    for (uint32_t step = 0; step <= steps; step++) {
+        bool measure = step > 0;
+        advance(scene);
+
+        for (uint32_t i = 0; i < count; i++) {
+            const BodyDesc &body = scene.bodies[i];
+            boxes[i]             = OBB{body.position, body.halfExtents, glm::mat3_cast(body.orientation)};
+            bounds[i]            = boxes[i].get_bounds();
+            centers[i]           = body.position;
+        }
+
+        double broad  = time_ms([&] { broadPhase.update(bounds); });
+        double narrow = time_ms([&] { narrowPhase.collide(boxes, broadPhase.get_pairs(), &scene.world, worldQueries, jobs); });
+        double update = time_ms([&] { hash.update(centers); });
+
+        double radius = time_ms([&] {
+            for (uint32_t q = 0; q < QUERY_COUNT; q++) {
+                hash.query_radius(centers[q % count], 3.0f, found);
+                result.hashFound += found.size();
+            }
+        });
+        double nearest = time_ms([&] {
+            for (uint32_t q = 0; q < QUERY_COUNT; q++) {
+                hash.query_nearest(centers[(q * 7919) % count], 8, found);
+                result.hashFound += found.size();
+            }
+        });
+
+        if (measure) {
+            result.broadPhase.add(broad);
+            result.narrowPhase.add(narrow);
+            result.hashUpdate.add(update);
+            result.hashRadius.add(radius);
+            result.hashNearest.add(nearest);
+            result.pairs += broadPhase.get_pairs().size();
+            result.manifolds += narrowPhase.get_manifolds().size();
+        }
+    }
+
+    // one static mesh out of every box, hit by batches of rays from inside the scene
+    triangles.clear();
+    triangles.reserve((size_t)count * 36);
+    for (const OBB &box : boxes) {
+        box_triangles(box, triangles);
+    }
+
+    MeshBVH bvh;
+    result.bvhBuild.add(time_ms([&] { bvh.build(triangles); }));
+
+    float reach = glm::length(scene.max - scene.min);
+    for (uint32_t step = 0; step < steps; step++) {
+        std::vector<glm::vec3> origins(RAYS_PER_STEP), directions(RAYS_PER_STEP);
+        for (uint32_t i = 0; i < RAYS_PER_STEP; i++) {
+            origins[i]    = random.range(scene.min, scene.max);
+            directions[i] = random.direction();
+        }
+
+        result.rays.add(time_ms([&] {
+            jobs.parallel_for(RAYS_PER_STEP, RAYS_PER_JOB, [&](uint32_t begin, uint32_t end) {
+                for (uint32_t i = begin; i < end; i++) {
+                    hitFlags[i] = bvh.raycast(origins[i], directions[i], reach, hits[i]);
+                }
+            });
+        }));
+
+        for (uint8_t hit : hitFlags) {
+            result.rayHits += hit;
+        }
+    }
+}
+
+static void run_solver(const Scene &scene, uint32_t steps, JobSystem &jobs, Result &result) {
+    PhysicsWorld physics;
+    physics.init(&jobs, &scene.world);
+
+    // the stacks fall on the floor, the free floating scenes run without gravity
+    if (scene.kind != SceneKind::Stacked) {
+        physics.gravity = glm::vec3(0.0f);
+    }
+
+    for (const BodyDesc &desc : scene.bodies) {
+        RigidBody &body     = physics.get_body(physics.add_box(desc.position, desc.halfExtents, 1.0f));
+        body.orientation    = desc.orientation;
+        body.linearVelocity = desc.velocity;
+        body.continuous     = scene.kind == SceneKind::Fast;
+    }
+
+    physics.step(STEP_DT);
+    for (uint32_t step = 0; step < steps; step++) {
+        result.solverStep.add(time_ms([&] { physics.step(STEP_DT); }));
+    }
+    result.islands = physics.get_island_count();
+}
+
+/*Output*/
+
+static void write_timing(FILE *file, const char *name, const Timing &timing, bool last = false) {
+    fprintf(file, "      \"%s\": {\"mean_ms\": %.4f, \"min_ms\": %.4f, \"max_ms\": %.4f, \"samples\": %u}%s\n", name, timing.mean(), timing.min, timing.max, timing.samples, last ? "" : ",");
+}
+
+static bool write_json(const char *path, const std::vector<Result> &results, uint32_t steps, uint32_t threads, uint64_t seed) {
+    FILE *file = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "could not open %s\n", path);
+        return false;
+    }
+
+    fprintf(file, "{\n  \"benchmark\": \"collision\",\n  \"steps\": %u,\n  \"threads\": %u,\n  \"seed\": %llu,\n  \"results\": [\n", steps, threads, (unsigned long long)seed);
+    for (size_t i = 0; i < results.size(); i++) {
+        const Result &result = results[i];
+        fprintf(file, "    {\n      \"scene\": \"%s\",\n      \"bodies\": %u,\n", result.scene.c_str(), result.count);
+        write_timing(file, "broad_phase", result.broadPhase);
+        write_timing(file, "narrow_phase", result.narrowPhase);
+        write_timing(file, "bvh_build", result.bvhBuild);
+        write_timing(file, "ray_batch", result.rays);
+        write_timing(file, "hash_update", result.hashUpdate);
+        write_timing(file, "hash_radius_batch", result.hashRadius);
+        write_timing(file, "hash_nearest_batch", result.hashNearest);
+        write_timing(file, "solver_step", result.solverStep);
+        // counts are checksums, a change means the benchmark did different work
+        fprintf(file, "      \"pairs\": %llu,\n      \"manifolds\": %llu,\n      \"ray_hits\": %llu,\n      \"hash_found\": %llu,\n      \"islands\": %u\n", (unsigned long long)result.pairs,
+                (unsigned long long)result.manifolds, (unsigned long long)result.rayHits, (unsigned long long)result.hashFound, result.islands);
+        fprintf(file, "    }%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+
+    if (file != stdout) {
+        fclose(file);
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    const char           *output  = "collision_bench.json";
+    std::vector<uint32_t> counts  = {1000, 10000, 100000};
+    uint32_t              steps   = 10;
+    uint32_t              threads = 0; // workers, 0 is one per hardware thread
+    uint64_t              seed    = 1;
+
+    for (int i = 1; i < argc; i++) {
+        bool hasValue = i + 1 < argc;
+        if (strcmp(argv[i], "-o") == 0 && hasValue) {
+            output = argv[++i];
+        } else if (strcmp(argv[i], "-n") == 0 && hasValue) {
+            counts.clear();
+            for (char *token = strtok(argv[++i], ","); token; token = strtok(nullptr, ",")) {
+                counts.push_back((uint32_t)strtoul(token, nullptr, 10));
+            }
+        } else if (strcmp(argv[i], "-s") == 0 && hasValue) {
+            steps = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "-t") == 0 && hasValue && strtoul(argv[i + 1], nullptr, 10) > 0) {
+            threads = (uint32_t)strtoul(argv[++i], nullptr, 10);
+        } else if (strcmp(argv[i], "--seed") == 0 && hasValue) {
+            seed = strtoull(argv[++i], nullptr, 10);
+        } else {
+            fprintf(stderr, "usage: %s [-o results.json|-] [-n 1000,10000,100000] [-s steps] [-t workers >= 1] [--seed n]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    JobSystem jobs;
+    jobs.init(threads);
+    uint32_t threadCount = jobs.worker_count() + 1;
+
+    std::vector<Result> results;
+    for (uint32_t count : counts) {
+        for (SceneKind kind : {SceneKind::Uniform, SceneKind::Clustered, SceneKind::Stacked, SceneKind::Fast}) {
+            Result result;
+            result.scene = scene_name(kind);
+            result.count = count;
+
+            Scene scene;
+            make_scene(scene, kind, count, seed);
+            run_solver(scene, steps, jobs, result);
+            run_collision(scene, steps, jobs, result);
+
+            fprintf(stderr, "%-9s %7u  broad %8.3f ms  narrow %8.3f ms  rays %8.3f ms  solver %9.3f ms\n", result.scene.c_str(), count, result.broadPhase.mean(), result.narrowPhase.mean(), result.rays.mean(),
+                    result.solverStep.mean());
+            results.push_back(result);
+        }
+    }
+
+    jobs.shutdown();
+    return write_json(output, results, steps, threadCount, seed) ? 0 : 1;
+}
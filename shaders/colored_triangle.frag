@@ -1,4 +1,5 @@
 #version 460
+#extension GL_EXT_nonuniform_qualifier : require
 
 // shader input
 layout(location = 0) in vec3 inNormal;
@@ -6,34 +7,60 @@ layout(location = 1) in vec2 inTexCoord;
 layout(location = 2) flat in uint inFaceIndex;
 layout(location = 3) in vec3 inFragPos;
 layout(location = 4) in vec3 camPos;
+layout(location = 5) flat in uint inMaterial;
 
 // output write
 layout(location = 0) out vec4 outFragColor;
 
-layout(set = 2, binding = 0) uniform sampler2DArray textureArray;
+// BINDLESS_NONE
+const uint NO_TEXTURE = 0xFFFFFFFF;
 
-layout(set = 2, binding = 1) uniform GPUTextureBuffer {
+layout(push_constant) uniform DrawConstants {
+    uint objectBuffer;
+    uint materialBuffer;
+}
+draw;
+
+// the bindless set, every texture is a 2D array
+layout(set = 1, binding = 0) uniform texture2DArray textures[];
+layout(set = 1, binding = 1) uniform sampler samplers[];
+
+// GPUTexture
+struct Material {
     uint faceIndices[6];
     vec3 ambient;
     float shininess;
     vec3 diffuse;
     vec3 specular;
+    float padding;
+    uint albedoTexture;
+    uint normalTexture;
+    uint textureSampler;
+};
+
+layout(std140, set = 1, binding = 2) readonly buffer MaterialBuffer {
+    Material materials[];
 }
-textureInfo;
-
-layout(set = 2, binding = 2) uniform sampler2DArray normalTextureArray;
+materialBuffers[];
 
 void main() {
 
-    vec4 color = texture(textureArray, vec3(inTexCoord, textureInfo.faceIndices[inFaceIndex]));
+    Material textureInfo = materialBuffers[draw.materialBuffer].materials[inMaterial];
+    vec3 texCoord = vec3(inTexCoord, textureInfo.faceIndices[inFaceIndex]);
+    uint samplerSlot = textureInfo.textureSampler;
+
+    vec4 color = texture(sampler2DArray(textures[nonuniformEXT(textureInfo.albedoTexture)], samplers[nonuniformEXT(samplerSlot)]), texCoord);
 
     vec3 lightColor = vec3(1.0f, 1.0f, 1.0f);
     vec3 lightPos = vec3(1, 1, 0);
 
-    vec3 normal = texture(normalTextureArray, vec3(inTexCoord, textureInfo.faceIndices[inFaceIndex])).rgb;
+    vec3 normal = normalize(inNormal);
+    if (textureInfo.normalTexture != NO_TEXTURE) {
+        normal = texture(sampler2DArray(textures[nonuniformEXT(textureInfo.normalTexture)], samplers[nonuniformEXT(samplerSlot)]), texCoord).rgb;
 
-    // transform normal vector to range [-1,1]
-    normal = normalize(normal * 2.0 - 1.0);
+        // transform normal vector to range [-1,1]
+        normal = normalize(normal * 2.0 - 1.0);
+    }
 
     vec3 ambient = lightColor * textureInfo.ambient* color.rgb;
 
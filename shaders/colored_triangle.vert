@@ -1,4 +1,5 @@
 #version 460
+#extension GL_EXT_nonuniform_qualifier : require
 
 layout(location = 0) in vec3 vPosition;
 layout(location = 1) in vec3 vNormal;
@@ -10,6 +11,7 @@ layout(location = 1) out vec2 texCoord;
 layout(location = 2) out uint outFaceIndex;
 layout(location = 3) out vec3 outFrag;
 layout(location = 4) out vec3 camPos;
+layout(location = 5) flat out uint outMaterial;
 
 layout(set = 0, binding = 0) uniform CameraBuffer {
     mat4 viewproj;
@@ -18,21 +20,38 @@ layout(set = 0, binding = 0) uniform CameraBuffer {
 }
 cameraData;
 
+// bindless slots, see GPUDrawConstants
+layout(push_constant) uniform DrawConstants {
+    uint objectBuffer;
+    uint materialBuffer;
+}
+draw;
+
+// GPUObject
 struct ObjectData {
     mat4 model;
+    vec4 boundingSphere;
+    uint material;
+    uint vertexCount;
+    uint firstVertex;
 };
 
-layout(std140, set = 1, binding = 0) readonly buffer ObjectBuffer {
+// the storage buffer array of the bindless set
+layout(std140, set = 1, binding = 2) readonly buffer ObjectBuffer {
     ObjectData objects[]; // Declare as an array
 }
-objectBuffer;
+objectBuffers[];
 
 void main() {
-    gl_Position = cameraData.viewproj * objectBuffer.objects[gl_BaseInstance].model * vec4(vPosition, 1.0);
+    // the object index is the first instance, also of the culled indirect draws
+    ObjectData object = objectBuffers[draw.objectBuffer].objects[gl_BaseInstance];
+
+    gl_Position = cameraData.viewproj * object.model * vec4(vPosition, 1.0);
     outNormal = vNormal;
     texCoord = vTexCoord;
     outFaceIndex = vFaceIndex;
     camPos = cameraData.camPos;
+    outMaterial = object.material;
 
-    outFrag = (objectBuffer.objects[gl_BaseInstance].model * vec4(vPosition, 1.0)).rgb;
+    outFrag = (object.model * vec4(vPosition, 1.0)).rgb;
 }
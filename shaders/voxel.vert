@@ -0,0 +1,76 @@
+#version 460
+#extension GL_EXT_nonuniform_qualifier : require
+
+// no vertex input, every vertex is a corner of the face gl_VertexIndex / 4 of the face buffer
+
+layout(location = 0) out vec3 outNormal;
+layout(location = 1) out vec2 texCoord;
+layout(location = 2) out uint outFaceIndex;
+layout(location = 3) out vec3 outFrag;
+layout(location = 4) out vec3 camPos;
+layout(location = 5) flat out uint outMaterial;
+
+layout(set = 0, binding = 0) uniform CameraBuffer {
+    mat4 viewproj;
+    vec3 camPos;
+}
+cameraData;
+
+// bindless slots, see GPUVoxelConstants. The material buffer is where colored_triangle.frag has it
+layout(push_constant) uniform VoxelConstants {
+    uint sectionBuffer;
+    uint materialBuffer;
+    uint faceBuffer;
+}
+voxel;
+
+// the storage buffer array of the bindless set
+layout(std430, set = 1, binding = 2) readonly buffer FaceBuffer {
+    uint faces[]; // pack_voxel_face
+}
+faceBuffers[];
+
+layout(std430, set = 1, binding = 2) readonly buffer SectionBuffer {
+    ivec4 origins[]; // first block of the section, by the first instance of its draw
+}
+sectionBuffers[];
+
+// per direction, in the face order of the cube mesh: the corners from the low corner of the block and
+// their uvs, wound like the cube so the indices 0, 1, 2, 2, 1, 3 face outwards
+const vec3 CORNERS[24] = vec3[](
+    vec3(1, 1, 0), vec3(1, 0, 0), vec3(1, 1, 1), vec3(1, 0, 1), // +x
+    vec3(0, 1, 0), vec3(0, 1, 1), vec3(0, 0, 0), vec3(0, 0, 1), // -x
+    vec3(1, 1, 0), vec3(1, 1, 1), vec3(0, 1, 0), vec3(0, 1, 1), // +y
+    vec3(1, 0, 0), vec3(0, 0, 0), vec3(1, 0, 1), vec3(0, 0, 1), // -y
+    vec3(1, 0, 0), vec3(1, 1, 0), vec3(0, 0, 0), vec3(0, 1, 0), // -z
+    vec3(1, 0, 1), vec3(0, 0, 1), vec3(1, 1, 1), vec3(0, 1, 1)  // +z
+);
+
+const vec2 UVS[24] = vec2[](
+    vec2(0, 1), vec2(0, 0), vec2(1, 1), vec2(1, 0),
+    vec2(0, 0), vec2(1, 0), vec2(0, 1), vec2(1, 1),
+    vec2(1, 1), vec2(1, 0), vec2(0, 1), vec2(0, 0),
+    vec2(1, 1), vec2(0, 1), vec2(1, 0), vec2(0, 0),
+    vec2(0, 1), vec2(0, 0), vec2(1, 1), vec2(1, 0),
+    vec2(0, 1), vec2(1, 1), vec2(0, 0), vec2(1, 0)
+);
+
+const vec3 NORMALS[6] = vec3[](vec3(1, 0, 0), vec3(-1, 0, 0), vec3(0, 1, 0), vec3(0, -1, 0), vec3(0, 0, -1), vec3(0, 0, 1));
+
+void main() {
+    uint face      = faceBuffers[voxel.faceBuffer].faces[gl_VertexIndex >> 2];
+    uint direction = (face >> 12) & 7;
+    uint corner    = direction * 4 + (gl_VertexIndex & 3);
+
+    ivec3 block    = sectionBuffers[voxel.sectionBuffer].origins[gl_InstanceIndex].xyz + ivec3(face & 15, (face >> 4) & 15, (face >> 8) & 15);
+    vec3  position = vec3(block) + CORNERS[corner];
+
+    gl_Position = cameraData.viewproj * vec4(position, 1.0);
+    outNormal = NORMALS[direction];
+    texCoord = UVS[corner];
+    outFaceIndex = direction;
+    camPos = cameraData.camPos;
+    outMaterial = face >> 15;
+
+    outFrag = position;
+}
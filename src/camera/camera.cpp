@@ -13,7 +13,12 @@ glm::mat4x4 Camera::get_view() {
 
 glm::vec3 Camera::get_camera_position() { return _camPos; }
 
-void Camera::process_input(SDL_Event *event, float deltaTime, int mouse_delta_x, int mouse_delta_y, const uint8_t *keystate, uint8_t focusWindow) {
+void Camera::set_camera_position(glm::vec3 position) { _camPos = position; }
+
+glm::vec3 Camera::get_move_direction() { return _moveDirection; }
+
+void Camera::process_input(SDL_Event *event, int mouse_delta_x, int mouse_delta_y, const uint8_t *keystate, uint8_t focusWindow) {
+    _moveDirection = glm::vec3(0.0f);
 
     if (!focusWindow)
         return;
@@ -22,11 +27,8 @@ void Camera::process_input(SDL_Event *event, float deltaTime, int mouse_delta_x,
 
     float sensitivity = 0.1f;
 
-    mouse_delta_x *= sensitivity;
-    mouse_delta_y *= sensitivity;
-
-    _yaw += mouse_delta_x;
-    _pitch += mouse_delta_y * -1;
+    _yaw += mouse_delta_x * sensitivity;
+    _pitch += mouse_delta_y * sensitivity * -1;
 
     if (_pitch > 89.0f)
         _pitch = 89.0f;
@@ -41,23 +43,26 @@ void Camera::process_input(SDL_Event *event, float deltaTime, int mouse_delta_x,
     //  }
 
     //   if (event->type == SDL_KEYDOWN)
-    const float camera_speed = 2.5f * deltaTime;
-    // Handle key events
+    // the movement itself is done by the character controller. Forward stays level, looking up or down
+    // doesn't climb or slow the walk, up and down are space and shift only
+    glm::vec3 forward = glm::normalize(glm::vec3(_camFront.x, 0.0f, _camFront.z));
+    glm::vec3 right   = glm::normalize(glm::cross(_camFront, _camUp));
     if (keystate[SDL_SCANCODE_W]) {
-        auto d = camera_speed * _camFront;
-        // printf("speed x: %f\n", d.x);
-        // printf("speed y: %f\n", d.y);
-        // printf("speed z: %f\n", d.z);
-        // printf("\n\n");
-        _camPos += camera_speed * _camFront;
+        _moveDirection += forward;
     }
     if (keystate[SDL_SCANCODE_S]) {
-        _camPos -= camera_speed * _camFront;
+        _moveDirection -= forward;
     }
     if (keystate[SDL_SCANCODE_A]) {
-        _camPos -= glm::normalize(glm::cross(_camFront, _camUp)) * camera_speed;
+        _moveDirection -= right;
     }
     if (keystate[SDL_SCANCODE_D]) {
-        _camPos += glm::normalize(glm::cross(_camFront, _camUp)) * camera_speed;
+        _moveDirection += right;
+    }
+    if (keystate[SDL_SCANCODE_SPACE]) {
+        _moveDirection += _camUp;
+    }
+    if (keystate[SDL_SCANCODE_LSHIFT]) {
+        _moveDirection -= _camUp;
     }
 }
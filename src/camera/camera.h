@@ -7,14 +7,20 @@ class Camera {
   public:
     glm::mat4x4 get_projection();
     glm::mat4x4 get_view();
-    void process_input(SDL_Event *event, float deltaTime, int mouse_delta_x, int mouse_delta_y, const uint8_t *keycode, uint8_t focusWindow);
-    glm::vec3 get_camera_position();
+    void        process_input(SDL_Event *event, int mouse_delta_x, int mouse_delta_y, const uint8_t *keycode, uint8_t focusWindow);
+    glm::vec3   get_camera_position();
+    void        set_camera_position(glm::vec3 position);
+
+    // direction the keys ask to move in, forward kept level, y is up/down (space/shift)
+    glm::vec3 get_move_direction();
 
   private:
-    glm::vec3 _camPos = glm::vec3(0.0f, 0.0f, 3.0f);
+    glm::vec3 _camPos   = glm::vec3(0.0f, 0.0f, 3.0f);
     glm::vec3 _camFront = glm::vec3(0.0f, 0.0f, 1.0f);
-    glm::vec3 _camUp = glm::vec3(0.0f, 1.0f, 0.0f);
+    glm::vec3 _camUp    = glm::vec3(0.0f, 1.0f, 0.0f);
+
+    glm::vec3 _moveDirection = glm::vec3(0.0f);
 
-    float _yaw = 0;
+    float _yaw   = 0;
     float _pitch = 0;
 };
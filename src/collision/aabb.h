@@ -0,0 +1,23 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+struct AABB {
+    glm::vec3 min;
+    glm::vec3 max;
+
+    glm::vec3 center() const { return (min + max) * 0.5f; }
+    glm::vec3 extents() const { return (max - min) * 0.5f; }
+
+    void translate(glm::vec3 offset) {
+        min += offset;
+        max += offset;
+    }
+
+    bool overlaps(const AABB &other) const {
+        return min.x <= other.max.x && max.x >= other.min.x && min.y <= other.max.y && max.y >= other.min.y && min.z <= other.max.z && max.z >= other.min.z;
+    }
+
+    // box grown to contain the whole movement by offset
+    AABB swept(glm::vec3 offset) const { return AABB{glm::min(min, min + offset), glm::max(max, max + offset)}; }
+};
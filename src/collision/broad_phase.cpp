@@ -0,0 +1,66 @@
+#include "broad_phase.h"
+
+#include <algorithm>
+
+void SweepAndPrune::update(const std::vector<AABB> &boxes) {
+    uint32_t count = (uint32_t)boxes.size();
+
+    if (_order.size() != count) {
+        _order.resize(count);
+        for (uint32_t i = 0; i < count; i++) {
+            _order[i] = i;
+        }
+        std::sort(_order.begin(), _order.end(), [&](uint32_t a, uint32_t b) { return boxes[a].min[axis] < boxes[b].min[axis]; });
+    } else {
+        for (uint32_t i = 1; i < count; i++) {
+            uint32_t proxy = _order[i];
+            float    value = boxes[proxy].min[axis];
+
+            uint32_t j = i;
+            while (j > 0 && boxes[_order[j - 1]].min[axis] > value) {
+                _order[j] = _order[j - 1];
+                j--;
+            }
+            _order[j] = proxy;
+        }
+    }
+
+    // the sweep only reads these, keeps it on contiguous floats
+    _sortedMin.resize(count);
+    _sortedMax.resize(count);
+    _maxExtent = 0.0f;
+    for (uint32_t i = 0; i < count; i++) {
+        _sortedMin[i] = boxes[_order[i]].min[axis];
+        _sortedMax[i] = boxes[_order[i]].max[axis];
+        _maxExtent    = std::max(_maxExtent, _sortedMax[i] - _sortedMin[i]);
+    }
+
+    _pairs.clear();
+    for (uint32_t i = 0; i < count; i++) {
+        const AABB &box = boxes[_order[i]];
+
+        for (uint32_t j = i + 1; j < count && _sortedMin[j] <= _sortedMax[i]; j++) {
+            if (!box.overlaps(boxes[_order[j]])) {
+                continue;
+            }
+
+            uint32_t a = _order[i];
+            uint32_t b = _order[j];
+            _pairs.push_back(a < b ? BroadPhasePair{a, b} : BroadPhasePair{b, a});
+        }
+    }
+}
+
+void SweepAndPrune::query(const std::vector<AABB> &boxes, const AABB &box, std::vector<uint32_t> &result) const {
+    result.clear();
+
+    // nothing starting further back than the widest box can reach the query
+    auto     first = std::lower_bound(_sortedMin.begin(), _sortedMin.end(), box.min[axis] - _maxExtent);
+    uint32_t count = (uint32_t)_sortedMin.size();
+
+    for (uint32_t i = (uint32_t)(first - _sortedMin.begin()); i < count && _sortedMin[i] <= box.max[axis]; i++) {
+        if (_sortedMax[i] >= box.min[axis] && box.overlaps(boxes[_order[i]])) {
+            result.push_back(_order[i]);
+        }
+    }
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include "aabb.h"
+
+#include <cstdint>
+#include <vector>
+
+struct BroadPhasePair {
+    uint32_t a; // a < b
+    uint32_t b;
+};
+
+// Sweep and prune along one axis. The sorted order is kept between updates, objects only move a
+// little each step so the insertion sort has almost nothing to do.
+class SweepAndPrune {
+  public:
+    // boxes[i] is the bounds of proxy i, the pairs are rebuilt on every call
+    void update(const std::vector<AABB> &boxes);
+
+    const std::vector<BroadPhasePair> &get_pairs() const { return _pairs; }
+
+    // proxies of the last update overlapping box, boxes must be the ones passed to update
+    void query(const std::vector<AABB> &boxes, const AABB &box, std::vector<uint32_t> &result) const;
+
+    int axis = 0;
+
+  private:
+    std::vector<uint32_t>       _order;
+    std::vector<float>          _sortedMin;
+    std::vector<float>          _sortedMax;
+    float                       _maxExtent = 0.0f; // widest box along the axis, bounds how far back a query has to look
+    std::vector<BroadPhasePair> _pairs;
+};
@@ -0,0 +1,126 @@
+#include "character_controller.h"
+
+#include <cmath>
+
+// boxes touching a block face are not treated as overlapping it
+const float COLLISION_EPSILON = 1e-4f;
+
+// Moves the box along one axis and returns how far it could go. Only the blocks inside the swept
+// volume are visited, taken from the column bitmasks of the chunk store.
+static float sweep_axis(const ChunkStore &world, const AABB &box, int axis, float delta) {
+    if (delta == 0.0f) {
+        return 0.0f;
+    }
+
+    glm::vec3 offset(0.0f);
+    offset[axis] = delta;
+
+    AABB       swept = box.swept(offset);
+    glm::ivec3 minBlock(glm::floor(swept.min + COLLISION_EPSILON));
+    glm::ivec3 maxBlock(glm::floor(swept.max - COLLISION_EPSILON));
+
+    world.for_each_solid(minBlock, maxBlock, [&](glm::ivec3 block) {
+        if (delta > 0.0f) {
+            float allowed = (float)block[axis] - box.max[axis];
+            if (allowed >= -COLLISION_EPSILON) {
+                delta = glm::min(delta, allowed);
+            }
+        } else {
+            float allowed = (float)(block[axis] + 1) - box.min[axis];
+            if (allowed <= COLLISION_EPSILON) {
+                delta = glm::max(delta, allowed);
+            }
+        }
+    });
+
+    return delta;
+}
+
+static glm::vec3 sweep_box(const ChunkStore &world, AABB &box, glm::vec3 delta) {
+    glm::vec3 moved(0.0f);
+    const int axisOrder[] = {1, 0, 2};
+
+    for (int axis : axisOrder) {
+        moved[axis] = sweep_axis(world, box, axis, delta[axis]);
+
+        glm::vec3 offset(0.0f);
+        offset[axis] = moved[axis];
+        box.translate(offset);
+    }
+    return moved;
+}
+
+glm::vec3 CharacterController::move(const ChunkStore &world, glm::vec3 delta) {
+    AABB      box   = get_bounds();
+    glm::vec3 moved = sweep_box(world, box, delta);
+
+    bool blockedSideways = moved.x != delta.x || moved.z != delta.z;
+    bool landed          = delta.y < 0.0f && moved.y != delta.y;
+
+    // try to walk up the obstacle: lift the box, move sideways and put it back down
+    if (!flying && blockedSideways && (onGround || landed) && stepHeight > 0.0f) {
+        AABB stepBox = get_bounds();
+
+        float lift = sweep_axis(world, stepBox, 1, stepHeight);
+        stepBox.translate(glm::vec3(0.0f, lift, 0.0f));
+
+        glm::vec3 stepMoved = sweep_box(world, stepBox, glm::vec3(delta.x, 0.0f, delta.z));
+
+        float drop = sweep_axis(world, stepBox, 1, -lift + glm::min(delta.y, 0.0f));
+        stepMoved.y = lift + drop;
+
+        float sideways     = moved.x * moved.x + moved.z * moved.z;
+        float stepSideways = stepMoved.x * stepMoved.x + stepMoved.z * stepMoved.z;
+        if (stepSideways > sideways + COLLISION_EPSILON) {
+            moved = stepMoved;
+        }
+    }
+
+    return moved;
+}
+
+void CharacterController::step(const ChunkStore &world, glm::vec3 wishDirection, bool jump, float dt) {
+    previousPosition = position;
+
+    if (flying) {
+        // diagonals are no faster than straight
+        velocity = glm::dot(wishDirection, wishDirection) > 0.0f ? glm::normalize(wishDirection) * flySpeed : glm::vec3(0.0f);
+    } else {
+        glm::vec3 horizontal(wishDirection.x, 0.0f, wishDirection.z);
+        if (glm::dot(horizontal, horizontal) > 0.0f) {
+            horizontal = glm::normalize(horizontal);
+        }
+
+        velocity.x = horizontal.x * walkSpeed;
+        velocity.z = horizontal.z * walkSpeed;
+        velocity.y -= gravity * dt;
+
+        if (jump && onGround) {
+            velocity.y = jumpSpeed;
+        }
+    }
+
+    glm::vec3 delta = velocity * dt;
+    glm::vec3 moved = move(world, delta);
+
+    onGround = !flying && delta.y < 0.0f && moved.y > delta.y;
+
+    // stop the velocity on blocked axes, the unblocked ones keep sliding
+    for (int axis = 0; axis < 3; axis++) {
+        if (moved[axis] != delta[axis]) {
+            velocity[axis] = 0.0f;
+        }
+    }
+
+    position += moved;
+}
+
+void CharacterController::teleport(glm::vec3 newPosition) {
+    position         = newPosition;
+    previousPosition = newPosition;
+    velocity         = glm::vec3(0.0f);
+}
+
+glm::vec3 CharacterController::interpolated_position(float alpha) const { return glm::mix(previousPosition, position, alpha); }
+
+AABB CharacterController::get_bounds() const { return AABB{position - halfExtents, position + halfExtents}; }
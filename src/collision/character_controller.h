@@ -0,0 +1,35 @@
+#pragma once
+
+#include "aabb.h"
+#include "voxel_world.h"
+
+#include <glm/glm.hpp>
+
+// Player box moved through the voxel world one axis at a time (y, x, z), so a blocked axis
+// slides along the others. Meant to be stepped with a fixed timestep, render with interpolated_position.
+struct CharacterController {
+    glm::vec3 position         = glm::vec3(0.0f); // center of the box
+    glm::vec3 previousPosition = glm::vec3(0.0f); // position before the last step
+    glm::vec3 velocity         = glm::vec3(0.0f);
+    glm::vec3 halfExtents      = glm::vec3(0.3f, 0.9f, 0.3f);
+
+    float stepHeight = 0.6f;
+    float walkSpeed  = 4.3f;
+    float flySpeed   = 2.5f;
+    float jumpSpeed  = 7.5f;
+    float gravity    = 25.0f;
+
+    bool onGround = false;
+    bool flying   = true;
+
+    // wishDirection is the wanted movement direction, when walking only its x/z part is used. jump
+    // only matters when walking on the ground
+    void step(const ChunkStore &world, glm::vec3 wishDirection, bool jump, float dt);
+
+    void      teleport(glm::vec3 newPosition);
+    glm::vec3 interpolated_position(float alpha) const;
+    AABB      get_bounds() const;
+
+  private:
+    glm::vec3 move(const ChunkStore &world, glm::vec3 delta);
+};
@@ -0,0 +1,602 @@
+#include "gjk.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+const uint32_t GJK_MAX_ITERATIONS = 32;
+const float    GJK_TOLERANCE      = 1e-6f; // relative progress below which the distance is converged
+const float    GJK_OVERLAP        = 1e-10f; // squared distance treated as touching
+
+const uint32_t EPA_MAX_VERTICES   = 64;
+const uint32_t EPA_MAX_FACES      = 128;
+const uint32_t EPA_MAX_ITERATIONS = EPA_MAX_VERTICES - 4;
+const float    EPA_TOLERANCE      = 1e-4f;
+
+/*Shapes*/
+
+void ConvexHull::build(const std::vector<glm::vec3> &positions) {
+    points = positions;
+    std::sort(points.begin(), points.end(), [](glm::vec3 a, glm::vec3 b) { return a.x != b.x ? a.x < b.x : (a.y != b.y ? a.y < b.y : a.z < b.z); });
+    points.erase(std::unique(points.begin(), points.end()), points.end());
+}
+
+glm::vec3 ConvexHull::support(glm::vec3 direction) const {
+    if (points.empty()) {
+        return glm::vec3(0.0f);
+    }
+
+    glm::vec3 best    = points[0];
+    float     bestDot = glm::dot(best, direction);
+    for (size_t i = 1; i < points.size(); i++) {
+        float d = glm::dot(points[i], direction);
+        if (d > bestDot) {
+            bestDot = d;
+            best    = points[i];
+        }
+    }
+    return best;
+}
+
+ConvexShape ConvexShape::sphere(glm::vec3 center, float radius) {
+    ConvexShape shape;
+    shape.type   = ShapeType::Sphere;
+    shape.center = center;
+    shape.radius = radius;
+    return shape;
+}
+
+ConvexShape ConvexShape::box(const OBB &box) {
+    ConvexShape shape;
+    shape.type        = ShapeType::Box;
+    shape.center      = box.center;
+    shape.axes        = box.axes;
+    shape.halfExtents = box.halfExtents;
+    return shape;
+}
+
+ConvexShape ConvexShape::capsule(glm::vec3 center, const glm::mat3 &axes, float halfHeight, float radius) {
+    ConvexShape shape;
+    shape.type        = ShapeType::Capsule;
+    shape.center      = center;
+    shape.axes        = axes;
+    shape.halfExtents = glm::vec3(0.0f, halfHeight, 0.0f);
+    shape.radius      = radius;
+    return shape;
+}
+
+ConvexShape ConvexShape::convex_hull(const ConvexHull *hull, glm::vec3 center, const glm::mat3 &axes) {
+    ConvexShape shape;
+    shape.type   = ShapeType::Hull;
+    shape.center = center;
+    shape.axes   = axes;
+    shape.hull   = hull;
+    return shape;
+}
+
+glm::vec3 ConvexShape::support(glm::vec3 direction) const {
+    switch (type) {
+    case ShapeType::Sphere:
+        return center;
+    case ShapeType::Box: {
+        glm::vec3 point = center;
+        for (int i = 0; i < 3; i++) {
+            point += axes[i] * (glm::dot(axes[i], direction) >= 0.0f ? halfExtents[i] : -halfExtents[i]);
+        }
+        return point;
+    }
+    case ShapeType::Capsule:
+        return center + axes[1] * (glm::dot(axes[1], direction) >= 0.0f ? halfExtents.y : -halfExtents.y);
+    case ShapeType::Hull:
+        return center + axes * hull->support(glm::transpose(axes) * direction);
+    }
+    return center;
+}
+
+/*Simplex*/
+
+struct SimplexVertex {
+    glm::vec3 w; // a - b
+    glm::vec3 a;
+    glm::vec3 b;
+    glm::vec3 direction; // the direction a was found along, -direction for b
+    float     weight;
+};
+
+struct Simplex {
+    SimplexVertex vertices[4];
+    uint32_t      count = 0;
+
+    glm::vec3 closest() const {
+        glm::vec3 point(0.0f);
+        for (uint32_t i = 0; i < count; i++) {
+            point += vertices[i].w * vertices[i].weight;
+        }
+        return point;
+    }
+};
+
+static SimplexVertex support(const ConvexShape &a, const ConvexShape &b, glm::vec3 direction) {
+    SimplexVertex vertex;
+    vertex.a         = a.support(direction);
+    vertex.b         = b.support(-direction);
+    vertex.w         = vertex.a - vertex.b;
+    vertex.direction = direction;
+    vertex.weight    = 1.0f;
+    return vertex;
+}
+
+// same as support with the radius of spheres and capsules, EPA needs the real surface
+static SimplexVertex support_with_radius(const ConvexShape &a, const ConvexShape &b, glm::vec3 direction) {
+    SimplexVertex vertex = support(a, b, direction);
+    glm::vec3     unit   = direction * (1.0f / std::sqrt(std::max(glm::dot(direction, direction), FLT_MIN)));
+    vertex.a += unit * a.radius;
+    vertex.b -= unit * b.radius;
+    vertex.w = vertex.a - vertex.b;
+    return vertex;
+}
+
+static void solve_segment(Simplex &simplex) {
+    glm::vec3 a      = simplex.vertices[0].w;
+    glm::vec3 ab     = simplex.vertices[1].w - a;
+    float     length = glm::dot(ab, ab);
+    float     t      = length > FLT_MIN ? -glm::dot(a, ab) / length : 0.0f;
+
+    if (t <= 0.0f) {
+        simplex.count              = 1;
+        simplex.vertices[0].weight = 1.0f;
+    } else if (t >= 1.0f) {
+        simplex.vertices[0]        = simplex.vertices[1];
+        simplex.count              = 1;
+        simplex.vertices[0].weight = 1.0f;
+    } else {
+        simplex.vertices[0].weight = 1.0f - t;
+        simplex.vertices[1].weight = t;
+    }
+}
+
+// closest point of the triangle to the origin by Voronoi regions, keeps only the vertices it depends on
+static void solve_triangle(Simplex &simplex) {
+    SimplexVertex A = simplex.vertices[0], B = simplex.vertices[1], C = simplex.vertices[2];
+    glm::vec3     a = A.w, b = B.w, c = C.w;
+    glm::vec3     ab = b - a, ac = c - a;
+
+    auto keep1 = [&](const SimplexVertex &v) {
+        simplex.vertices[0]        = v;
+        simplex.vertices[0].weight = 1.0f;
+        simplex.count              = 1;
+    };
+    auto keep2 = [&](const SimplexVertex &v0, const SimplexVertex &v1, float t) {
+        simplex.vertices[0]        = v0;
+        simplex.vertices[1]        = v1;
+        simplex.vertices[0].weight = 1.0f - t;
+        simplex.vertices[1].weight = t;
+        simplex.count              = 2;
+    };
+
+    float d1 = -glm::dot(ab, a), d2 = -glm::dot(ac, a);
+    if (d1 <= 0.0f && d2 <= 0.0f) {
+        return keep1(A);
+    }
+
+    float d3 = -glm::dot(ab, b), d4 = -glm::dot(ac, b);
+    if (d3 >= 0.0f && d4 <= d3) {
+        return keep1(B);
+    }
+
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+        return keep2(A, B, d1 / (d1 - d3));
+    }
+
+    float d5 = -glm::dot(ab, c), d6 = -glm::dot(ac, c);
+    if (d6 >= 0.0f && d5 <= d6) {
+        return keep1(C);
+    }
+
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+        return keep2(A, C, d2 / (d2 - d6));
+    }
+
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+        return keep2(B, C, (d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    }
+
+    float denominator = va + vb + vc;
+    if (denominator <= FLT_MIN) {
+        // collinear, one of the edges is closest
+        Simplex edges[3];
+        edges[0].vertices[0] = A, edges[0].vertices[1] = B;
+        edges[1].vertices[0] = A, edges[1].vertices[1] = C;
+        edges[2].vertices[0] = B, edges[2].vertices[1] = C;
+
+        int   best         = 0;
+        float bestDistance = FLT_MAX;
+        for (int i = 0; i < 3; i++) {
+            edges[i].count = 2;
+            solve_segment(edges[i]);
+            glm::vec3 point = edges[i].closest();
+            if (glm::dot(point, point) < bestDistance) {
+                bestDistance = glm::dot(point, point);
+                best         = i;
+            }
+        }
+        simplex = edges[best];
+        return;
+    }
+
+    float v = vb / denominator, w = vc / denominator;
+    simplex.vertices[0].weight = 1.0f - v - w;
+    simplex.vertices[1].weight = v;
+    simplex.vertices[2].weight = w;
+    simplex.count              = 3;
+}
+
+// returns true when the origin is inside the tetrahedron
+static bool solve_tetrahedron(Simplex &simplex) {
+    const SimplexVertex *v = simplex.vertices;
+
+    // each face with the vertex it does not touch
+    static const int faces[4][4] = {{0, 1, 2, 3}, {0, 2, 3, 1}, {0, 3, 1, 2}, {1, 3, 2, 0}};
+
+    Simplex best;
+    float   bestDistance = FLT_MAX;
+    bool    outside      = false;
+
+    for (const auto &face : faces) {
+        glm::vec3 a      = v[face[0]].w;
+        glm::vec3 normal = glm::cross(v[face[1]].w - a, v[face[2]].w - a);
+        float     origin = -glm::dot(normal, a);
+        float     other  = glm::dot(normal, v[face[3]].w - a);
+        if (origin * other >= 0.0f) {
+            continue;
+        }
+
+        outside = true;
+        Simplex triangle;
+        triangle.vertices[0] = v[face[0]];
+        triangle.vertices[1] = v[face[1]];
+        triangle.vertices[2] = v[face[2]];
+        triangle.count       = 3;
+        solve_triangle(triangle);
+
+        glm::vec3 point = triangle.closest();
+        if (glm::dot(point, point) < bestDistance) {
+            bestDistance = glm::dot(point, point);
+            best         = triangle;
+        }
+    }
+
+    if (!outside) {
+        return true;
+    }
+    simplex = best;
+    return false;
+}
+
+/*GJK*/
+
+struct GJKResult {
+    Simplex   simplex;
+    glm::vec3 closest;
+    uint32_t  iterations;
+    bool      overlap;
+};
+
+static GJKResult gjk(const ConvexShape &a, const ConvexShape &b, const SimplexCache *cache) {
+    GJKResult result;
+    Simplex  &simplex = result.simplex;
+
+    if (cache && cache->count > 0) {
+        // support points along the old directions, duplicates happen when the shapes turned
+        for (uint32_t i = 0; i < cache->count; i++) {
+            SimplexVertex vertex    = support(a, b, cache->directions[i]);
+            bool          duplicate = false;
+            for (uint32_t j = 0; j < simplex.count; j++) {
+                glm::vec3 offset = simplex.vertices[j].w - vertex.w;
+                duplicate        = duplicate || glm::dot(offset, offset) < GJK_OVERLAP;
+            }
+            if (!duplicate) {
+                simplex.vertices[simplex.count++] = vertex;
+            }
+        }
+    } else {
+        glm::vec3 direction = b.center - a.center;
+        if (glm::dot(direction, direction) < GJK_OVERLAP) {
+            direction = glm::vec3(1.0f, 0.0f, 0.0f);
+        }
+        simplex.vertices[simplex.count++] = support(a, b, -direction);
+    }
+
+    result.overlap    = false;
+    result.iterations = 0;
+
+    for (; result.iterations < GJK_MAX_ITERATIONS; result.iterations++) {
+        switch (simplex.count) {
+        case 1:
+            simplex.vertices[0].weight = 1.0f;
+            break;
+        case 2:
+            solve_segment(simplex);
+            break;
+        case 3:
+            solve_triangle(simplex);
+            break;
+        case 4:
+            result.overlap = solve_tetrahedron(simplex);
+            break;
+        }
+
+        result.closest = simplex.closest();
+        float distance = glm::dot(result.closest, result.closest);
+        if (result.overlap || distance < GJK_OVERLAP) {
+            result.overlap = true;
+            return result;
+        }
+
+        SimplexVertex vertex = support(a, b, -result.closest);
+
+        // no vertex further along -closest than the closest point itself, it is the minimum
+        if (distance - glm::dot(result.closest, vertex.w) <= GJK_TOLERANCE * distance) {
+            break;
+        }
+
+        bool duplicate = false;
+        for (uint32_t i = 0; i < simplex.count; i++) {
+            glm::vec3 offset = simplex.vertices[i].w - vertex.w;
+            duplicate        = duplicate || glm::dot(offset, offset) < GJK_OVERLAP;
+        }
+        if (duplicate) {
+            break;
+        }
+
+        // a flat tetrahedron can't be solved, the triangle is as close as it gets
+        if (simplex.count == 3) {
+            glm::vec3 normal = glm::cross(simplex.vertices[1].w - simplex.vertices[0].w, simplex.vertices[2].w - simplex.vertices[0].w);
+            if (std::fabs(glm::dot(normal, vertex.w - simplex.vertices[0].w)) <= GJK_TOLERANCE * glm::dot(normal, normal)) {
+                break;
+            }
+        }
+
+        simplex.vertices[simplex.count++] = vertex;
+    }
+    return result;
+}
+
+/*EPA*/
+
+struct EPAFace {
+    uint8_t   indices[3];
+    glm::vec3 normal;
+    float     distance;
+};
+
+static bool make_face(const SimplexVertex *vertices, uint8_t i0, uint8_t i1, uint8_t i2, EPAFace &face) {
+    glm::vec3 normal = glm::cross(vertices[i1].w - vertices[i0].w, vertices[i2].w - vertices[i0].w);
+    float     length = glm::length(normal);
+
+    face.indices[0] = i0;
+    face.indices[1] = i1;
+    face.indices[2] = i2;
+    if (length < 1e-12f) {
+        // sliver, never picked as the closest face
+        face.normal   = glm::vec3(0.0f);
+        face.distance = FLT_MAX;
+        return false;
+    }
+    face.normal   = normal / length;
+    face.distance = glm::dot(face.normal, vertices[i0].w);
+    return true;
+}
+
+// grows a simplex touching the origin into a tetrahedron around it
+static bool blow_up(const ConvexShape &a, const ConvexShape &b, Simplex &simplex) {
+    static const glm::vec3 axes[6] = {glm::vec3(1, 0, 0), glm::vec3(-1, 0, 0), glm::vec3(0, 1, 0), glm::vec3(0, -1, 0), glm::vec3(0, 0, 1), glm::vec3(0, 0, -1)};
+
+    if (simplex.count == 1) {
+        for (glm::vec3 axis : axes) {
+            SimplexVertex vertex = support_with_radius(a, b, axis);
+            glm::vec3     offset = vertex.w - simplex.vertices[0].w;
+            if (glm::dot(offset, offset) > 1e-8f) {
+                simplex.vertices[simplex.count++] = vertex;
+                break;
+            }
+        }
+    }
+
+    if (simplex.count == 2) {
+        glm::vec3 line   = simplex.vertices[1].w - simplex.vertices[0].w;
+        glm::vec3 side   = std::fabs(line.x) < 0.57735f ? glm::vec3(1, 0, 0) : glm::vec3(0, 1, 0);
+        glm::vec3 first  = glm::cross(line, side);
+        glm::vec3 second = glm::cross(line, first);
+        for (glm::vec3 direction : {first, -first, second, -second}) {
+            SimplexVertex vertex = support_with_radius(a, b, direction);
+            glm::vec3     normal = glm::cross(line, vertex.w - simplex.vertices[0].w);
+            if (glm::dot(normal, normal) > 1e-8f * glm::dot(line, line)) {
+                simplex.vertices[simplex.count++] = vertex;
+                break;
+            }
+        }
+    }
+
+    if (simplex.count == 3) {
+        glm::vec3 normal = glm::cross(simplex.vertices[1].w - simplex.vertices[0].w, simplex.vertices[2].w - simplex.vertices[0].w);
+        for (glm::vec3 direction : {normal, -normal}) {
+            SimplexVertex vertex = support_with_radius(a, b, direction);
+            if (std::fabs(glm::dot(normal, vertex.w - simplex.vertices[0].w)) > 1e-6f * glm::length(normal)) {
+                simplex.vertices[simplex.count++] = vertex;
+                break;
+            }
+        }
+    }
+
+    return simplex.count == 4;
+}
+
+static void epa(const ConvexShape &a, const ConvexShape &b, Simplex simplex, DistanceResult &result) {
+    if (!blow_up(a, b, simplex)) {
+        // flat shapes touching, no depth to measure
+        glm::vec3 offset = b.center - a.center;
+        result.distance  = 0.0f;
+        result.normal    = glm::dot(offset, offset) > GJK_OVERLAP ? glm::normalize(offset) : glm::vec3(0.0f, 1.0f, 0.0f);
+        result.pointA    = simplex.vertices[0].a;
+        result.pointB    = simplex.vertices[0].b;
+        return;
+    }
+
+    SimplexVertex vertices[EPA_MAX_VERTICES];
+    EPAFace       faces[EPA_MAX_FACES];
+    uint32_t      vertexCount = 4;
+    uint32_t      faceCount   = 0;
+
+    for (uint32_t i = 0; i < 4; i++) {
+        vertices[i] = simplex.vertices[i];
+    }
+
+    // wind the tetrahedron so every face points away from the opposite vertex
+    glm::vec3 n = glm::cross(vertices[1].w - vertices[0].w, vertices[2].w - vertices[0].w);
+    if (glm::dot(n, vertices[3].w - vertices[0].w) > 0.0f) {
+        std::swap(vertices[1], vertices[2]);
+    }
+    make_face(vertices, 0, 1, 2, faces[faceCount++]);
+    make_face(vertices, 0, 3, 1, faces[faceCount++]);
+    make_face(vertices, 0, 2, 3, faces[faceCount++]);
+    make_face(vertices, 1, 3, 2, faces[faceCount++]);
+
+    auto closest_face = [&]() {
+        uint32_t closest = 0;
+        for (uint32_t i = 1; i < faceCount; i++) {
+            if (faces[i].distance < faces[closest].distance) {
+                closest = i;
+            }
+        }
+        return faces[closest];
+    };
+
+    // a copy, splitting moves and overwrites faces. When the split has to be given up the face from
+    // before it is still on the polytope
+    EPAFace face = closest_face();
+    for (uint32_t iteration = 0; iteration < EPA_MAX_ITERATIONS; iteration++) {
+        result.iterations++;
+
+        SimplexVertex vertex = support_with_radius(a, b, face.normal);
+        if (glm::dot(vertex.w, face.normal) - face.distance < EPA_TOLERANCE || vertexCount == EPA_MAX_VERTICES) {
+            break;
+        }
+
+        // remove every face the new vertex can see and keep the edges of the hole
+        uint8_t  edges[EPA_MAX_FACES * 3][2];
+        uint32_t edgeCount = 0;
+        for (uint32_t i = 0; i < faceCount;) {
+            if (glm::dot(faces[i].normal, vertex.w - vertices[faces[i].indices[0]].w) <= 0.0f) {
+                i++;
+                continue;
+            }
+
+            for (int e = 0; e < 3; e++) {
+                uint8_t from = faces[i].indices[e], to = faces[i].indices[(e + 1) % 3];
+
+                // an edge shared with another removed face is inside the hole
+                bool shared = false;
+                for (uint32_t k = 0; k < edgeCount; k++) {
+                    if (edges[k][0] == to && edges[k][1] == from) {
+                        edges[k][0] = edges[--edgeCount][0];
+                        edges[k][1] = edges[edgeCount][1];
+                        shared      = true;
+                        break;
+                    }
+                }
+                if (!shared) {
+                    edges[edgeCount][0]   = from;
+                    edges[edgeCount++][1] = to;
+                }
+            }
+            faces[i] = faces[--faceCount];
+        }
+
+        if (faceCount + edgeCount > EPA_MAX_FACES) {
+            break;
+        }
+
+        uint8_t index           = (uint8_t)vertexCount;
+        vertices[vertexCount++] = vertex;
+        for (uint32_t k = 0; k < edgeCount; k++) {
+            make_face(vertices, edges[k][0], edges[k][1], index, faces[faceCount++]);
+        }
+        face = closest_face();
+    }
+
+    // barycentric coordinates of the origin projected on the closest face give the witness points
+    const SimplexVertex &v0 = vertices[face.indices[0]], &v1 = vertices[face.indices[1]], &v2 = vertices[face.indices[2]];
+    glm::vec3            p  = face.normal * face.distance;
+    glm::vec3            e0 = v1.w - v0.w, e1 = v2.w - v0.w, e2 = p - v0.w;
+
+    float d00 = glm::dot(e0, e0), d01 = glm::dot(e0, e1), d11 = glm::dot(e1, e1);
+    float d20 = glm::dot(e2, e0), d21 = glm::dot(e2, e1);
+    float denominator = d00 * d11 - d01 * d01;
+    float v           = denominator > FLT_MIN ? (d11 * d20 - d01 * d21) / denominator : 0.0f;
+    float w           = denominator > FLT_MIN ? (d00 * d21 - d01 * d20) / denominator : 0.0f;
+    float u           = 1.0f - v - w;
+
+    // the face normal points the way B has to move out of A
+    result.distance = -face.distance;
+    result.normal   = face.normal;
+    result.pointA   = v0.a * u + v1.a * v + v2.a * w;
+    result.pointB   = v0.b * u + v1.b * v + v2.b * w;
+}
+
+/*Queries*/
+
+DistanceResult closest_points(const ConvexShape &a, const ConvexShape &b, SimplexCache *cache) {
+    DistanceResult result;
+    if ((a.type == ShapeType::Hull && a.hull->points.empty()) || (b.type == ShapeType::Hull && b.hull->points.empty())) {
+        result.distance   = FLT_MAX;
+        result.normal     = glm::vec3(0.0f, 1.0f, 0.0f);
+        result.pointA     = a.center;
+        result.pointB     = b.center;
+        result.iterations = 0;
+        return result;
+    }
+
+    GJKResult gjkResult = gjk(a, b, cache);
+    result.iterations = gjkResult.iterations + 1;
+
+    if (cache) {
+        cache->count = std::min(gjkResult.simplex.count, 3u);
+        for (uint32_t i = 0; i < cache->count; i++) {
+            cache->directions[i] = gjkResult.simplex.vertices[i].direction;
+        }
+    }
+
+    float radius = a.radius + b.radius;
+    if (!gjkResult.overlap) {
+        glm::vec3 pointA(0.0f), pointB(0.0f);
+        for (uint32_t i = 0; i < gjkResult.simplex.count; i++) {
+            pointA += gjkResult.simplex.vertices[i].a * gjkResult.simplex.vertices[i].weight;
+            pointB += gjkResult.simplex.vertices[i].b * gjkResult.simplex.vertices[i].weight;
+        }
+
+        float distance = glm::length(gjkResult.closest);
+
+        // the inner shapes are apart, the radius may still make them overlap but the normal holds
+        result.normal   = -gjkResult.closest / distance;
+        result.distance = distance - radius;
+        result.pointA   = pointA + result.normal * a.radius;
+        result.pointB   = pointB - result.normal * b.radius;
+        return result;
+    }
+
+    epa(a, b, gjkResult.simplex, result);
+    return result;
+}
+
+void closest_points(const std::vector<DistanceQuery> &queries, std::vector<DistanceResult> &results, JobSystem &jobs, uint32_t queriesPerJob) {
+    results.resize(queries.size());
+    jobs.parallel_for((uint32_t)queries.size(), queriesPerJob, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            results[i] = closest_points(queries[i].a, queries[i].b, queries[i].cache);
+        }
+    });
+}
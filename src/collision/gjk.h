@@ -0,0 +1,68 @@
+#pragma once
+
+#include "../core/job_system.h"
+#include "obb.h"
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Vertices of a mesh, used as the convex hull around them. Support points only need the extreme
+// vertex so the faces are never built.
+struct ConvexHull {
+    std::vector<glm::vec3> points;
+
+    // positions in mesh space, duplicates are removed
+    void      build(const std::vector<glm::vec3> &positions);
+    glm::vec3 support(glm::vec3 direction) const;
+};
+
+enum class ShapeType : uint8_t { Sphere, Box, Capsule, Hull };
+
+// Convex shape in world space. Spheres and capsules are a point and a segment grown by radius, GJK
+// runs on the point/segment and the radius is added to the result.
+struct ConvexShape {
+    ShapeType         type;
+    glm::vec3         center;
+    glm::mat3         axes        = glm::mat3(1.0f);
+    glm::vec3         halfExtents = glm::vec3(0.0f); // box, halfExtents.y is half the segment of a capsule
+    float             radius      = 0.0f;
+    const ConvexHull *hull        = nullptr; // in the space of axes around center
+
+    static ConvexShape sphere(glm::vec3 center, float radius);
+    static ConvexShape box(const OBB &box);
+    // segment along axes[1]
+    static ConvexShape capsule(glm::vec3 center, const glm::mat3 &axes, float halfHeight, float radius);
+    static ConvexShape convex_hull(const ConvexHull *hull, glm::vec3 center, const glm::mat3 &axes = glm::mat3(1.0f));
+
+    // furthest point along direction without the radius
+    glm::vec3 support(glm::vec3 direction) const;
+};
+
+// Directions that found the simplex of the last query between the same two shapes. The next query
+// starts from the support points along them, a pair that barely moved is done in one or two iterations.
+struct SimplexCache {
+    uint32_t  count = 0;
+    glm::vec3 directions[3];
+};
+
+struct DistanceResult {
+    float     distance;   // negative is the penetration depth
+    glm::vec3 normal;     // from A to B
+    glm::vec3 pointA;     // closest point on A, deepest point when penetrating
+    glm::vec3 pointB;
+    uint32_t  iterations; // GJK iterations, plus EPA iterations when penetrating
+};
+
+// GJK distance between two convex shapes, EPA when they overlap. cache is read and updated when given.
+// A hull without points touches nothing, the distance is FLT_MAX.
+DistanceResult closest_points(const ConvexShape &a, const ConvexShape &b, SimplexCache *cache = nullptr);
+
+struct DistanceQuery {
+    ConvexShape   a;
+    ConvexShape   b;
+    SimplexCache *cache = nullptr; // owned by the caller, kept between frames
+};
+
+// runs closest_points for every query over the job system, results[i] belongs to queries[i]
+void closest_points(const std::vector<DistanceQuery> &queries, std::vector<DistanceResult> &results, JobSystem &jobs, uint32_t queriesPerJob = 64);
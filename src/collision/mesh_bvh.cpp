@@ -0,0 +1,547 @@
+#include "mesh_bvh.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+const uint32_t MAX_LEAF_TRIANGLES = 4;
+const uint32_t SAH_BINS           = 12;
+const uint32_t MAX_TREE_DEPTH     = 60; // keeps the fixed traversal stacks below from overflowing
+const uint32_t MAX_STACK_DEPTH    = 64;
+
+const char     BVH_FILE_MAGIC[4] = {'B', 'V', 'H', 'C'};
+const uint32_t BVH_FILE_VERSION  = 1;
+
+struct BVHFileHeader {
+    char     magic[4];
+    uint32_t version;
+    uint64_t sourceSize; // size and write time of the obj the cache was built from
+    int64_t  sourceTime;
+    uint32_t nodeCount;
+    uint32_t triangleCount;
+};
+
+/*Build*/
+
+static float surface_area(const AABB &box) {
+    glm::vec3 size = box.max - box.min;
+    return 2.0f * (size.x * size.y + size.y * size.z + size.z * size.x);
+}
+
+static AABB empty_box() { return AABB{glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX)}; }
+
+static void grow(AABB &box, const AABB &other) {
+    box.min = glm::min(box.min, other.min);
+    box.max = glm::max(box.max, other.max);
+}
+
+static void grow(AABB &box, glm::vec3 point) {
+    box.min = glm::min(box.min, point);
+    box.max = glm::max(box.max, point);
+}
+
+static AABB triangle_bounds(const MeshTriangle &triangle) { return AABB{glm::min(triangle.v0, glm::min(triangle.v1, triangle.v2)), glm::max(triangle.v0, glm::max(triangle.v1, triangle.v2))}; }
+
+static void set_bounds(BVHNode &node, const AABB &box) {
+    for (int i = 0; i < 3; i++) {
+        node.min[i] = box.min[i];
+        node.max[i] = box.max[i];
+    }
+}
+
+void MeshBVH::build(const std::vector<glm::vec3> &positions) {
+    uint32_t triangleCount = (uint32_t)(positions.size() / 3);
+
+    _nodes.clear();
+    _triangles.clear();
+    if (triangleCount == 0) {
+        return;
+    }
+
+    std::vector<AABB>      bounds(triangleCount);
+    std::vector<glm::vec3> centroids(triangleCount);
+    std::vector<uint32_t>  order(triangleCount);
+    for (uint32_t i = 0; i < triangleCount; i++) {
+        MeshTriangle triangle{positions[i * 3], positions[i * 3 + 1], positions[i * 3 + 2]};
+        bounds[i]    = triangle_bounds(triangle);
+        centroids[i] = bounds[i].center();
+        order[i]     = i;
+    }
+
+    _nodes.reserve(triangleCount * 2);
+    _nodes.push_back(BVHNode{{0, 0, 0}, 0, {0, 0, 0}, triangleCount});
+
+    uint32_t stack[MAX_STACK_DEPTH];
+    uint32_t depths[MAX_STACK_DEPTH];
+    uint32_t stackSize = 0;
+    stack[stackSize]    = 0;
+    depths[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        stackSize--;
+        uint32_t nodeIndex = stack[stackSize];
+        uint32_t depth     = depths[stackSize];
+        uint32_t first     = _nodes[nodeIndex].leftOrFirst;
+        uint32_t count     = _nodes[nodeIndex].count;
+
+        AABB nodeBox = empty_box(), centroidBox = empty_box();
+        for (uint32_t i = first; i < first + count; i++) {
+            grow(nodeBox, bounds[order[i]]);
+            grow(centroidBox, centroids[order[i]]);
+        }
+        set_bounds(_nodes[nodeIndex], nodeBox);
+
+        if (count <= MAX_LEAF_TRIANGLES || depth >= MAX_TREE_DEPTH) {
+            continue;
+        }
+
+        // binned surface area heuristic over the centroids
+        int   bestAxis  = -1;
+        float bestSplit = 0.0f;
+        float bestCost  = (float)count * surface_area(nodeBox);
+
+        for (int axis = 0; axis < 3; axis++) {
+            float extent = centroidBox.max[axis] - centroidBox.min[axis];
+            if (extent <= 0.0f) {
+                continue;
+            }
+
+            AABB     binBox[SAH_BINS];
+            uint32_t binCount[SAH_BINS] = {};
+            for (uint32_t b = 0; b < SAH_BINS; b++) {
+                binBox[b] = empty_box();
+            }
+
+            float scale = SAH_BINS / extent;
+            for (uint32_t i = first; i < first + count; i++) {
+                uint32_t b = std::min(SAH_BINS - 1, (uint32_t)((centroids[order[i]][axis] - centroidBox.min[axis]) * scale));
+                binCount[b]++;
+                grow(binBox[b], bounds[order[i]]);
+            }
+
+            // cost of splitting after bin b, swept from both sides
+            float    leftArea[SAH_BINS - 1];
+            uint32_t leftCount[SAH_BINS - 1];
+            AABB     box   = empty_box();
+            uint32_t total = 0;
+            for (uint32_t b = 0; b < SAH_BINS - 1; b++) {
+                grow(box, binBox[b]);
+                total += binCount[b];
+                leftArea[b]  = total > 0 ? surface_area(box) : 0.0f;
+                leftCount[b] = total;
+            }
+
+            box   = empty_box();
+            total = 0;
+            for (uint32_t b = SAH_BINS - 1; b > 0; b--) {
+                grow(box, binBox[b]);
+                total += binCount[b];
+
+                float cost = leftArea[b - 1] * leftCount[b - 1] + (total > 0 ? surface_area(box) * total : 0.0f);
+                if (leftCount[b - 1] > 0 && total > 0 && cost < bestCost) {
+                    bestCost  = cost;
+                    bestAxis  = axis;
+                    bestSplit = centroidBox.min[axis] + b / scale;
+                }
+            }
+        }
+
+        if (bestAxis < 0) {
+            continue;
+        }
+
+        uint32_t *middle    = std::partition(order.data() + first, order.data() + first + count, [&](uint32_t triangle) { return centroids[triangle][bestAxis] < bestSplit; });
+        uint32_t  leftCount = (uint32_t)(middle - (order.data() + first));
+        if (leftCount == 0 || leftCount == count) {
+            continue;
+        }
+
+        uint32_t left = (uint32_t)_nodes.size();
+        _nodes.push_back(BVHNode{{0, 0, 0}, first, {0, 0, 0}, leftCount});
+        _nodes.push_back(BVHNode{{0, 0, 0}, first + leftCount, {0, 0, 0}, count - leftCount});
+
+        _nodes[nodeIndex].leftOrFirst = left;
+        _nodes[nodeIndex].count       = 0;
+
+        stack[stackSize]    = left;
+        depths[stackSize++] = depth + 1;
+        stack[stackSize]    = left + 1;
+        depths[stackSize++] = depth + 1;
+    }
+
+    _triangles.resize(triangleCount);
+    for (uint32_t i = 0; i < triangleCount; i++) {
+        uint32_t source = order[i];
+        _triangles[i]   = MeshTriangle{positions[source * 3], positions[source * 3 + 1], positions[source * 3 + 2]};
+    }
+}
+
+/*Queries*/
+
+// distance where the ray enters the node, FLT_MAX when it misses or is further than maxDistance
+static float intersect_node(const BVHNode &node, glm::vec3 origin, glm::vec3 inverseDirection, float maxDistance, float grow = 0.0f) {
+    float enter = 0.0f, exit = maxDistance;
+    for (int axis = 0; axis < 3; axis++) {
+        float t0 = (node.min[axis] - grow - origin[axis]) * inverseDirection[axis];
+        float t1 = (node.max[axis] + grow - origin[axis]) * inverseDirection[axis];
+        enter    = std::max(enter, std::min(t0, t1));
+        exit     = std::min(exit, std::max(t0, t1));
+    }
+    return enter <= exit ? enter : FLT_MAX;
+}
+
+// Moller-Trumbore, both sides
+static bool intersect_triangle(const MeshTriangle &triangle, glm::vec3 origin, glm::vec3 direction, float &distance) {
+    glm::vec3 edge1 = triangle.v1 - triangle.v0;
+    glm::vec3 edge2 = triangle.v2 - triangle.v0;
+    glm::vec3 p     = glm::cross(direction, edge2);
+    float     det   = glm::dot(edge1, p);
+    if (std::fabs(det) < 1e-9f) {
+        return false;
+    }
+
+    float     inverseDet = 1.0f / det;
+    glm::vec3 s          = origin - triangle.v0;
+    float     u          = glm::dot(s, p) * inverseDet;
+    if (u < 0.0f || u > 1.0f) {
+        return false;
+    }
+
+    glm::vec3 q = glm::cross(s, edge1);
+    float     v = glm::dot(direction, q) * inverseDet;
+    if (v < 0.0f || u + v > 1.0f) {
+        return false;
+    }
+
+    distance = glm::dot(edge2, q) * inverseDet;
+    return distance >= 0.0f;
+}
+
+static glm::vec3 facing_normal(const MeshTriangle &triangle, glm::vec3 direction) {
+    glm::vec3 normal = glm::normalize(glm::cross(triangle.v1 - triangle.v0, triangle.v2 - triangle.v0));
+    return glm::dot(normal, direction) > 0.0f ? -normal : normal;
+}
+
+// visits the leaves the ray (grown by radius) passes, nearest child first. testLeaf returns the new
+// maxDistance after testing the triangles of a leaf.
+template <typename Fn> static void traverse_ray(const std::vector<BVHNode> &nodes, glm::vec3 origin, glm::vec3 direction, float &maxDistance, float radius, Fn &&testLeaf) {
+    if (nodes.empty()) {
+        return;
+    }
+
+    glm::vec3 inverseDirection = 1.0f / direction;
+    uint32_t  stack[MAX_STACK_DEPTH];
+    uint32_t  stackSize = 0;
+
+    if (intersect_node(nodes[0], origin, inverseDirection, maxDistance, radius) != FLT_MAX) {
+        stack[stackSize++] = 0;
+    }
+
+    while (stackSize > 0) {
+        const BVHNode &node = nodes[stack[--stackSize]];
+        if (node.count > 0) {
+            testLeaf(node.leftOrFirst, node.count);
+            continue;
+        }
+
+        uint32_t left      = node.leftOrFirst;
+        float    leftDist  = intersect_node(nodes[left], origin, inverseDirection, maxDistance, radius);
+        float    rightDist = intersect_node(nodes[left + 1], origin, inverseDirection, maxDistance, radius);
+
+        uint32_t nearChild = left, farChild = left + 1;
+        if (rightDist < leftDist) {
+            std::swap(leftDist, rightDist);
+            std::swap(nearChild, farChild);
+        }
+        if (rightDist != FLT_MAX) {
+            stack[stackSize++] = farChild;
+        }
+        if (leftDist != FLT_MAX) {
+            stack[stackSize++] = nearChild;
+        }
+    }
+}
+
+bool MeshBVH::raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, MeshHit &hit) const {
+    bool found = false;
+
+    traverse_ray(_nodes, origin, direction, maxDistance, 0.0f, [&](uint32_t first, uint32_t count) {
+        for (uint32_t i = first; i < first + count; i++) {
+            float distance;
+            if (intersect_triangle(_triangles[i], origin, direction, distance) && distance < maxDistance) {
+                maxDistance  = distance;
+                hit.distance = distance;
+                hit.triangle = i;
+                hit.normal   = facing_normal(_triangles[i], direction);
+                found        = true;
+            }
+        }
+    });
+    return found;
+}
+
+static glm::vec3 closest_point_on_triangle(const MeshTriangle &triangle, glm::vec3 point) {
+    glm::vec3 ab = triangle.v1 - triangle.v0, ac = triangle.v2 - triangle.v0, ap = point - triangle.v0;
+
+    float d1 = glm::dot(ab, ap), d2 = glm::dot(ac, ap);
+    if (d1 <= 0.0f && d2 <= 0.0f) {
+        return triangle.v0;
+    }
+
+    glm::vec3 bp = point - triangle.v1;
+    float     d3 = glm::dot(ab, bp), d4 = glm::dot(ac, bp);
+    if (d3 >= 0.0f && d4 <= d3) {
+        return triangle.v1;
+    }
+
+    float vc = d1 * d4 - d3 * d2;
+    if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+        return triangle.v0 + ab * (d1 / (d1 - d3));
+    }
+
+    glm::vec3 cp = point - triangle.v2;
+    float     d5 = glm::dot(ab, cp), d6 = glm::dot(ac, cp);
+    if (d6 >= 0.0f && d5 <= d6) {
+        return triangle.v2;
+    }
+
+    float vb = d5 * d2 - d1 * d6;
+    if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+        return triangle.v0 + ac * (d2 / (d2 - d6));
+    }
+
+    float va = d3 * d6 - d5 * d4;
+    if (va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f) {
+        return triangle.v1 + (triangle.v2 - triangle.v1) * ((d4 - d3) / ((d4 - d3) + (d5 - d6)));
+    }
+
+    float denom = 1.0f / (va + vb + vc);
+    return triangle.v0 + ab * (vb * denom) + ac * (vc * denom);
+}
+
+// sphere moving along a normalized direction against the face, the three edges and the three corners
+static bool sweep_sphere_triangle(const MeshTriangle &triangle, glm::vec3 origin, float radius, glm::vec3 direction, float maxDistance, float &distance, glm::vec3 &normal) {
+    glm::vec3 closest = closest_point_on_triangle(triangle, origin);
+    if (glm::dot(origin - closest, origin - closest) <= radius * radius) {
+        distance = 0.0f;
+        normal   = origin != closest ? glm::normalize(origin - closest) : facing_normal(triangle, direction);
+        return true;
+    }
+
+    float best = maxDistance;
+    bool  hit  = false;
+
+    // face
+    glm::vec3 faceNormal = glm::normalize(glm::cross(triangle.v1 - triangle.v0, triangle.v2 - triangle.v0));
+    float     height     = glm::dot(origin - triangle.v0, faceNormal);
+    if (height < 0.0f) {
+        faceNormal = -faceNormal;
+        height     = -height;
+    }
+    float approach = glm::dot(direction, faceNormal);
+    if (approach < 0.0f) {
+        float t = (height - radius) / -approach;
+        if (t >= 0.0f && t < best) {
+            glm::vec3 contact = origin + direction * t - faceNormal * radius;
+            glm::vec3 offset  = closest_point_on_triangle(triangle, contact) - contact;
+            if (glm::dot(offset, offset) < 1e-8f) {
+                best   = t;
+                normal = faceNormal;
+                hit    = true;
+            }
+        }
+    }
+
+    // edges as cylinders
+    const glm::vec3 corners[] = {triangle.v0, triangle.v1, triangle.v2};
+    for (int i = 0; i < 3; i++) {
+        glm::vec3 a = corners[i], ba = corners[(i + 1) % 3] - a, oa = origin - a;
+
+        float baba = glm::dot(ba, ba), bard = glm::dot(ba, direction), baoa = glm::dot(ba, oa);
+        float rdoa = glm::dot(direction, oa), oaoa = glm::dot(oa, oa);
+
+        float k2 = baba - bard * bard;
+        float k1 = baba * rdoa - baoa * bard;
+        float k0 = baba * oaoa - baoa * baoa - radius * radius * baba;
+        float h  = k1 * k1 - k2 * k0;
+        if (k2 < 1e-9f || h < 0.0f) {
+            continue;
+        }
+
+        float t = (-k1 - std::sqrt(h)) / k2;
+        float y = baoa + t * bard;
+        if (t >= 0.0f && t < best && y > 0.0f && y < baba) {
+            best   = t;
+            normal = glm::normalize(origin + direction * t - (a + ba * (y / baba)));
+            hit    = true;
+        }
+    }
+
+    // corners as spheres
+    for (glm::vec3 corner : corners) {
+        glm::vec3 oc = origin - corner;
+        float     b  = glm::dot(oc, direction);
+        float     c  = glm::dot(oc, oc) - radius * radius;
+        float     h  = b * b - c;
+        if (h < 0.0f) {
+            continue;
+        }
+
+        float t = -b - std::sqrt(h);
+        if (t >= 0.0f && t < best) {
+            best   = t;
+            normal = glm::normalize(oc + direction * t);
+            hit    = true;
+        }
+    }
+
+    distance = best;
+    return hit;
+}
+
+bool MeshBVH::sphere_sweep(glm::vec3 origin, float radius, glm::vec3 direction, float maxDistance, MeshHit &hit) const {
+    bool found = false;
+
+    traverse_ray(_nodes, origin, direction, maxDistance, radius, [&](uint32_t first, uint32_t count) {
+        for (uint32_t i = first; i < first + count; i++) {
+            float     distance;
+            glm::vec3 normal;
+            if (sweep_sphere_triangle(_triangles[i], origin, radius, direction, maxDistance, distance, normal) && distance < maxDistance) {
+                maxDistance  = distance;
+                hit.distance = distance;
+                hit.triangle = i;
+                hit.normal   = normal;
+                found        = true;
+            }
+        }
+    });
+    return found;
+}
+
+// separating axis test between the triangle and a box centered at the origin
+static bool triangle_overlaps_box(const MeshTriangle &triangle, glm::vec3 center, glm::vec3 halfSize) {
+    glm::vec3 v[3]    = {triangle.v0 - center, triangle.v1 - center, triangle.v2 - center};
+    glm::vec3 edges[] = {v[1] - v[0], v[2] - v[1], v[0] - v[2]};
+
+    auto separated = [&](glm::vec3 axis) {
+        float p0 = glm::dot(v[0], axis), p1 = glm::dot(v[1], axis), p2 = glm::dot(v[2], axis);
+        float r  = glm::dot(halfSize, glm::abs(axis));
+        return std::min(p0, std::min(p1, p2)) > r || std::max(p0, std::max(p1, p2)) < -r;
+    };
+
+    for (int axis = 0; axis < 3; axis++) {
+        glm::vec3 unit(0.0f);
+        unit[axis] = 1.0f;
+        if (separated(unit)) {
+            return false;
+        }
+
+        for (glm::vec3 edge : edges) {
+            glm::vec3 cross = glm::cross(edge, unit);
+            if (glm::dot(cross, cross) > 1e-12f && separated(cross)) {
+                return false;
+            }
+        }
+    }
+    return !separated(glm::cross(edges[0], edges[1]));
+}
+
+void MeshBVH::query_aabb(const AABB &box, std::vector<uint32_t> &triangles) const {
+    triangles.clear();
+    if (_nodes.empty()) {
+        return;
+    }
+
+    glm::vec3 center = box.center(), halfSize = box.extents();
+
+    uint32_t stack[MAX_STACK_DEPTH];
+    uint32_t stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        const BVHNode &node = _nodes[stack[--stackSize]];
+
+        AABB nodeBox{glm::vec3(node.min[0], node.min[1], node.min[2]), glm::vec3(node.max[0], node.max[1], node.max[2])};
+        if (!nodeBox.overlaps(box)) {
+            continue;
+        }
+
+        if (node.count == 0) {
+            stack[stackSize++] = node.leftOrFirst;
+            stack[stackSize++] = node.leftOrFirst + 1;
+            continue;
+        }
+
+        for (uint32_t i = node.leftOrFirst; i < node.leftOrFirst + node.count; i++) {
+            if (triangle_overlaps_box(_triangles[i], center, halfSize)) {
+                triangles.push_back(i);
+            }
+        }
+    }
+}
+
+/*Cache*/
+
+bool MeshBVH::save(const std::string &path, uint64_t sourceSize, int64_t sourceTime) const {
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    BVHFileHeader header;
+    std::memcpy(header.magic, BVH_FILE_MAGIC, sizeof(header.magic));
+    header.version       = BVH_FILE_VERSION;
+    header.sourceSize    = sourceSize;
+    header.sourceTime    = sourceTime;
+    header.nodeCount     = (uint32_t)_nodes.size();
+    header.triangleCount = (uint32_t)_triangles.size();
+
+    file.write((const char *)&header, sizeof(header));
+    file.write((const char *)_nodes.data(), sizeof(BVHNode) * _nodes.size());
+    file.write((const char *)_triangles.data(), sizeof(MeshTriangle) * _triangles.size());
+    return file.good();
+}
+
+bool MeshBVH::load(const std::string &path, uint64_t sourceSize, int64_t sourceTime) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    BVHFileHeader header;
+    file.read((char *)&header, sizeof(header));
+    if (!file || std::memcmp(header.magic, BVH_FILE_MAGIC, sizeof(header.magic)) != 0 || header.version != BVH_FILE_VERSION || header.sourceSize != sourceSize || header.sourceTime != sourceTime) {
+        return false;
+    }
+
+    _nodes.resize(header.nodeCount);
+    _triangles.resize(header.triangleCount);
+    file.read((char *)_nodes.data(), sizeof(BVHNode) * _nodes.size());
+    file.read((char *)_triangles.data(), sizeof(MeshTriangle) * _triangles.size());
+
+    if (!file) {
+        _nodes.clear();
+        _triangles.clear();
+        return false;
+    }
+    return true;
+}
+
+void MeshBVH::build_cached(const std::string &objPath, const std::vector<glm::vec3> &positions) {
+    std::error_code sizeError, timeError;
+    uint64_t        sourceSize = std::filesystem::file_size(objPath, sizeError);
+    int64_t         sourceTime = std::filesystem::last_write_time(objPath, timeError).time_since_epoch().count();
+    bool            cacheable  = !sizeError && !timeError;
+    std::string     cachePath  = objPath + ".bvh";
+
+    if (cacheable && load(cachePath, sourceSize, sourceTime) && _triangles.size() == positions.size() / 3) {
+        return;
+    }
+
+    build(positions);
+    if (cacheable) {
+        save(cachePath, sourceSize, sourceTime);
+    }
+}
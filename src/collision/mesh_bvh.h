@@ -0,0 +1,54 @@
+#pragma once
+
+#include "aabb.h"
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+
+// 32 bytes, two nodes per cache line. Children of an inner node are stored next to each other.
+struct BVHNode {
+    float    min[3];
+    uint32_t leftOrFirst; // left child for inner nodes (right is leftOrFirst + 1), first triangle for leaves
+    float    max[3];
+    uint32_t count; // triangles in the leaf, 0 for inner nodes
+};
+static_assert(sizeof(BVHNode) == 32, "BVHNode must stay 32 bytes");
+
+struct MeshTriangle {
+    glm::vec3 v0, v1, v2;
+};
+
+struct MeshHit {
+    float     distance; // along the ray, or how far the sphere moved
+    uint32_t  triangle; // index into get_triangles()
+    glm::vec3 normal;   // facing against the ray/sweep
+};
+
+// Static triangle mesh collision shape in mesh space. Triangles are reordered so each leaf owns a
+// contiguous range.
+class MeshBVH {
+  public:
+    // positions holds three vertices per triangle
+    void build(const std::vector<glm::vec3> &positions);
+
+    // loads <objPath>.bvh when it was built from the same file, builds and writes it otherwise
+    void build_cached(const std::string &objPath, const std::vector<glm::vec3> &positions);
+
+    bool raycast(glm::vec3 origin, glm::vec3 direction, float maxDistance, MeshHit &hit) const;
+    bool sphere_sweep(glm::vec3 origin, float radius, glm::vec3 direction, float maxDistance, MeshHit &hit) const;
+    // indices of the triangles touching box
+    void query_aabb(const AABB &box, std::vector<uint32_t> &triangles) const;
+
+    bool save(const std::string &path, uint64_t sourceSize, int64_t sourceTime) const;
+    bool load(const std::string &path, uint64_t sourceSize, int64_t sourceTime);
+
+    const std::vector<BVHNode>      &get_nodes() const { return _nodes; }
+    const std::vector<MeshTriangle> &get_triangles() const { return _triangles; }
+    bool                             empty() const { return _nodes.empty(); }
+
+  private:
+    std::vector<BVHNode>      _nodes;
+    std::vector<MeshTriangle> _triangles;
+};
@@ -0,0 +1,541 @@
+#include "narrow_phase.h"
+
+#include "../core/simd.h"
+
+#include <algorithm>
+#include <cfloat>
+
+using simd::float4;
+
+// faces of A are preferred over faces of B and faces over edges, unless the other axis is clearly
+// better. Keeps the normal from flipping between steps when the depths are almost the same.
+const float FACE_B_RELATIVE_TOLERANCE = 0.98f;
+const float FACE_B_ABSOLUTE_TOLERANCE = 0.001f;
+const float EDGE_RELATIVE_TOLERANCE   = 0.95f;
+const float EDGE_ABSOLUTE_TOLERANCE   = 0.01f;
+const float PARALLEL_EPSILON          = 1e-5f;
+
+// axis 0..2 are the faces of A, 3..5 the faces of B and 6..14 the edge pairs (6 + 3 * edgeA + edgeB)
+struct SatResult {
+    bool     overlap;
+    uint32_t axis;
+    float    depth;
+};
+
+// up to four pairs tested together, lane i is pair i
+struct PairBatch {
+    const OBB *a[4];
+    const OBB *b[4];
+    uint8_t    internalFaces[4]; // faces of b covered by another solid block, bit 2 * axis + (1 for the negative side)
+    uint32_t   count = 0;
+};
+
+struct ClipVertex {
+    glm::vec3 position;
+    uint8_t   edge;    // incident face edge that starts at this vertex
+    uint8_t   feature; // 0..3 for a face corner, 4 + 4 * clipPlane + edge for a clipped point
+};
+
+/*SAT*/
+
+static void consider_axis(float4 depth, float axis, float4 &bestDepth, float4 &bestAxis) {
+    float4 better = simd::less(depth, bestDepth);
+    bestDepth     = simd::select(better, depth, bestDepth);
+    bestAxis      = simd::select(better, simd::set1(axis), bestAxis);
+}
+
+static void sat_batch(const PairBatch &batch, SatResult results[4]) {
+    // transpose into lanes, unused lanes repeat the first pair
+    float axisA[3][3][4], axisB[3][3][4], extentA[3][4], extentB[3][4], offset[3][4], internalPositive[3][4], internalNegative[3][4];
+    for (uint32_t lane = 0; lane < 4; lane++) {
+        uint32_t   pair = lane < batch.count ? lane : 0;
+        const OBB &a    = *batch.a[pair];
+        const OBB &b    = *batch.b[pair];
+
+        for (int i = 0; i < 3; i++) {
+            for (int k = 0; k < 3; k++) {
+                axisA[i][k][lane] = a.axes[i][k];
+                axisB[i][k][lane] = b.axes[i][k];
+            }
+            extentA[i][lane]          = a.halfExtents[i];
+            extentB[i][lane]          = b.halfExtents[i];
+            offset[i][lane]           = b.center[i] - a.center[i];
+            internalPositive[i][lane] = (batch.internalFaces[pair] >> (i * 2)) & 1 ? 1.0f : 0.0f;
+            internalNegative[i][lane] = (batch.internalFaces[pair] >> (i * 2 + 1)) & 1 ? 1.0f : 0.0f;
+        }
+    }
+
+    float4 ea[3], eb[3], t[3], R[3][3], absR[3][3];
+    for (int i = 0; i < 3; i++) {
+        ea[i] = simd::load(extentA[i]);
+        eb[i] = simd::load(extentB[i]);
+    }
+
+    float4 A[3][3], B[3][3];
+    for (int i = 0; i < 3; i++) {
+        for (int k = 0; k < 3; k++) {
+            A[i][k] = simd::load(axisA[i][k]);
+            B[i][k] = simd::load(axisB[i][k]);
+        }
+    }
+
+    // rotation of B in the frame of A, the epsilon keeps parallel edges from giving a zero axis
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            R[i][j]    = A[i][0] * B[j][0] + A[i][1] * B[j][1] + A[i][2] * B[j][2];
+            absR[i][j] = simd::abs(R[i][j]) + simd::set1(1e-6f);
+        }
+    }
+
+    // center of B in the frame of A
+    float4 o[3] = {simd::load(offset[0]), simd::load(offset[1]), simd::load(offset[2])};
+    for (int i = 0; i < 3; i++) {
+        t[i] = o[0] * A[i][0] + o[1] * A[i][1] + o[2] * A[i][2];
+    }
+
+    float4 minDepth   = simd::set1(FLT_MAX);
+    float4 faceADepth = simd::set1(FLT_MAX), faceAAxis = simd::set1(0.0f);
+    float4 faceBDepth = simd::set1(FLT_MAX), faceBAxis = simd::set1(3.0f);
+    float4 edgeDepth  = simd::set1(FLT_MAX), edgeAxis = simd::set1(6.0f);
+
+    for (int i = 0; i < 3; i++) {
+        float4 depth = ea[i] + eb[0] * absR[i][0] + eb[1] * absR[i][1] + eb[2] * absR[i][2] - simd::abs(t[i]);
+        minDepth     = simd::min(minDepth, depth);
+        consider_axis(depth, (float)i, faceADepth, faceAAxis);
+    }
+
+    for (int j = 0; j < 3; j++) {
+        float4 distance = t[0] * R[0][j] + t[1] * R[1][j] + t[2] * R[2][j];
+        float4 depth    = ea[0] * absR[0][j] + ea[1] * absR[1][j] + ea[2] * absR[2][j] + eb[j] - simd::abs(distance);
+        minDepth        = simd::min(minDepth, depth);
+
+        // B in front of A along the axis touches with its negative face, a face covered by another
+        // block can still separate but must not become the contact normal
+        float4 positive = simd::less(simd::set1(0.0f), distance);
+        float4 internal = simd::select(positive, simd::load(internalNegative[j]), simd::load(internalPositive[j]));
+        depth           = simd::select(simd::less(simd::set1(0.5f), internal), simd::set1(FLT_MAX), depth);
+        consider_axis(depth, (float)(3 + j), faceBDepth, faceBAxis);
+    }
+
+    for (int i = 0; i < 3; i++) {
+        int i0 = (i + 1) % 3, i1 = (i + 2) % 3;
+        for (int j = 0; j < 3; j++) {
+            int j0 = (j + 1) % 3, j1 = (j + 2) % 3;
+
+            float4 ra       = ea[i0] * absR[i1][j] + ea[i1] * absR[i0][j];
+            float4 rb       = eb[j0] * absR[i][j1] + eb[j1] * absR[i][j0];
+            float4 distance = simd::abs(t[i1] * R[i0][j] - t[i0] * R[i1][j]);
+
+            // the cross product is not normalized, divide by its length to get a real distance
+            float4 length   = simd::sqrt(simd::max(simd::set1(1.0f) - R[i][j] * R[i][j], simd::set1(0.0f)));
+            float4 parallel = simd::less(length, simd::set1(PARALLEL_EPSILON));
+            float4 depth    = (ra + rb - distance) / simd::max(length, simd::set1(PARALLEL_EPSILON));
+            depth           = simd::select(parallel, simd::set1(FLT_MAX), depth);
+
+            minDepth = simd::min(minDepth, depth);
+            consider_axis(depth, (float)(6 + i * 3 + j), edgeDepth, edgeAxis);
+        }
+    }
+
+    float4 useFaceB  = simd::less(faceBDepth, faceADepth * simd::set1(FACE_B_RELATIVE_TOLERANCE) - simd::set1(FACE_B_ABSOLUTE_TOLERANCE));
+    float4 faceDepth = simd::select(useFaceB, faceBDepth, faceADepth);
+    float4 faceAxis  = simd::select(useFaceB, faceBAxis, faceAAxis);
+
+    float4 useEdge   = simd::less(edgeDepth, faceDepth * simd::set1(EDGE_RELATIVE_TOLERANCE) - simd::set1(EDGE_ABSOLUTE_TOLERANCE));
+    float4 bestDepth = simd::select(useEdge, edgeDepth, faceDepth);
+    float4 bestAxis  = simd::select(useEdge, edgeAxis, faceAxis);
+
+    int separated = simd::move_mask(simd::less(minDepth, simd::set1(-CONTACT_MARGIN)));
+
+    float depths[4], axes[4];
+    simd::store(depths, bestDepth);
+    simd::store(axes, bestAxis);
+    for (uint32_t lane = 0; lane < batch.count; lane++) {
+        // every axis can be covered by blocks when the box is buried, nothing to push it out along then
+        results[lane].overlap = !((separated >> lane) & 1) && depths[lane] != FLT_MAX;
+        results[lane].axis    = (uint32_t)axes[lane];
+        results[lane].depth   = depths[lane];
+    }
+}
+
+/*Contacts*/
+
+// Sutherland-Hodgman against dot(normal, p) <= offset
+static uint32_t clip_polygon(const ClipVertex *input, uint32_t count, glm::vec3 normal, float offset, uint32_t clipPlane, ClipVertex *output) {
+    uint32_t outputCount = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const ClipVertex &from = input[i];
+        const ClipVertex &to   = input[(i + 1) % count];
+
+        float fromDistance = glm::dot(normal, from.position) - offset;
+        float toDistance   = glm::dot(normal, to.position) - offset;
+
+        if (fromDistance <= 0.0f) {
+            output[outputCount++] = from;
+        }
+        if ((fromDistance <= 0.0f) != (toDistance <= 0.0f)) {
+            float      t = fromDistance / (fromDistance - toDistance);
+            ClipVertex clipped;
+            clipped.position      = from.position + (to.position - from.position) * t;
+            clipped.edge          = from.edge;
+            clipped.feature       = (uint8_t)(4 + clipPlane * 4 + from.edge);
+            output[outputCount++] = clipped;
+        }
+    }
+    return outputCount;
+}
+
+// keeps the deepest point and the ones spanning the largest area around it
+static uint32_t reduce_points(ContactPoint *points, uint32_t count, glm::vec3 normal) {
+    if (count <= MAX_MANIFOLD_POINTS) {
+        return count;
+    }
+
+    uint32_t deepest = 0;
+    for (uint32_t i = 1; i < count; i++) {
+        if (points[i].depth > points[deepest].depth) {
+            deepest = i;
+        }
+    }
+
+    uint32_t  farthest         = deepest == 0 ? 1 : 0;
+    glm::vec3 farthestOffset   = points[farthest].position - points[deepest].position;
+    float     farthestDistance = glm::dot(farthestOffset, farthestOffset);
+    for (uint32_t i = 0; i < count; i++) {
+        glm::vec3 offset = points[i].position - points[deepest].position;
+        if (glm::dot(offset, offset) > farthestDistance) {
+            farthest         = i;
+            farthestDistance = glm::dot(offset, offset);
+        }
+    }
+
+    glm::vec3 edge    = points[farthest].position - points[deepest].position;
+    uint32_t  maxSide = deepest, minSide = deepest;
+    float     maxArea = 0.0f, minArea = 0.0f;
+    for (uint32_t i = 0; i < count; i++) {
+        float area = glm::dot(glm::cross(edge, points[i].position - points[deepest].position), normal);
+        if (area > maxArea) {
+            maxArea = area;
+            maxSide = i;
+        }
+        if (area < minArea) {
+            minArea = area;
+            minSide = i;
+        }
+    }
+
+    const uint32_t candidates[] = {deepest, farthest, maxSide, minSide};
+    uint32_t       kept[MAX_MANIFOLD_POINTS];
+    uint32_t       keptCount = 0;
+    for (uint32_t index : candidates) {
+        if (std::find(kept, kept + keptCount, index) == kept + keptCount) {
+            kept[keptCount++] = index;
+        }
+    }
+
+    ContactPoint reduced[MAX_MANIFOLD_POINTS];
+    for (uint32_t i = 0; i < keptCount; i++) {
+        reduced[i] = points[kept[i]];
+    }
+
+    std::copy(reduced, reduced + keptCount, points);
+    return keptCount;
+}
+
+// refNormal is the outward normal of the reference face, the incident face is the face of the other
+// box pointing the most against it
+static void face_contacts(const OBB &reference, const OBB &incident, int referenceAxis, glm::vec3 refNormal, bool referenceIsB, ContactManifold &manifold) {
+    float     referenceSign = glm::dot(refNormal, reference.axes[referenceAxis]) > 0.0f ? 1.0f : -1.0f;
+    glm::vec3 faceCenter    = reference.center + refNormal * reference.halfExtents[referenceAxis];
+
+    int   incidentAxis = 0;
+    float bestAlign    = -1.0f;
+    for (int i = 0; i < 3; i++) {
+        float align = glm::abs(glm::dot(incident.axes[i], refNormal));
+        if (align > bestAlign) {
+            bestAlign    = align;
+            incidentAxis = i;
+        }
+    }
+    float     incidentSign   = glm::dot(incident.axes[incidentAxis], refNormal) > 0.0f ? -1.0f : 1.0f;
+    glm::vec3 incidentCenter = incident.center + incident.axes[incidentAxis] * (incidentSign * incident.halfExtents[incidentAxis]);
+
+    int       u0 = (incidentAxis + 1) % 3, v0 = (incidentAxis + 2) % 3;
+    glm::vec3 u  = incident.axes[u0] * incident.halfExtents[u0];
+    glm::vec3 v  = incident.axes[v0] * incident.halfExtents[v0];
+
+    ClipVertex buffers[2][16];
+    buffers[0][0]  = {incidentCenter + u + v, 0, 0};
+    buffers[0][1]  = {incidentCenter - u + v, 1, 1};
+    buffers[0][2]  = {incidentCenter - u - v, 2, 2};
+    buffers[0][3]  = {incidentCenter + u - v, 3, 3};
+    uint32_t count = 4;
+
+    // the four side planes of the reference face
+    int current = 0;
+    for (uint32_t plane = 0; plane < 4 && count > 0; plane++) {
+        int       side   = (referenceAxis + 1 + plane / 2) % 3;
+        glm::vec3 normal = reference.axes[side] * (plane % 2 == 0 ? 1.0f : -1.0f);
+        float     offset = glm::dot(normal, reference.center) + reference.halfExtents[side];
+
+        count   = clip_polygon(buffers[current], count, normal, offset, plane, buffers[1 - current]);
+        current = 1 - current;
+    }
+
+    uint32_t referenceFeature = (referenceIsB ? 8 : 0) | (referenceAxis * 2 + (referenceSign < 0.0f ? 1 : 0));
+    uint32_t incidentFeature  = incidentAxis * 2 + (incidentSign < 0.0f ? 1 : 0);
+    float    faceOffset       = glm::dot(refNormal, faceCenter);
+
+    ContactPoint points[16];
+    uint32_t     pointCount = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const ClipVertex &vertex     = buffers[current][i];
+        float             separation = glm::dot(refNormal, vertex.position) - faceOffset;
+        if (separation > CONTACT_MARGIN) {
+            continue;
+        }
+
+        ContactPoint &point = points[pointCount++];
+        point               = ContactPoint{};
+        point.position      = vertex.position - refNormal * (separation * 0.5f);
+        point.depth         = -separation;
+        point.featureId     = (referenceFeature << 16) | (incidentFeature << 8) | vertex.feature;
+    }
+
+    pointCount = reduce_points(points, pointCount, manifold.normal);
+    std::copy(points, points + pointCount, manifold.points);
+    manifold.pointCount = pointCount;
+}
+
+// one point between the closest points of the two supporting edges
+static void edge_contact(const OBB &a, const OBB &b, int edgeA, int edgeB, float depth, ContactManifold &manifold) {
+    glm::vec3 normal = manifold.normal;
+
+    glm::vec3 pointA = a.center, pointB = b.center;
+    uint32_t  signsA = 0, signsB = 0;
+    for (int k = 0; k < 3; k++) {
+        if (k != edgeA) {
+            bool negative = glm::dot(normal, a.axes[k]) < 0.0f;
+            pointA += a.axes[k] * (negative ? -a.halfExtents[k] : a.halfExtents[k]);
+            signsA |= (uint32_t)negative << k;
+        }
+        if (k != edgeB) {
+            bool negative = glm::dot(normal, b.axes[k]) > 0.0f;
+            pointB += b.axes[k] * (negative ? -b.halfExtents[k] : b.halfExtents[k]);
+            signsB |= (uint32_t)negative << k;
+        }
+    }
+
+    glm::vec3 directionA = a.axes[edgeA];
+    glm::vec3 directionB = b.axes[edgeB];
+    glm::vec3 r          = pointA - pointB;
+
+    float alignment = glm::dot(directionA, directionB);
+    float c         = glm::dot(directionA, r);
+    float f         = glm::dot(directionB, r);
+    float denom     = 1.0f - alignment * alignment;
+
+    float s = denom > PARALLEL_EPSILON ? glm::clamp((alignment * f - c) / denom, -a.halfExtents[edgeA], a.halfExtents[edgeA]) : 0.0f;
+    float t = glm::clamp(alignment * s + f, -b.halfExtents[edgeB], b.halfExtents[edgeB]);
+    s       = glm::clamp(alignment * t - c, -a.halfExtents[edgeA], a.halfExtents[edgeA]);
+
+    ContactPoint &point = manifold.points[0];
+    point               = ContactPoint{};
+    point.position      = (pointA + directionA * s + pointB + directionB * t) * 0.5f;
+    point.depth         = depth;
+    point.featureId     = 0x80000000 | (edgeA << 12) | (signsA << 8) | (edgeB << 4) | signsB;
+    manifold.pointCount = 1;
+}
+
+static bool generate_contacts(const OBB &a, const OBB &b, const SatResult &sat, ContactManifold &manifold) {
+    glm::vec3 normal;
+    if (sat.axis < 3) {
+        normal = a.axes[sat.axis];
+    } else if (sat.axis < 6) {
+        normal = b.axes[sat.axis - 3];
+    } else {
+        uint32_t edge = sat.axis - 6;
+        normal        = glm::normalize(glm::cross(a.axes[edge / 3], b.axes[edge % 3]));
+    }
+    if (glm::dot(normal, b.center - a.center) < 0.0f) {
+        normal = -normal;
+    }
+
+    manifold.normal     = normal;
+    manifold.pointCount = 0;
+
+    if (sat.axis < 3) {
+        face_contacts(a, b, sat.axis, normal, false, manifold);
+    } else if (sat.axis < 6) {
+        face_contacts(b, a, sat.axis - 3, -normal, true, manifold);
+    } else {
+        uint32_t edge = sat.axis - 6;
+        edge_contact(a, b, edge / 3, edge % 3, sat.depth, manifold);
+    }
+    return manifold.pointCount > 0;
+}
+
+bool collide_obb(const OBB &a, const OBB &b, ContactManifold &manifold) {
+    PairBatch batch;
+    batch.a[0]             = &a;
+    batch.b[0]             = &b;
+    batch.internalFaces[0] = 0;
+    batch.count            = 1;
+
+    SatResult result[4];
+    sat_batch(batch, result);
+    return result[0].overlap && generate_contacts(a, b, result[0], manifold);
+}
+
+/*NarrowPhase*/
+
+static uint64_t pair_key(uint32_t a, uint32_t b) { return ((uint64_t)a << 32) | b; }
+
+// body pairs never set the top bit, block keys always do
+static uint64_t world_key(uint32_t body, glm::ivec3 block) {
+    const uint64_t mask   = 0x1FFFFF;
+    uint64_t       packed = ((uint64_t)(block.x & mask) << 42) | ((uint64_t)(block.y & mask) << 21) | (uint64_t)(block.z & mask);
+    return (packed ^ ((uint64_t)body * 0x9E3779B97F4A7C15ull)) | (1ull << 63);
+}
+
+static uint8_t internal_faces(const ChunkStore &world, glm::ivec3 block) {
+    uint8_t faces = 0;
+    for (int axis = 0; axis < 3; axis++) {
+        glm::ivec3 offset(0);
+        offset[axis] = 1;
+        faces |= world.is_solid(block + offset) << (axis * 2);
+        faces |= world.is_solid(block - offset) << (axis * 2 + 1);
+    }
+    return faces;
+}
+
+void NarrowPhase::warm_start(ContactManifold &manifold) const {
+    auto it = _previousIndex.find(manifold.key);
+    if (it == _previousIndex.end()) {
+        return;
+    }
+
+    const ContactManifold &previous = _previousManifolds[it->second];
+    for (uint32_t i = 0; i < manifold.pointCount; i++) {
+        for (uint32_t j = 0; j < previous.pointCount; j++) {
+            if (manifold.points[i].featureId == previous.points[j].featureId) {
+                manifold.points[i].normalImpulse     = previous.points[j].normalImpulse;
+                manifold.points[i].tangentImpulse[0] = previous.points[j].tangentImpulse[0];
+                manifold.points[i].tangentImpulse[1] = previous.points[j].tangentImpulse[1];
+                break;
+            }
+        }
+    }
+}
+
+void NarrowPhase::collide(const std::vector<OBB> &boxes, const std::vector<BroadPhasePair> &pairs, const ChunkStore *world, const std::vector<uint32_t> &worldQueries, JobSystem &jobs) {
+    std::swap(_previousManifolds, _manifolds);
+    _manifolds.clear();
+
+    uint32_t pairCount  = (uint32_t)pairs.size();
+    uint32_t pairChunks = (pairCount + pairsPerJob - 1) / pairsPerJob;
+    _pairOutput.resize(std::max((uint32_t)_pairOutput.size(), pairChunks));
+
+    jobs.parallel_for(pairCount, pairsPerJob, [&](uint32_t begin, uint32_t end) {
+        std::vector<ContactManifold> &output = _pairOutput[begin / pairsPerJob];
+        output.clear();
+
+        for (uint32_t first = begin; first < end; first += 4) {
+            PairBatch batch;
+            batch.count = std::min(4u, end - first);
+            for (uint32_t lane = 0; lane < batch.count; lane++) {
+                batch.a[lane]             = &boxes[pairs[first + lane].a];
+                batch.b[lane]             = &boxes[pairs[first + lane].b];
+                batch.internalFaces[lane] = 0;
+            }
+
+            SatResult results[4];
+            sat_batch(batch, results);
+
+            for (uint32_t lane = 0; lane < batch.count; lane++) {
+                ContactManifold manifold;
+                if (!results[lane].overlap || !generate_contacts(*batch.a[lane], *batch.b[lane], results[lane], manifold)) {
+                    continue;
+                }
+
+                const BroadPhasePair &pair = pairs[first + lane];
+                manifold.key               = pair_key(pair.a, pair.b);
+                manifold.bodyA             = pair.a;
+                manifold.bodyB             = pair.b;
+                warm_start(manifold);
+                output.push_back(manifold);
+            }
+        }
+    });
+
+    uint32_t queryCount  = world != nullptr ? (uint32_t)worldQueries.size() : 0;
+    uint32_t queryChunks = (queryCount + bodiesPerJob - 1) / bodiesPerJob;
+    _worldOutput.resize(std::max((uint32_t)_worldOutput.size(), queryChunks));
+
+    jobs.parallel_for(queryCount, bodiesPerJob, [&](uint32_t begin, uint32_t end) {
+        std::vector<ContactManifold> &output = _worldOutput[begin / bodiesPerJob];
+        output.clear();
+
+        // the block boxes are only built here, they have to live until their batch is tested
+        OBB        blocks[4];
+        glm::ivec3 blockCoords[4];
+        uint32_t   bodies[4];
+        PairBatch  batch;
+
+        auto flush = [&]() {
+            SatResult results[4];
+            sat_batch(batch, results);
+
+            for (uint32_t lane = 0; lane < batch.count; lane++) {
+                ContactManifold manifold;
+                if (!results[lane].overlap || !generate_contacts(*batch.a[lane], *batch.b[lane], results[lane], manifold)) {
+                    continue;
+                }
+
+                manifold.key   = world_key(bodies[lane], blockCoords[lane]);
+                manifold.bodyA = bodies[lane];
+                manifold.bodyB = WORLD_BODY;
+                warm_start(manifold);
+                output.push_back(manifold);
+            }
+            batch.count = 0;
+        };
+
+        for (uint32_t i = begin; i < end; i++) {
+            uint32_t   body   = worldQueries[i];
+            AABB       bounds = boxes[body].get_bounds();
+            glm::ivec3 minBlock(glm::floor(bounds.min - CONTACT_MARGIN));
+            glm::ivec3 maxBlock(glm::floor(bounds.max + CONTACT_MARGIN));
+
+            world->for_each_solid(minBlock, maxBlock, [&](glm::ivec3 block) {
+                uint32_t lane = batch.count++;
+
+                blocks[lane]              = OBB{glm::vec3(block) + 0.5f, glm::vec3(0.5f)};
+                blockCoords[lane]         = block;
+                bodies[lane]              = body;
+                batch.a[lane]             = &boxes[body];
+                batch.b[lane]             = &blocks[lane];
+                batch.internalFaces[lane] = internal_faces(*world, block);
+
+                if (batch.count == 4) {
+                    flush();
+                }
+            });
+        }
+        if (batch.count > 0) {
+            flush();
+        }
+    });
+
+    for (uint32_t i = 0; i < pairChunks; i++) {
+        _manifolds.insert(_manifolds.end(), _pairOutput[i].begin(), _pairOutput[i].end());
+    }
+    for (uint32_t i = 0; i < queryChunks; i++) {
+        _manifolds.insert(_manifolds.end(), _worldOutput[i].begin(), _worldOutput[i].end());
+    }
+
+    _previousIndex.clear();
+    for (uint32_t i = 0; i < (uint32_t)_manifolds.size(); i++) {
+        _previousIndex[_manifolds[i].key] = i;
+    }
+}
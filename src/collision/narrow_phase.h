@@ -0,0 +1,63 @@
+#pragma once
+
+#include "../core/job_system.h"
+#include "broad_phase.h"
+#include "obb.h"
+#include "voxel_world.h"
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <unordered_map>
+#include <vector>
+
+const uint32_t MAX_MANIFOLD_POINTS = 4;
+const uint32_t WORLD_BODY          = 0xFFFFFFFF;
+
+// points closer than this are kept as contacts even when not touching yet
+const float CONTACT_MARGIN = 0.02f;
+
+struct ContactPoint {
+    glm::vec3 position;  // halfway between the two surfaces
+    float     depth;     // positive when penetrating, negative for points inside the margin
+    uint32_t  featureId; // which face/edge/vertex made the point, the same contact keeps its id between steps
+
+    // accumulated by the solver, carried over to the next step when the feature id matches
+    float normalImpulse     = 0.0f;
+    float tangentImpulse[2] = {0.0f, 0.0f};
+};
+
+struct ContactManifold {
+    uint64_t     key;
+    uint32_t     bodyA;
+    uint32_t     bodyB; // WORLD_BODY when colliding with a block
+    glm::vec3    normal; // points from A to B
+    uint32_t     pointCount = 0;
+    ContactPoint points[MAX_MANIFOLD_POINTS];
+};
+
+// SAT test for one pair, returns false when separated. Impulses of the points are zero.
+bool collide_obb(const OBB &a, const OBB &b, ContactManifold &manifold);
+
+// Turns broad phase pairs into contact manifolds. Pairs are split into chunks over the job system
+// and every chunk tests four pairs at once, one pair per SIMD lane. Manifolds of the last call are
+// kept so the new contacts can take over their accumulated impulses.
+class NarrowPhase {
+  public:
+    // worldQueries are indices into boxes that should also collide with the solid blocks of world
+    void collide(const std::vector<OBB> &boxes, const std::vector<BroadPhasePair> &pairs, const ChunkStore *world, const std::vector<uint32_t> &worldQueries, JobSystem &jobs);
+
+    std::vector<ContactManifold>       &get_manifolds() { return _manifolds; }
+    const std::vector<ContactManifold> &get_manifolds() const { return _manifolds; }
+
+    uint32_t pairsPerJob  = 64;
+    uint32_t bodiesPerJob = 16;
+
+  private:
+    void warm_start(ContactManifold &manifold) const;
+
+    std::vector<ContactManifold>              _manifolds;
+    std::vector<ContactManifold>              _previousManifolds;
+    std::unordered_map<uint64_t, uint32_t>    _previousIndex; // key -> index into _previousManifolds
+    std::vector<std::vector<ContactManifold>> _pairOutput;    // one per job chunk
+    std::vector<std::vector<ContactManifold>> _worldOutput;
+};
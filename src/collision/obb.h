@@ -0,0 +1,17 @@
+#pragma once
+
+#include "aabb.h"
+
+#include <glm/glm.hpp>
+
+// Oriented box, axes are the columns of a rotation matrix
+struct OBB {
+    glm::vec3 center;
+    glm::vec3 halfExtents;
+    glm::mat3 axes = glm::mat3(1.0f);
+
+    AABB get_bounds() const {
+        glm::vec3 extent = glm::abs(axes[0]) * halfExtents.x + glm::abs(axes[1]) * halfExtents.y + glm::abs(axes[2]) * halfExtents.z;
+        return AABB{center - extent, center + extent};
+    }
+};
@@ -63,8 +63,6 @@ struct QuadNode {
 };
 QuadNode root;
 
-unordered_map<uint32_t, std::vector<uint32_t>> chunkObjects;
-
 void init_tree(uint32_t chunkGroup) {
   root = QuadNode(chunkGroup * 4 * CHUNK_SIZE, 0, 0);
 }
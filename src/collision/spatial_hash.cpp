@@ -0,0 +1,335 @@
+#include "spatial_hash.h"
+
+#include <algorithm>
+#include <cmath>
+
+// cell coordinates are packed into 21 bits per axis, the grid repeats every 2^21 cells
+const int      CELL_BITS = 21;
+const int      CELL_BIAS = 1 << (CELL_BITS - 1);
+const uint64_t CELL_MASK = (1ull << CELL_BITS) - 1;
+
+static glm::ivec3 unpack_key(uint64_t key) {
+    return glm::ivec3((int)(key & CELL_MASK) - CELL_BIAS, (int)((key >> CELL_BITS) & CELL_MASK) - CELL_BIAS, (int)((key >> (CELL_BITS * 2)) & CELL_MASK) - CELL_BIAS);
+}
+
+static uint32_t home_slot(uint64_t key, uint32_t mask) { return (uint32_t)((key * 0x9E3779B97F4A7C15ull) >> 32) & mask; }
+
+void SpatialHash::init(float cellSize, uint32_t expectedEntities) {
+    _cellSize        = cellSize;
+    _inverseCellSize = 1.0f / cellSize;
+
+    uint32_t size = 16;
+    while (size < expectedEntities * 2) {
+        size *= 2;
+    }
+    _cells.assign(size, Cell{});
+    _occupied = 0;
+
+    _positions.clear();
+    _cellKey.clear();
+    _next.clear();
+    _previous.clear();
+    _entityCount = 0;
+
+    _positions.reserve(expectedEntities);
+    _cellKey.reserve(expectedEntities);
+    _next.reserve(expectedEntities);
+    _previous.reserve(expectedEntities);
+}
+
+void SpatialHash::clear() {
+    std::fill(_cells.begin(), _cells.end(), Cell{});
+    std::fill(_cellKey.begin(), _cellKey.end(), EMPTY_KEY);
+    _occupied    = 0;
+    _entityCount = 0;
+}
+
+/*Table*/
+
+glm::ivec3 SpatialHash::cell_coord(glm::vec3 position) const { return glm::ivec3(glm::floor(position * _inverseCellSize)); }
+
+uint64_t SpatialHash::cell_key(glm::ivec3 coord) const {
+    return ((uint64_t)(coord.x + CELL_BIAS) & CELL_MASK) | (((uint64_t)(coord.y + CELL_BIAS) & CELL_MASK) << CELL_BITS) | (((uint64_t)(coord.z + CELL_BIAS) & CELL_MASK) << (CELL_BITS * 2));
+}
+
+uint32_t SpatialHash::find_slot(uint64_t key) const {
+    if (_cells.empty()) {
+        return SPATIAL_HASH_NONE;
+    }
+
+    uint32_t mask = (uint32_t)_cells.size() - 1;
+    for (uint32_t slot = home_slot(key, mask);; slot = (slot + 1) & mask) {
+        if (_cells[slot].key == key) {
+            return slot;
+        }
+        if (_cells[slot].key == EMPTY_KEY) {
+            return SPATIAL_HASH_NONE;
+        }
+    }
+}
+
+void SpatialHash::grow() {
+    std::vector<Cell> old = std::move(_cells);
+    _cells.assign(std::max<size_t>(16, old.size() * 2), Cell{});
+
+    uint32_t mask = (uint32_t)_cells.size() - 1;
+    for (const Cell &cell : old) {
+        if (cell.key == EMPTY_KEY) {
+            continue;
+        }
+
+        uint32_t slot = home_slot(cell.key, mask);
+        while (_cells[slot].key != EMPTY_KEY) {
+            slot = (slot + 1) & mask;
+        }
+        _cells[slot] = cell;
+    }
+}
+
+// backward shift deletion, keeps the probe sequences intact without tombstones
+void SpatialHash::erase_slot(uint32_t slot) {
+    uint32_t mask = (uint32_t)_cells.size() - 1;
+    uint32_t hole = slot;
+
+    for (uint32_t next = (hole + 1) & mask; _cells[next].key != EMPTY_KEY; next = (next + 1) & mask) {
+        uint32_t home = home_slot(_cells[next].key, mask);
+
+        // the entry can fill the hole when its home is not between the hole and where it sits
+        bool canMove = hole <= next ? (home <= hole || home > next) : (home <= hole && home > next);
+        if (canMove) {
+            _cells[hole] = _cells[next];
+            hole         = next;
+        }
+    }
+
+    _cells[hole] = Cell{};
+    _occupied--;
+}
+
+/*Entities*/
+
+void SpatialHash::link(uint32_t entity, uint64_t key) {
+    uint32_t slot = find_slot(key);
+    if (slot == SPATIAL_HASH_NONE) {
+        if ((_occupied + 1) * 2 > _cells.size()) {
+            grow();
+        }
+
+        uint32_t mask = (uint32_t)_cells.size() - 1;
+        slot          = home_slot(key, mask);
+        while (_cells[slot].key != EMPTY_KEY) {
+            slot = (slot + 1) & mask;
+        }
+        _cells[slot] = Cell{key, SPATIAL_HASH_NONE, 0};
+        _occupied++;
+    }
+
+    Cell &cell = _cells[slot];
+    if (cell.head != SPATIAL_HASH_NONE) {
+        _previous[cell.head] = entity;
+    }
+    _next[entity]     = cell.head;
+    _previous[entity] = SPATIAL_HASH_NONE;
+    _cellKey[entity]  = key;
+    cell.head         = entity;
+    cell.count++;
+}
+
+void SpatialHash::unlink(uint32_t entity) {
+    uint32_t slot = find_slot(_cellKey[entity]);
+    Cell    &cell = _cells[slot];
+
+    if (_previous[entity] != SPATIAL_HASH_NONE) {
+        _next[_previous[entity]] = _next[entity];
+    } else {
+        cell.head = _next[entity];
+    }
+    if (_next[entity] != SPATIAL_HASH_NONE) {
+        _previous[_next[entity]] = _previous[entity];
+    }
+
+    _cellKey[entity] = EMPTY_KEY;
+    if (--cell.count == 0) {
+        erase_slot(slot);
+    }
+}
+
+void SpatialHash::insert(uint32_t entity, glm::vec3 position) {
+    if (contains(entity)) {
+        move(entity, position);
+        return;
+    }
+
+    if (entity >= _cellKey.size()) {
+        _positions.resize(entity + 1);
+        _cellKey.resize(entity + 1, EMPTY_KEY);
+        _next.resize(entity + 1);
+        _previous.resize(entity + 1);
+    }
+
+    _positions[entity] = position;
+    link(entity, cell_key(cell_coord(position)));
+    _entityCount++;
+}
+
+void SpatialHash::remove(uint32_t entity) {
+    if (!contains(entity)) {
+        return;
+    }
+    unlink(entity);
+    _entityCount--;
+}
+
+void SpatialHash::move(uint32_t entity, glm::vec3 position) {
+    _positions[entity] = position;
+
+    uint64_t key = cell_key(cell_coord(position));
+    if (key == _cellKey[entity]) {
+        return;
+    }
+
+    unlink(entity);
+    link(entity, key);
+    _relinked++;
+}
+
+void SpatialHash::update(const std::vector<glm::vec3> &positions) {
+    _relinked = 0;
+    for (uint32_t i = 0; i < (uint32_t)positions.size(); i++) {
+        if (contains(i)) {
+            move(i, positions[i]);
+        } else {
+            insert(i, positions[i]);
+        }
+    }
+}
+
+/*Queries*/
+
+template <typename Visit> void SpatialHash::visit_cells(glm::ivec3 minCell, glm::ivec3 maxCell, Visit &&visit) const {
+    uint64_t cellCount = (uint64_t)(maxCell.x - minCell.x + 1) * (uint64_t)(maxCell.y - minCell.y + 1) * (uint64_t)(maxCell.z - minCell.z + 1);
+
+    // a query covering more cells than are occupied is cheaper as a walk over the table
+    if (cellCount > _occupied) {
+        for (const Cell &cell : _cells) {
+            if (cell.key == EMPTY_KEY) {
+                continue;
+            }
+
+            glm::ivec3 coord = unpack_key(cell.key);
+            if (coord.x < minCell.x || coord.x > maxCell.x || coord.y < minCell.y || coord.y > maxCell.y || coord.z < minCell.z || coord.z > maxCell.z) {
+                continue;
+            }
+            for (uint32_t entity = cell.head; entity != SPATIAL_HASH_NONE; entity = _next[entity]) {
+                visit(entity);
+            }
+        }
+        return;
+    }
+
+    for (int x = minCell.x; x <= maxCell.x; x++) {
+        for (int y = minCell.y; y <= maxCell.y; y++) {
+            for (int z = minCell.z; z <= maxCell.z; z++) {
+                uint32_t slot = find_slot(cell_key(glm::ivec3(x, y, z)));
+                if (slot == SPATIAL_HASH_NONE) {
+                    continue;
+                }
+                for (uint32_t entity = _cells[slot].head; entity != SPATIAL_HASH_NONE; entity = _next[entity]) {
+                    visit(entity);
+                }
+            }
+        }
+    }
+}
+
+void SpatialHash::query_radius(glm::vec3 center, float radius, std::vector<uint32_t> &result) const {
+    result.clear();
+
+    float radius2 = radius * radius;
+    visit_cells(cell_coord(center - glm::vec3(radius)), cell_coord(center + glm::vec3(radius)), [&](uint32_t entity) {
+        glm::vec3 offset = _positions[entity] - center;
+        if (glm::dot(offset, offset) <= radius2) {
+            result.push_back(entity);
+        }
+    });
+}
+
+void SpatialHash::query_box(const AABB &box, std::vector<uint32_t> &result) const {
+    result.clear();
+
+    visit_cells(cell_coord(box.min), cell_coord(box.max), [&](uint32_t entity) {
+        glm::vec3 p = _positions[entity];
+        if (p.x >= box.min.x && p.x <= box.max.x && p.y >= box.min.y && p.y <= box.max.y && p.z >= box.min.z && p.z <= box.max.z) {
+            result.push_back(entity);
+        }
+    });
+}
+
+void SpatialHash::query_nearest(glm::vec3 position, uint32_t k, std::vector<uint32_t> &result) const {
+    result.clear();
+    if (k == 0 || _entityCount == 0) {
+        return;
+    }
+
+    // max heap on distance, the front is the worst of the k best so far
+    std::vector<std::pair<float, uint32_t>> best;
+    best.reserve(k + 1);
+
+    auto consider = [&](uint32_t entity) {
+        glm::vec3 offset   = _positions[entity] - position;
+        float     distance = glm::dot(offset, offset);
+        if (best.size() < k) {
+            best.emplace_back(distance, entity);
+            std::push_heap(best.begin(), best.end());
+        } else if (distance < best.front().first) {
+            std::pop_heap(best.begin(), best.end());
+            best.back() = {distance, entity};
+            std::push_heap(best.begin(), best.end());
+        }
+    };
+
+    // grow rings of cells around the cell holding position. After ring r everything not visited yet
+    // is at least r cells away, which is the stop condition once k entities were found.
+    glm::ivec3 center  = cell_coord(position);
+    uint32_t   visited = 0;
+
+    for (int r = 0;; r++) {
+        uint64_t ringCells = r == 0 ? 1 : (uint64_t)24 * r * r + 2;
+        if (ringCells > _occupied) {
+            // the ring is bigger than the table, finish with one pass over everything
+            best.clear();
+            for (const Cell &cell : _cells) {
+                for (uint32_t entity = cell.key != EMPTY_KEY ? cell.head : SPATIAL_HASH_NONE; entity != SPATIAL_HASH_NONE; entity = _next[entity]) {
+                    consider(entity);
+                }
+            }
+            break;
+        }
+
+        for (int x = -r; x <= r; x++) {
+            for (int y = -r; y <= r; y++) {
+                bool onSide = x == -r || x == r || y == -r || y == r;
+                for (int z = -r; z <= r; z += onSide ? 1 : std::max(1, 2 * r)) {
+                    uint32_t slot = find_slot(cell_key(center + glm::ivec3(x, y, z)));
+                    if (slot == SPATIAL_HASH_NONE) {
+                        continue;
+                    }
+                    for (uint32_t entity = _cells[slot].head; entity != SPATIAL_HASH_NONE; entity = _next[entity]) {
+                        consider(entity);
+                        visited++;
+                    }
+                }
+            }
+        }
+
+        float reach = r * _cellSize;
+        if (visited == _entityCount || (best.size() == k && best.front().first <= reach * reach)) {
+            break;
+        }
+    }
+
+    std::sort_heap(best.begin(), best.end());
+    for (const auto &entry : best) {
+        result.push_back(entry.second);
+    }
+}
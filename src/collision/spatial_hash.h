@@ -0,0 +1,75 @@
+#pragma once
+
+#include "aabb.h"
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+const uint32_t SPATIAL_HASH_NONE = 0xFFFFFFFF;
+
+// Uniform grid over entity positions, only the occupied cells are stored. Cells live in an open
+// addressing table and each cell owns an intrusive doubly linked list threaded through the flat
+// per-entity arrays, so moving an entity between cells never allocates.
+class SpatialHash {
+  public:
+    void init(float cellSize, uint32_t expectedEntities = 0);
+    void clear();
+
+    // entity is any index chosen by the caller, the arrays grow to fit it
+    void insert(uint32_t entity, glm::vec3 position);
+    void remove(uint32_t entity);
+    // only relinks the entity when it crossed into another cell
+    void move(uint32_t entity, glm::vec3 position);
+    // positions[i] is the new position of entity i, entities that were never inserted are added
+    void update(const std::vector<glm::vec3> &positions);
+
+    bool      contains(uint32_t entity) const { return entity < _cellKey.size() && _cellKey[entity] != EMPTY_KEY; }
+    glm::vec3 get_position(uint32_t entity) const { return _positions[entity]; }
+
+    // results are cleared first, order is unspecified
+    void query_radius(glm::vec3 center, float radius, std::vector<uint32_t> &result) const;
+    void query_box(const AABB &box, std::vector<uint32_t> &result) const;
+    // up to k entities sorted by distance, closest first
+    void query_nearest(glm::vec3 position, uint32_t k, std::vector<uint32_t> &result) const;
+
+    float    get_cell_size() const { return _cellSize; }
+    uint32_t get_cell_count() const { return _occupied; }
+    uint32_t get_entity_count() const { return _entityCount; }
+    // entities moved to another cell by the last update
+    uint32_t get_relinked_count() const { return _relinked; }
+
+  private:
+    static constexpr uint64_t EMPTY_KEY = ~0ull;
+
+    struct Cell {
+        uint64_t key = EMPTY_KEY;
+        uint32_t head;
+        uint32_t count;
+    };
+
+    glm::ivec3 cell_coord(glm::vec3 position) const;
+    uint64_t   cell_key(glm::ivec3 coord) const;
+    uint32_t   find_slot(uint64_t key) const; // slot holding key or SPATIAL_HASH_NONE
+    void       grow();
+    void       link(uint32_t entity, uint64_t key);
+    void       unlink(uint32_t entity);
+    void       erase_slot(uint32_t slot);
+
+    // calls visit(entity) for every entity in the cells overlapping [minCell, maxCell]
+    template <typename Visit> void visit_cells(glm::ivec3 minCell, glm::ivec3 maxCell, Visit &&visit) const;
+
+    float _cellSize        = 1.0f;
+    float _inverseCellSize = 1.0f;
+
+    std::vector<Cell> _cells; // power of two, at most half full
+    uint32_t          _occupied = 0;
+
+    // per entity
+    std::vector<glm::vec3> _positions;
+    std::vector<uint64_t>  _cellKey; // EMPTY_KEY when not inserted
+    std::vector<uint32_t>  _next;
+    std::vector<uint32_t>  _previous;
+    uint32_t               _entityCount = 0;
+    uint32_t               _relinked    = 0;
+};
@@ -0,0 +1,66 @@
+#include "voxel_world.h"
+
+#include <cassert>
+
+static int32_t floor_div(int32_t value) { return value >= 0 ? value / SECTION_SIZE : (value - SECTION_SIZE + 1) / SECTION_SIZE; }
+
+static uint64_t section_key(glm::ivec3 sectionCoord) {
+    const uint64_t mask = 0x1FFFFF; // 21 bits per axis
+    return ((uint64_t)(sectionCoord.x & mask) << 42) | ((uint64_t)(sectionCoord.y & mask) << 21) | (uint64_t)(sectionCoord.z & mask);
+}
+
+static uint32_t column_index(glm::ivec3 block, glm::ivec3 sectionCoord) {
+    uint32_t localX = block.x - sectionCoord.x * SECTION_SIZE;
+    uint32_t localZ = block.z - sectionCoord.z * SECTION_SIZE;
+    return localX + localZ * SECTION_SIZE;
+}
+
+glm::ivec3 ChunkStore::section_coord(glm::ivec3 block) { return glm::ivec3(floor_div(block.x), floor_div(block.y), floor_div(block.z)); }
+
+const ChunkSection *ChunkStore::find_section(glm::ivec3 sectionCoord) const {
+    auto it = _sections.find(section_key(sectionCoord));
+    if (it == _sections.end()) {
+        return nullptr;
+    }
+    return &it->second;
+}
+
+void ChunkStore::set_solid(glm::ivec3 block, bool solid) {
+    glm::ivec3 sectionCoord = section_coord(block);
+    uint16_t   bit          = 1 << (block.y - sectionCoord.y * SECTION_SIZE);
+
+    if (solid) {
+        _sections[section_key(sectionCoord)].solidColumns[column_index(block, sectionCoord)] |= bit;
+        return;
+    }
+
+    auto it = _sections.find(section_key(sectionCoord));
+    if (it != _sections.end()) {
+        it->second.solidColumns[column_index(block, sectionCoord)] &= ~bit;
+    }
+}
+
+bool ChunkStore::is_solid(glm::ivec3 block) const { return column_mask(block.x, block.z, block.y, block.y) != 0; }
+
+uint64_t ChunkStore::column_mask(int32_t x, int32_t z, int32_t minY, int32_t maxY) const {
+    assert(maxY >= minY && maxY - minY < 64);
+
+    uint64_t mask = 0;
+    for (int32_t sectionY = floor_div(minY); sectionY <= floor_div(maxY); sectionY++) {
+        glm::ivec3          sectionCoord = glm::ivec3(floor_div(x), sectionY, floor_div(z));
+        const ChunkSection *section      = find_section(sectionCoord);
+        if (section == nullptr) {
+            continue;
+        }
+
+        uint64_t bits  = section->solidColumns[column_index(glm::ivec3(x, 0, z), sectionCoord)];
+        int32_t  shift = sectionY * SECTION_SIZE - minY;
+        mask |= shift >= 0 ? bits << shift : bits >> -shift;
+    }
+
+    uint32_t height = maxY - minY + 1;
+    if (height < 64) {
+        mask &= (1ull << height) - 1;
+    }
+    return mask;
+}
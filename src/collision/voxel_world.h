@@ -0,0 +1,46 @@
+#pragma once
+
+#include <bit>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <unordered_map>
+
+const int32_t SECTION_SIZE = 16;
+
+// 16x16x16 blocks of the world. Only solidity is stored here, as one bitmask per (x, z) column
+// where bit y is set if the block at local height y is solid.
+struct ChunkSection {
+    uint16_t solidColumns[SECTION_SIZE * SECTION_SIZE] = {};
+};
+
+class ChunkStore {
+  public:
+    void set_solid(glm::ivec3 block, bool solid);
+    bool is_solid(glm::ivec3 block) const;
+
+    // solid blocks of column (x, z) between minY and maxY (inclusive), bit 0 is minY.
+    // maxY - minY must be less then 64
+    uint64_t column_mask(int32_t x, int32_t z, int32_t minY, int32_t maxY) const;
+
+    // calls fn(glm::ivec3 block) for every solid block inside [min, max] (inclusive), one column at a time
+    template <typename Fn> void for_each_solid(glm::ivec3 min, glm::ivec3 max, Fn &&fn) const {
+        for (int32_t z = min.z; z <= max.z; z++) {
+            for (int32_t x = min.x; x <= max.x; x++) {
+                for (int32_t y = min.y; y <= max.y; y += 64) {
+                    uint64_t mask = column_mask(x, z, y, glm::min(max.y, y + 63));
+                    while (mask) {
+                        fn(glm::ivec3(x, y + std::countr_zero(mask), z));
+                        mask &= mask - 1;
+                    }
+                }
+            }
+        }
+    }
+
+    static glm::ivec3 section_coord(glm::ivec3 block);
+
+  private:
+    const ChunkSection *find_section(glm::ivec3 sectionCoord) const;
+
+    std::unordered_map<uint64_t, ChunkSection> _sections;
+};
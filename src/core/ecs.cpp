@@ -0,0 +1,198 @@
+#include "ecs.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+
+const uint32_t CHUNK_ALIGNMENT = 64;
+
+// fixed size so the infos never move, component_info reads without the lock
+static std::mutex    componentMutex;
+static ComponentInfo componentInfos[ECS_MAX_COMPONENTS];
+static uint32_t      componentCount = 0;
+
+ComponentId register_component(uint32_t size, uint32_t alignment) {
+    std::lock_guard<std::mutex> lock(componentMutex);
+    if (componentCount >= ECS_MAX_COMPONENTS) {
+        printf("too many component types, at most %u\n", ECS_MAX_COMPONENTS);
+        abort();
+    }
+    componentInfos[componentCount] = ComponentInfo{size, alignment};
+    return componentCount++;
+}
+
+const ComponentInfo &component_info(ComponentId id) { return componentInfos[id]; }
+
+static uint32_t align_up(uint32_t value, uint32_t alignment) { return (value + alignment - 1) & ~(alignment - 1); }
+
+/*Queries*/
+
+uint32_t QueryBase::count() const {
+    uint32_t total = 0;
+    for (const Archetype *archetype : _archetypes) {
+        total += archetype->count;
+    }
+    return total;
+}
+
+void QueryBase::refresh(const std::vector<std::unique_ptr<Archetype>> &archetypes) {
+    // archetypes are never removed, only the new ones need a look
+    for (; _seenArchetypes < archetypes.size(); _seenArchetypes++) {
+        Archetype *archetype = archetypes[_seenArchetypes].get();
+        if ((archetype->mask & _mask) == _mask) {
+            _archetypes.push_back(archetype);
+        }
+    }
+}
+
+void QueryBase::build_ranges() {
+    _ranges.clear();
+    uint32_t first = 0;
+    for (const Archetype *archetype : _archetypes) {
+        for (const Chunk &chunk : archetype->chunks) {
+            _ranges.push_back(ChunkRange{archetype, &chunk, first});
+            first += chunk.count;
+        }
+    }
+}
+
+/*World*/
+
+EntityWorld::~EntityWorld() {
+    for (const std::unique_ptr<Archetype> &archetype : _archetypes) {
+        for (const Chunk &chunk : archetype->chunks) {
+            std::free(chunk.data);
+        }
+    }
+    for (uint8_t *data : _freeChunks) {
+        std::free(data);
+    }
+}
+
+Archetype &EntityWorld::find_archetype(ComponentMask mask) {
+    auto found = _archetypeByMask.find(mask);
+    if (found != _archetypeByMask.end()) {
+        return *found->second;
+    }
+
+    std::unique_ptr<Archetype> archetype = std::make_unique<Archetype>();
+    archetype->mask                      = mask;
+
+    uint32_t entityBytes = sizeof(Entity);
+    for (ComponentId id = 0; id < ECS_MAX_COMPONENTS; id++) {
+        if (mask & (ComponentMask(1) << id)) {
+            archetype->components.push_back(id);
+            entityBytes += component_info(id).size;
+        }
+    }
+
+    // start from what fits without padding and shrink until the aligned arrays fit as well
+    for (archetype->capacity = ECS_CHUNK_SIZE / entityBytes; archetype->capacity > 1; archetype->capacity--) {
+        uint32_t offset = sizeof(Entity) * archetype->capacity;
+        for (ComponentId id : archetype->components) {
+            const ComponentInfo &info = component_info(id);
+            offset                    = align_up(offset, info.alignment);
+            archetype->offsets[id]    = offset;
+            offset += info.size * archetype->capacity;
+        }
+        if (offset <= ECS_CHUNK_SIZE) {
+            break;
+        }
+    }
+
+    Archetype &result      = *archetype;
+    _archetypeByMask[mask] = archetype.get();
+    _archetypes.push_back(std::move(archetype));
+    return result;
+}
+
+// appends the entity to the last chunk of archetype and points its record there
+void EntityWorld::place(Entity entity, Archetype &archetype) {
+    if (archetype.chunks.empty() || archetype.chunks.back().count == archetype.capacity) {
+        uint8_t *data;
+        if (!_freeChunks.empty()) {
+            data = _freeChunks.back();
+            _freeChunks.pop_back();
+        } else {
+            data = (uint8_t *)std::aligned_alloc(CHUNK_ALIGNMENT, ECS_CHUNK_SIZE);
+        }
+        archetype.chunks.push_back(Chunk{data, 0});
+    }
+
+    Chunk        &chunk                    = archetype.chunks.back();
+    EntityRecord &record                   = *_records.get(entity);
+    archetype.entities(chunk)[chunk.count] = entity;
+    record.archetype                       = &archetype;
+    record.chunk                           = (uint32_t)archetype.chunks.size() - 1;
+    record.row                             = chunk.count;
+    chunk.count++;
+    archetype.count++;
+}
+
+Entity EntityWorld::create_in(Archetype &archetype) {
+    Entity entity = _records.emplace();
+    place(entity, archetype);
+    return entity;
+}
+
+// fills the hole with the last entity of the archetype so every chunk but the last stays full
+void EntityWorld::remove_row(Archetype &archetype, uint32_t chunkIndex, uint32_t row) {
+    Chunk   &chunk = archetype.chunks[chunkIndex];
+    Chunk   &last  = archetype.chunks.back();
+    uint32_t tail  = last.count - 1;
+
+    if (&chunk != &last || row != tail) {
+        Entity moved = archetype.entities(last)[tail];
+        for (ComponentId id : archetype.components) {
+            uint32_t size = component_info(id).size;
+            std::memcpy((uint8_t *)archetype.array(chunk, id) + row * size, (uint8_t *)archetype.array(last, id) + tail * size, size);
+        }
+        EntityRecord &record           = *_records.get(moved);
+        archetype.entities(chunk)[row] = moved;
+        record.chunk                   = chunkIndex;
+        record.row                     = row;
+    }
+
+    last.count--;
+    archetype.count--;
+    if (last.count == 0) {
+        _freeChunks.push_back(last.data);
+        archetype.chunks.pop_back();
+    }
+}
+
+void EntityWorld::destroy(Entity entity) {
+    if (!alive(entity)) {
+        return;
+    }
+
+    const EntityRecord &record = *_records.get(entity);
+    remove_row(*record.archetype, record.chunk, record.row);
+    _records.erase(entity);
+}
+
+void EntityWorld::move_entity(Entity entity, Archetype &target) {
+    // a stale or never created handle has no row to move
+    if (!alive(entity)) {
+        return;
+    }
+
+    EntityRecord source    = *_records.get(entity);
+    Archetype   &archetype = *source.archetype;
+    const Chunk &from      = archetype.chunks[source.chunk];
+
+    place(entity, target);
+    const EntityRecord &record = *_records.get(entity);
+    const Chunk        &to     = target.chunks[record.chunk];
+
+    // components both archetypes have keep their value, new ones are left for the caller
+    for (ComponentId id : target.components) {
+        if (archetype.mask & (ComponentMask(1) << id)) {
+            uint32_t size = component_info(id).size;
+            std::memcpy((uint8_t *)target.array(to, id) + record.row * size, (uint8_t *)archetype.array(from, id) + source.row * size, size);
+        }
+    }
+
+    remove_row(archetype, source.chunk, source.row);
+}
@@ -0,0 +1,215 @@
+#pragma once
+
+#include "job_system.h"
+#include "slot_map.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <typeindex>
+#include <typeinfo>
+#include <unordered_map>
+#include <vector>
+
+const uint32_t ECS_CHUNK_SIZE     = 16 * 1024;
+const uint32_t ECS_MAX_COMPONENTS = 64;
+
+struct EntityTag;
+
+// handle into the entity records, stops being alive once the entity is destroyed
+typedef SlotHandle<EntityTag> Entity;
+
+const Entity NULL_ENTITY = {};
+
+typedef uint32_t ComponentId;
+typedef uint64_t ComponentMask; // one bit per ComponentId
+
+struct ComponentInfo {
+    uint32_t size;
+    uint32_t alignment;
+};
+
+ComponentId          register_component(uint32_t size, uint32_t alignment);
+const ComponentInfo &component_info(ComponentId id);
+
+// ids are handed out the first time a type is used. Components are moved between chunks with
+// memcpy, so they have to be plain data.
+template <typename T> ComponentId component_id() {
+    static_assert(std::is_trivially_copyable_v<T>, "components must be trivially copyable");
+    static const ComponentId id = register_component(sizeof(T), alignof(T));
+    return id;
+}
+
+template <typename... Ts> ComponentMask component_mask() { return ((ComponentMask(1) << component_id<Ts>()) | ... | 0); }
+
+// 16 KB block holding `capacity` entities of one archetype. The entity handles come first, then one
+// tightly packed array per component, so a system only streams the arrays it asks for.
+struct Chunk {
+    uint8_t *data;
+    uint32_t count;
+};
+
+// All entities with exactly the same set of components. Every chunk but the last one is full.
+struct Archetype {
+    ComponentMask            mask;
+    std::vector<ComponentId> components;
+    uint32_t                 offsets[ECS_MAX_COMPONENTS]; // where the array of each component starts in a chunk
+    uint32_t                 capacity;                    // entities per chunk
+    uint32_t                 count = 0;
+    std::vector<Chunk>       chunks;
+
+    Entity                  *entities(const Chunk &chunk) const { return (Entity *)chunk.data; }
+    void                    *array(const Chunk &chunk, ComponentId id) const { return chunk.data + offsets[id]; }
+    template <typename T> T *array(const Chunk &chunk) const { return (T *)array(chunk, component_id<T>()); }
+};
+
+// Cached list of the archetypes having all of Ts. New archetypes are picked up the next time the
+// query is fetched from the world. Entities can't be created, destroyed or change components while
+// a query runs.
+class QueryBase {
+  public:
+    virtual ~QueryBase() = default;
+
+    uint32_t count() const;
+
+  protected:
+    friend class EntityWorld;
+
+    struct ChunkRange {
+        const Archetype *archetype;
+        const Chunk     *chunk;
+        uint32_t         first; // index of the first entity of the chunk over the whole query
+    };
+
+    void refresh(const std::vector<std::unique_ptr<Archetype>> &archetypes);
+    void build_ranges();
+
+    ComponentMask            _mask = 0;
+    std::vector<Archetype *> _archetypes;
+    size_t                   _seenArchetypes = 0;
+    std::vector<ChunkRange>  _ranges;
+};
+
+template <typename... Ts> class Query : public QueryBase {
+  public:
+    // fn(Entity, Ts &...)
+    template <typename Fn> void each(Fn &&fn) {
+        for (Archetype *archetype : _archetypes) {
+            for (const Chunk &chunk : archetype->chunks) {
+                Entity *entities = archetype->entities(chunk);
+                auto    arrays   = std::make_tuple(archetype->array<Ts>(chunk)...);
+                for (uint32_t i = 0; i < chunk.count; i++) {
+                    fn(entities[i], std::get<Ts *>(arrays)[i]...);
+                }
+            }
+        }
+    }
+
+    // fn(uint32_t first, uint32_t count, const Entity *, Ts *...), first numbers the entities over
+    // the whole query so results can go straight to a slot of an output array
+    template <typename Fn> void each_chunk(Fn &&fn) {
+        build_ranges();
+        for (const ChunkRange &range : _ranges) {
+            fn(range.first, range.chunk->count, range.archetype->entities(*range.chunk), range.archetype->template array<Ts>(*range.chunk)...);
+        }
+    }
+
+    // same as each_chunk with the chunks spread over the job system
+    template <typename Fn> void parallel_each_chunk(JobSystem &jobs, Fn &&fn) {
+        build_ranges();
+        jobs.parallel_for((uint32_t)_ranges.size(), 1, [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) {
+                const ChunkRange &range = _ranges[i];
+                fn(range.first, range.chunk->count, range.archetype->entities(*range.chunk), range.archetype->template array<Ts>(*range.chunk)...);
+            }
+        });
+    }
+};
+
+class EntityWorld {
+  public:
+    EntityWorld() = default;
+    ~EntityWorld();
+
+    EntityWorld(const EntityWorld &)            = delete;
+    EntityWorld &operator=(const EntityWorld &) = delete;
+
+    template <typename... Ts> Entity create(const Ts &...components) {
+        Entity entity = create_in(find_archetype(component_mask<Ts...>()));
+        (std::memcpy(get<Ts>(entity), &components, sizeof(Ts)), ...);
+        return entity;
+    }
+    void destroy(Entity entity);
+    bool alive(Entity entity) const { return _records.contains(entity); }
+
+    template <typename T> bool has(Entity entity) const {
+        const EntityRecord *record = _records.get(entity);
+        return record != nullptr && (record->archetype->mask & component_mask<T>());
+    }
+
+    // nullptr when the entity doesn't have T or isn't alive
+    template <typename T> T *get(Entity entity) {
+        const EntityRecord *record = _records.get(entity);
+        if (record == nullptr || !(record->archetype->mask & component_mask<T>())) {
+            return nullptr;
+        }
+        return record->archetype->array<T>(record->archetype->chunks[record->chunk]) + record->row;
+    }
+
+    // moves the entity to the archetype with T added, overwrites T when it is already there. Does
+    // nothing for entities that aren't alive, like destroy
+    template <typename T> void add(Entity entity, const T &component) {
+        if (!alive(entity)) {
+            return;
+        }
+        Archetype *archetype = _records.get(entity)->archetype;
+        if (!(archetype->mask & component_mask<T>())) {
+            move_entity(entity, find_archetype(archetype->mask | component_mask<T>()));
+        }
+        *get<T>(entity) = component;
+    }
+
+    template <typename T> void remove(Entity entity) {
+        if (!alive(entity)) {
+            return;
+        }
+        Archetype *archetype = _records.get(entity)->archetype;
+        if (archetype->mask & component_mask<T>()) {
+            move_entity(entity, find_archetype(archetype->mask & ~component_mask<T>()));
+        }
+    }
+
+    template <typename... Ts> Query<Ts...> &query() {
+        std::unique_ptr<QueryBase> &slot = _queries[std::type_index(typeid(Query<Ts...>))];
+        if (!slot) {
+            slot        = std::make_unique<Query<Ts...>>();
+            slot->_mask = component_mask<Ts...>();
+        }
+        slot->refresh(_archetypes);
+        return static_cast<Query<Ts...> &>(*slot);
+    }
+
+    uint32_t get_entity_count() const { return _records.size(); }
+    uint32_t get_archetype_count() const { return (uint32_t)_archetypes.size(); }
+
+  private:
+    struct EntityRecord {
+        Archetype *archetype = nullptr;
+        uint32_t   chunk;
+        uint32_t   row;
+    };
+
+    Archetype &find_archetype(ComponentMask mask);
+    Entity     create_in(Archetype &archetype);
+    void       place(Entity entity, Archetype &archetype);
+    void       remove_row(Archetype &archetype, uint32_t chunk, uint32_t row);
+    void       move_entity(Entity entity, Archetype &target);
+
+    std::vector<std::unique_ptr<Archetype>>                          _archetypes;
+    std::unordered_map<ComponentMask, Archetype *>                   _archetypeByMask;
+    SlotMap<EntityRecord, EntityTag>                                 _records;
+    std::vector<uint8_t *>                                           _freeChunks;
+    std::unordered_map<std::type_index, std::unique_ptr<QueryBase>> _queries; // one per Query<Ts...> type
+};
@@ -0,0 +1,70 @@
+#include "fixed_step.h"
+
+#include <chrono>
+
+double seconds_now() {
+    using namespace std::chrono;
+    return duration<double>(steady_clock::now().time_since_epoch()).count();
+}
+
+FixedStepLoop::FixedStepLoop(double step, uint32_t maxCatchUpSteps) : _step(step), _maxCatchUpSteps(maxCatchUpSteps) {}
+
+void FixedStepLoop::reset(double now) {
+    _origin        = now;
+    _lastTime      = now;
+    _accumulator   = 0;
+    _simulatedTime = 0;
+}
+
+uint32_t FixedStepLoop::advance(double now) {
+    _accumulator += now - _lastTime;
+    _lastTime = now;
+
+    uint32_t steps = (uint32_t)(_accumulator / _step);
+    if (steps > _maxCatchUpSteps) {
+        uint32_t dropped = steps - _maxCatchUpSteps;
+
+        _droppedSteps += dropped;
+        _accumulator -= dropped * _step;
+        _simulatedTime += dropped * _step; // keep the state time in line with the clock
+        steps = _maxCatchUpSteps;
+    }
+
+    _accumulator -= steps * _step;
+    _simulatedTime += steps * _step;
+    _tick += steps;
+
+    return steps;
+}
+
+SimulationThread::~SimulationThread() { stop(); }
+
+void SimulationThread::start(FixedStepLoop loop, std::function<void(float dt)> step, std::function<void(double stateTime)> publish) {
+    stop();
+    _running = true;
+
+    _thread = std::thread([this, loop, step, publish]() mutable {
+        loop.reset(seconds_now());
+
+        while (_running.load(std::memory_order_relaxed)) {
+            uint32_t steps = loop.advance(seconds_now());
+            for (uint32_t i = 0; i < steps; i++) {
+                step((float)loop.step());
+            }
+            if (steps > 0) {
+                publish(loop.state_time());
+            }
+
+            // sleep until the next step is due
+            double untilNext = (1.0 - loop.alpha()) * loop.step();
+            std::this_thread::sleep_for(std::chrono::duration<double>(untilNext));
+        }
+    });
+}
+
+void SimulationThread::stop() {
+    _running = false;
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <thread>
+
+// seconds from a monotonic clock
+double seconds_now();
+
+// Accumulator for running the simulation at a fixed rate independent of the frame rate.
+// After a long stall at most maxCatchUpSteps are run and the rest of the time is dropped.
+class FixedStepLoop {
+  public:
+    FixedStepLoop(double step = 1.0 / 60.0, uint32_t maxCatchUpSteps = 5);
+
+    void reset(double now);
+
+    // returns how many steps have to be run to catch up with now
+    uint32_t advance(double now);
+
+    // how far between the last and the next step we are, for interpolating the render state
+    float alpha() const { return (float)(_accumulator / _step); }
+
+    // clock time the state after the last step belongs to
+    double state_time() const { return _origin + _simulatedTime; }
+
+    double   step() const { return _step; }
+    uint64_t tick() const { return _tick; }
+    uint64_t dropped_steps() const { return _droppedSteps; }
+
+  private:
+    double   _step;
+    uint32_t _maxCatchUpSteps;
+
+    double   _origin        = 0;
+    double   _lastTime      = 0;
+    double   _accumulator   = 0;
+    double   _simulatedTime = 0;
+    uint64_t _tick          = 0;
+    uint64_t _droppedSteps  = 0;
+};
+
+// Runs a FixedStepLoop on its own thread. step is called for every fixed step and publish once
+// after each batch of steps with the state time, both on the simulation thread.
+class SimulationThread {
+  public:
+    ~SimulationThread();
+
+    void start(FixedStepLoop loop, std::function<void(float dt)> step, std::function<void(double stateTime)> publish);
+    void stop();
+
+    bool is_running() const { return _running.load(std::memory_order_relaxed); }
+
+  private:
+    std::thread       _thread;
+    std::atomic<bool> _running{false};
+};
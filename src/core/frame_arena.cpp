@@ -0,0 +1,108 @@
+#include "frame_arena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+const size_t BLOCK_ALIGNMENT = 64; // also the largest alignment allocate hands out
+
+static size_t align_up(size_t value, size_t alignment) { return (value + alignment - 1) & ~(alignment - 1); }
+
+FrameArena::~FrameArena() {
+    for (const Block &block : _blocks) {
+        std::free(block.data);
+    }
+}
+
+void *FrameArena::allocate(size_t size, size_t alignment) {
+    // blocks after the current one are left over from a rewind and can be filled again
+    for (; _block < _blocks.size(); _block++, _offset = 0) {
+        const Block &block = _blocks[_block];
+        size_t       start = align_up(_offset, alignment);
+        if (start + size <= block.size) {
+            _offset = start + size;
+            return block.data + start;
+        }
+    }
+
+    size_t blockSize = align_up(std::max(FRAME_ARENA_BLOCK_SIZE, size), BLOCK_ALIGNMENT);
+    _blocks.push_back(Block{(uint8_t *)std::aligned_alloc(BLOCK_ALIGNMENT, blockSize), blockSize});
+    _block  = (uint32_t)_blocks.size() - 1;
+    _offset = size;
+    return _blocks.back().data;
+}
+
+void FrameArena::reset() {
+    _peak = std::max(_peak, get_used());
+
+    // one block as big as all of them, the next frame of the same size fits without a new one
+    if (_blocks.size() > 1) {
+        size_t total = get_capacity();
+        for (const Block &block : _blocks) {
+            std::free(block.data);
+        }
+        _blocks.clear();
+        _blocks.push_back(Block{(uint8_t *)std::aligned_alloc(BLOCK_ALIGNMENT, total), total});
+    }
+    _block  = 0;
+    _offset = 0;
+}
+
+void FrameArena::rewind(Marker marker) {
+    _block  = marker.block;
+    _offset = marker.offset;
+}
+
+size_t FrameArena::get_used() const {
+    size_t used = _offset;
+    for (uint32_t i = 0; i < _block && i < _blocks.size(); i++) {
+        used += _blocks[i].size;
+    }
+    return used;
+}
+
+size_t FrameArena::get_capacity() const {
+    size_t capacity = 0;
+    for (const Block &block : _blocks) {
+        capacity += block.size;
+    }
+    return capacity;
+}
+
+FrameArena &frame_arena() {
+    static thread_local FrameArena arena;
+    return arena;
+}
+
+/*Allocation tracking*/
+
+#ifdef ENGINE_TRACK_ALLOCATIONS
+static std::atomic<uint64_t> heapAllocations{0};
+
+uint64_t heap_allocation_count() { return heapAllocations.load(std::memory_order_relaxed); }
+
+// the array and nothrow forms end up in these by default
+void *operator new(size_t size) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *memory = std::malloc(std::max<size_t>(size, 1))) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new(size_t size, std::align_val_t alignment) {
+    heapAllocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *memory = std::aligned_alloc((size_t)alignment, align_up(std::max<size_t>(size, 1), (size_t)alignment))) {
+        return memory;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept { std::free(memory); }
+void operator delete(void *memory, size_t) noexcept { std::free(memory); }
+void operator delete(void *memory, std::align_val_t) noexcept { std::free(memory); }
+void operator delete(void *memory, size_t, std::align_val_t) noexcept { std::free(memory); }
+#else
+uint64_t heap_allocation_count() { return 0; }
+#endif
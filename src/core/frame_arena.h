@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+const size_t FRAME_ARENA_BLOCK_SIZE = 256 * 1024;
+
+#ifdef ENGINE_TRACK_ALLOCATIONS
+const bool TRACK_ALLOCATIONS = true;
+#else
+const bool TRACK_ALLOCATIONS = false;
+#endif
+
+// Bump allocator for memory that only lives until the end of the frame. Nothing is freed on its
+// own, reset gives everything back at once. When a frame needs more than the arena has, extra blocks
+// are added and merged into one big enough block on the next reset, so a steady frame stops touching
+// the heap after the first few.
+class FrameArena {
+  public:
+    struct Marker {
+        uint32_t block;
+        size_t   offset;
+    };
+
+    FrameArena() = default;
+    ~FrameArena();
+
+    FrameArena(const FrameArena &)            = delete;
+    FrameArena &operator=(const FrameArena &) = delete;
+
+    void                    *allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+    template <typename T> T *allocate_array(size_t count) { return (T *)allocate(sizeof(T) * count, alignof(T)); }
+
+    void reset();
+
+    // everything allocated after mark is given back by rewind, the calls have to nest
+    Marker mark() const { return Marker{_block, _offset}; }
+    void   rewind(Marker marker);
+
+    size_t get_used() const;
+    size_t get_capacity() const;
+    size_t get_peak() const { return _peak; } // most bytes used by one frame so far
+
+  private:
+    struct Block {
+        uint8_t *data;
+        size_t   size;
+    };
+
+    std::vector<Block> _blocks;
+    uint32_t           _block  = 0; // the one being filled
+    size_t             _offset = 0;
+    size_t             _peak   = 0;
+};
+
+// Arena of the calling thread. The thread owning the frame resets it, job workers rewind theirs after
+// every job group, so memory taken inside a job can't be kept past it.
+FrameArena &frame_arena();
+
+// heap allocations made since the program started, 0 unless built with ENGINE_TRACK_ALLOCATIONS
+uint64_t heap_allocation_count();
+
+// STL allocator drawing from a frame arena, deallocate does nothing. A container uses the arena of
+// the thread that made it, so it can only grow on that thread and has to be gone before the reset.
+template <typename T> class ArenaAllocator {
+  public:
+    typedef T value_type;
+
+    ArenaAllocator() : _arena(&frame_arena()) {}
+    explicit ArenaAllocator(FrameArena &arena) : _arena(&arena) {}
+    template <typename U> ArenaAllocator(const ArenaAllocator<U> &other) : _arena(other._arena) {}
+
+    T   *allocate(size_t count) { return _arena->allocate_array<T>(count); }
+    void deallocate(T *, size_t) {}
+
+    template <typename U> bool operator==(const ArenaAllocator<U> &other) const { return _arena == other._arena; }
+    template <typename U> bool operator!=(const ArenaAllocator<U> &other) const { return _arena != other._arena; }
+
+  private:
+    template <typename U> friend class ArenaAllocator;
+
+    FrameArena *_arena;
+};
+
+template <typename T> using FrameVector = std::vector<T, ArenaAllocator<T>>;
@@ -0,0 +1,124 @@
+#include "job_system.h"
+
+#include "frame_arena.h"
+
+#include <algorithm>
+
+static thread_local uint32_t threadIndex = 0;
+
+JobSystem::~JobSystem() { shutdown(); }
+
+void JobSystem::init(uint32_t workerCount) {
+    if (workerCount == 0) {
+        workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+    }
+
+    _quit = false;
+    for (uint32_t i = 0; i < workerCount; i++) {
+        _workers.emplace_back([this, i]() { worker_loop(i + 1); });
+    }
+}
+
+void JobSystem::shutdown() {
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _quit = true;
+    }
+    _wake.notify_all();
+
+    for (auto &worker : _workers) {
+        worker.join();
+    }
+    _workers.clear();
+}
+
+uint32_t JobSystem::thread_index() { return threadIndex; }
+
+bool JobSystem::run_chunk(JobGroup &group) {
+    uint32_t chunk = group.next.fetch_add(1, std::memory_order_relaxed);
+    uint32_t begin = chunk * group.chunkSize;
+    if (begin >= group.count) {
+        return false;
+    }
+
+    uint32_t end = std::min(group.count, begin + group.chunkSize);
+    (*group.fn)(begin, end);
+
+    group.remaining.fetch_sub(1, std::memory_order_acq_rel);
+    return true;
+}
+
+void JobSystem::parallel_for(uint32_t count, uint32_t chunkSize, const std::function<void(uint32_t begin, uint32_t end)> &fn) {
+    if (count == 0) {
+        return;
+    }
+
+    chunkSize         = std::max(1u, chunkSize);
+    uint32_t chunks   = (count + chunkSize - 1) / chunkSize;
+
+    // not worth waking anyone up
+    if (chunks == 1 || _workers.empty()) {
+        for (uint32_t begin = 0; begin < count; begin += chunkSize) {
+            fn(begin, std::min(count, begin + chunkSize));
+        }
+        return;
+    }
+
+    JobGroup group;
+    group.fn        = &fn;
+    group.count     = count;
+    group.chunkSize = chunkSize;
+    group.remaining = chunks;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _groups.push_back(&group);
+    }
+    _wake.notify_all();
+
+    while (run_chunk(group)) {
+    }
+
+    // once it's out of the list no new worker can pick it up, then wait for the ones still on it
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _groups.erase(std::find(_groups.begin(), _groups.end(), &group));
+    }
+    while (group.remaining.load(std::memory_order_acquire) != 0 || group.activeWorkers.load(std::memory_order_acquire) != 0) {
+        std::this_thread::yield();
+    }
+}
+
+void JobSystem::worker_loop(uint32_t index) {
+    threadIndex = index;
+
+    auto find_work = [this]() -> JobGroup * {
+        for (JobGroup *group : _groups) {
+            if (group->next.load(std::memory_order_relaxed) * group->chunkSize < group->count) {
+                return group;
+            }
+        }
+        return nullptr;
+    };
+
+    while (true) {
+        JobGroup *group;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _wake.wait(lock, [&]() { return _quit || find_work() != nullptr; });
+            if (_quit) {
+                return;
+            }
+
+            group = find_work();
+            group->activeWorkers.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // scratch memory of the jobs is given back once the worker is done with the group
+        FrameArena::Marker marker = frame_arena().mark();
+        while (run_chunk(*group)) {
+        }
+        frame_arena().rewind(marker);
+        group->activeWorkers.fetch_sub(1, std::memory_order_release);
+    }
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Worker threads for splitting loops into chunks. parallel_for can be called from any thread,
+// also from several at the same time, and the calling thread works on its own loop until it is done.
+// Workers rewind their frame_arena after every group, jobs can use it for scratch memory.
+class JobSystem {
+  public:
+    ~JobSystem();
+
+    // workerCount 0 means one worker per hardware thread, minus the calling thread
+    void init(uint32_t workerCount = 0);
+    void shutdown();
+
+    // calls fn(begin, end) for chunks of [0, count) and returns when all of them are done
+    void parallel_for(uint32_t count, uint32_t chunkSize, const std::function<void(uint32_t begin, uint32_t end)> &fn);
+
+    uint32_t worker_count() const { return (uint32_t)_workers.size(); }
+
+    // 0 for threads that are not workers, 1..worker_count() for the workers
+    static uint32_t thread_index();
+
+  private:
+    struct JobGroup {
+        const std::function<void(uint32_t, uint32_t)> *fn;
+        uint32_t                                        count;
+        uint32_t                                        chunkSize;
+        std::atomic<uint32_t>                           next{0};
+        std::atomic<uint32_t>                           remaining{0};
+        std::atomic<uint32_t>                           activeWorkers{0};
+    };
+
+    void worker_loop(uint32_t index);
+    bool run_chunk(JobGroup &group);
+
+    std::vector<std::thread> _workers;
+    std::vector<JobGroup *>  _groups;
+    std::mutex               _mutex;
+    std::condition_variable  _wake;
+    bool                     _quit = false;
+};
@@ -0,0 +1,195 @@
+#include "offset_allocator.h"
+
+#include <bit>
+#include <cstdio>
+#include <cstdlib>
+
+const uint32_t MANTISSA_BITS = 3; // log2 of OFFSET_ALLOCATOR_LEAF_BINS
+const uint32_t MANTISSA_MASK = OFFSET_ALLOCATOR_LEAF_BINS - 1;
+
+// A size as a small float, the exponent is the first level bin and the three bits below the highest
+// one the second. Sizes under 8 are their own bin. Free ranges go in the bin rounded down, so all of a
+// bin is at least its size, and a request looks from the bin rounded up.
+static uint32_t bin_round_down(uint32_t size) {
+    if (size < OFFSET_ALLOCATOR_LEAF_BINS) {
+        return size;
+    }
+    uint32_t shift = std::bit_width(size) - 1 - MANTISSA_BITS;
+    return ((shift + 1) << MANTISSA_BITS) + ((size >> shift) & MANTISSA_MASK);
+}
+
+static uint32_t bin_round_up(uint32_t size) {
+    uint32_t bin = bin_round_down(size);
+    if (size >= OFFSET_ALLOCATOR_LEAF_BINS && (size & ((1u << (std::bit_width(size) - 1 - MANTISSA_BITS)) - 1)) != 0) {
+        bin++; // a carry into the exponent is still the next bin
+    }
+    return bin;
+}
+
+void OffsetAllocator::init(uint32_t size, uint32_t maxAllocations) {
+    _size           = size;
+    _maxAllocations = maxAllocations;
+    _allocations    = 0;
+    _freeSize       = 0;
+    _freeRanges     = 0;
+    _usedTopBins    = 0;
+    for (uint32_t top = 0; top < OFFSET_ALLOCATOR_TOP_BINS; top++) {
+        _usedLeafBins[top] = 0;
+    }
+    for (uint32_t &head : _binHeads) {
+        head = NONE;
+    }
+
+    // every allocation can leave a free range behind it, plus the one at the end
+    uint32_t nodeCount = maxAllocations * 2 + 1;
+    _nodes.assign(nodeCount, Node{});
+    _spareNodes.resize(nodeCount);
+    for (uint32_t i = 0; i < nodeCount; i++) {
+        _spareNodes[i] = nodeCount - 1 - i;
+    }
+
+    insert_free(0, size, NONE, NONE);
+}
+
+OffsetAllocator::Allocation OffsetAllocator::allocate(uint32_t size) {
+    if (size == 0 || _allocations == _maxAllocations) {
+        return Allocation{};
+    }
+
+    // the first bin of the second level at or past the rounded up one, then the first of any larger
+    // first level bin
+    uint32_t minBin   = bin_round_up(size);
+    uint32_t top      = minBin >> MANTISSA_BITS;
+    uint32_t leafMask = top < OFFSET_ALLOCATOR_TOP_BINS ? _usedLeafBins[top] & (0xFFu << (minBin & MANTISSA_MASK)) : 0;
+    if (leafMask == 0) {
+        uint32_t topMask = top + 1 < OFFSET_ALLOCATOR_TOP_BINS ? _usedTopBins & (0xFFFFFFFFu << (top + 1)) : 0;
+        if (topMask == 0) {
+            return Allocation{};
+        }
+        top      = std::countr_zero(topMask);
+        leafMask = _usedLeafBins[top];
+    }
+    uint32_t bin = (top << MANTISSA_BITS) | std::countr_zero(leafMask);
+
+    uint32_t index = _binHeads[bin];
+    remove_free(index);
+
+    // the rest stays free right after it
+    Node &node = _nodes[index];
+    node.used  = true;
+    if (node.size > size) {
+        uint32_t rest = insert_free(node.offset + size, node.size - size, index, node.neighborNext);
+        if (node.neighborNext != NONE) {
+            _nodes[node.neighborNext].neighborPrev = rest;
+        }
+        node.neighborNext = rest;
+        node.size         = size;
+    }
+
+    _allocations++;
+    return Allocation{node.offset, index};
+}
+
+void OffsetAllocator::free(Allocation allocation) {
+    if (allocation.is_null()) {
+        return;
+    }
+    if (allocation.node >= _nodes.size() || !_nodes[allocation.node].used) {
+        printf("offset allocator: range at %u freed twice\n", allocation.offset);
+        abort();
+    }
+
+    const Node &node   = _nodes[allocation.node];
+    uint32_t    offset = node.offset;
+    uint32_t    size   = node.size;
+    uint32_t    prev   = node.neighborPrev;
+    uint32_t    next   = node.neighborNext;
+
+    // free neighbours are taken out of their bins and become part of this range
+    if (prev != NONE && !_nodes[prev].used) {
+        offset = _nodes[prev].offset;
+        size += _nodes[prev].size;
+        remove_free(prev);
+        _spareNodes.push_back(prev);
+        prev = _nodes[prev].neighborPrev;
+    }
+    if (next != NONE && !_nodes[next].used) {
+        size += _nodes[next].size;
+        remove_free(next);
+        _spareNodes.push_back(next);
+        next = _nodes[next].neighborNext;
+    }
+
+    _nodes[allocation.node].used = false;
+    _spareNodes.push_back(allocation.node);
+    _allocations--;
+
+    uint32_t merged = insert_free(offset, size, prev, next);
+    if (prev != NONE) {
+        _nodes[prev].neighborNext = merged;
+    }
+    if (next != NONE) {
+        _nodes[next].neighborPrev = merged;
+    }
+}
+
+OffsetAllocator::Report OffsetAllocator::report() const {
+    Report report        = {};
+    report.freeSize      = _freeSize;
+    report.freeRanges    = _freeRanges;
+    report.allocations   = _allocations;
+    report.largestFree   = 0;
+    report.fragmentation = 0.0f;
+
+    // the largest range is in the highest bin, which only holds sizes that round down to it
+    if (_usedTopBins != 0) {
+        uint32_t top = std::bit_width(_usedTopBins) - 1;
+        uint32_t bin = (top << MANTISSA_BITS) | (std::bit_width((uint32_t)_usedLeafBins[top]) - 1);
+        for (uint32_t index = _binHeads[bin]; index != NONE; index = _nodes[index].binNext) {
+            report.largestFree = _nodes[index].size > report.largestFree ? _nodes[index].size : report.largestFree;
+        }
+        report.fragmentation = 1.0f - (float)report.largestFree / (float)_freeSize;
+    }
+    return report;
+}
+
+uint32_t OffsetAllocator::insert_free(uint32_t offset, uint32_t size, uint32_t neighborPrev, uint32_t neighborNext) {
+    uint32_t index = _spareNodes.back();
+    _spareNodes.pop_back();
+
+    uint32_t bin = bin_round_down(size);
+    _nodes[index] = Node{offset, size, NONE, _binHeads[bin], neighborPrev, neighborNext, false};
+    if (_binHeads[bin] != NONE) {
+        _nodes[_binHeads[bin]].binPrev = index;
+    }
+    _binHeads[bin] = index;
+
+    _usedLeafBins[bin >> MANTISSA_BITS] |= 1u << (bin & MANTISSA_MASK);
+    _usedTopBins |= 1u << (bin >> MANTISSA_BITS);
+    _freeSize += size;
+    _freeRanges++;
+    return index;
+}
+
+void OffsetAllocator::remove_free(uint32_t index) {
+    const Node &node = _nodes[index];
+    uint32_t    bin  = bin_round_down(node.size);
+
+    if (node.binPrev != NONE) {
+        _nodes[node.binPrev].binNext = node.binNext;
+    } else {
+        _binHeads[bin] = node.binNext;
+    }
+    if (node.binNext != NONE) {
+        _nodes[node.binNext].binPrev = node.binPrev;
+    }
+
+    if (_binHeads[bin] == NONE) {
+        _usedLeafBins[bin >> MANTISSA_BITS] &= ~(1u << (bin & MANTISSA_MASK));
+        if (_usedLeafBins[bin >> MANTISSA_BITS] == 0) {
+            _usedTopBins &= ~(1u << (bin >> MANTISSA_BITS));
+        }
+    }
+    _freeSize -= node.size;
+    _freeRanges--;
+}
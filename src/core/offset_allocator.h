@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// first level bins are the powers of two, each split into 8 second level bins
+const uint32_t OFFSET_ALLOCATOR_TOP_BINS  = 32;
+const uint32_t OFFSET_ALLOCATOR_LEAF_BINS = 8;
+
+// Hands out ranges of an abstract space, the memory itself lives elsewhere (a GPU buffer, usually).
+// Two level segregated fit: free ranges are kept in bins by size, and two levels of bitmasks find the
+// first bin that surely fits with a few bit scans, so allocate and free are O(1). Freed ranges merge
+// with free neighbours right away.
+class OffsetAllocator {
+  public:
+    static constexpr uint32_t NO_SPACE = 0xFFFFFFFF;
+
+    struct Allocation {
+        uint32_t offset = NO_SPACE;
+        uint32_t node   = NO_SPACE; // for free
+
+        bool is_null() const { return offset == NO_SPACE; }
+    };
+
+    struct Report {
+        uint32_t freeSize;
+        uint32_t largestFree;
+        uint32_t freeRanges;
+        uint32_t allocations;
+        float    fragmentation; // 0 when all the free space is one range, towards 1 the more it is split
+    };
+
+    // at most maxAllocations live at once, the nodes are all made here
+    void init(uint32_t size, uint32_t maxAllocations);
+
+    // a null allocation when no free range fits, or when maxAllocations are live
+    Allocation allocate(uint32_t size);
+    void       free(Allocation allocation);
+
+    uint32_t get_size() const { return _size; }
+    uint32_t get_allocation_size(Allocation allocation) const { return _nodes[allocation.node].size; }
+    Report   report() const;
+
+  private:
+    static constexpr uint32_t NONE = 0xFFFFFFFF;
+
+    struct Node {
+        uint32_t offset;
+        uint32_t size;
+        uint32_t binPrev;
+        uint32_t binNext;
+        uint32_t neighborPrev; // by offset, free or not
+        uint32_t neighborNext;
+        bool     used;
+    };
+
+    uint32_t insert_free(uint32_t offset, uint32_t size, uint32_t neighborPrev, uint32_t neighborNext);
+    void     remove_free(uint32_t node);
+
+    uint32_t _size           = 0;
+    uint32_t _maxAllocations = 0;
+
+    std::vector<Node>     _nodes;
+    std::vector<uint32_t> _spareNodes; // unused node indices, a stack
+    uint32_t              _allocations = 0;
+    uint32_t              _freeSize    = 0;
+    uint32_t              _freeRanges  = 0;
+
+    uint32_t _usedTopBins = 0;                              // bit per first level bin with any free range
+    uint8_t  _usedLeafBins[OFFSET_ALLOCATOR_TOP_BINS] = {}; // bit per second level bin
+    uint32_t _binHeads[OFFSET_ALLOCATOR_TOP_BINS * OFFSET_ALLOCATOR_LEAF_BINS];
+};
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ENGINE_SSE 1
+#include <emmintrin.h>
+#endif
+
+// Four floats processed together, one value per lane. Uses SSE when the target has it and falls
+// back to plain loops otherwise. Masks are lanes with all bits set (true) or zero (false).
+namespace simd {
+    struct float4 {
+#ifdef ENGINE_SSE
+        __m128 v;
+#else
+        float v[4];
+#endif
+    };
+
+#ifdef ENGINE_SSE
+    inline float4 load(const float *p) { return {_mm_loadu_ps(p)}; }
+    inline void   store(float *p, float4 a) { _mm_storeu_ps(p, a.v); }
+    inline float4 set1(float value) { return {_mm_set1_ps(value)}; }
+
+    inline float4 operator+(float4 a, float4 b) { return {_mm_add_ps(a.v, b.v)}; }
+    inline float4 operator-(float4 a, float4 b) { return {_mm_sub_ps(a.v, b.v)}; }
+    inline float4 operator*(float4 a, float4 b) { return {_mm_mul_ps(a.v, b.v)}; }
+    inline float4 operator/(float4 a, float4 b) { return {_mm_div_ps(a.v, b.v)}; }
+
+    inline float4 abs(float4 a) { return {_mm_andnot_ps(_mm_set1_ps(-0.0f), a.v)}; }
+    inline float4 min(float4 a, float4 b) { return {_mm_min_ps(a.v, b.v)}; }
+    inline float4 max(float4 a, float4 b) { return {_mm_max_ps(a.v, b.v)}; }
+    inline float4 sqrt(float4 a) { return {_mm_sqrt_ps(a.v)}; }
+
+    inline float4 less(float4 a, float4 b) { return {_mm_cmplt_ps(a.v, b.v)}; }
+    inline float4 mask_or(float4 a, float4 b) { return {_mm_or_ps(a.v, b.v)}; }
+    // mask ? a : b
+    inline float4 select(float4 mask, float4 a, float4 b) { return {_mm_or_ps(_mm_and_ps(mask.v, a.v), _mm_andnot_ps(mask.v, b.v))}; }
+    // bit i is set if lane i of the mask is true
+    inline int move_mask(float4 mask) { return _mm_movemask_ps(mask.v); }
+#else
+    inline float4 load(const float *p) { return {{p[0], p[1], p[2], p[3]}}; }
+    inline void   store(float *p, float4 a) {
+        for (int i = 0; i < 4; i++) {
+            p[i] = a.v[i];
+        }
+    }
+    inline float4 set1(float value) { return {{value, value, value, value}}; }
+
+    template <typename Fn> inline float4 per_lane(float4 a, float4 b, Fn &&fn) {
+        float4 result;
+        for (int i = 0; i < 4; i++) {
+            result.v[i] = fn(a.v[i], b.v[i]);
+        }
+        return result;
+    }
+
+    inline float from_bits(uint32_t bits) {
+        float value;
+        __builtin_memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    inline uint32_t to_bits(float value) {
+        uint32_t bits;
+        __builtin_memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    inline float4 operator+(float4 a, float4 b) { return per_lane(a, b, [](float x, float y) { return x + y; }); }
+    inline float4 operator-(float4 a, float4 b) { return per_lane(a, b, [](float x, float y) { return x - y; }); }
+    inline float4 operator*(float4 a, float4 b) { return per_lane(a, b, [](float x, float y) { return x * y; }); }
+    inline float4 operator/(float4 a, float4 b) { return per_lane(a, b, [](float x, float y) { return x / y; }); }
+
+    inline float4 abs(float4 a) { return per_lane(a, a, [](float x, float) { return std::fabs(x); }); }
+    inline float4 min(float4 a, float4 b) { return per_lane(a, b, [](float x, float y) { return x < y ? x : y; }); }
+    inline float4 max(float4 a, float4 b) { return per_lane(a, b, [](float x, float y) { return x > y ? x : y; }); }
+    inline float4 sqrt(float4 a) { return per_lane(a, a, [](float x, float) { return std::sqrt(x); }); }
+
+    inline float4 less(float4 a, float4 b) { return per_lane(a, b, [](float x, float y) { return from_bits(x < y ? 0xFFFFFFFF : 0); }); }
+    inline float4 mask_or(float4 a, float4 b) { return per_lane(a, b, [](float x, float y) { return from_bits(to_bits(x) | to_bits(y)); }); }
+    inline float4 select(float4 mask, float4 a, float4 b) {
+        float4 result;
+        for (int i = 0; i < 4; i++) {
+            result.v[i] = to_bits(mask.v[i]) ? a.v[i] : b.v[i];
+        }
+        return result;
+    }
+    inline int move_mask(float4 mask) {
+        int bits = 0;
+        for (int i = 0; i < 4; i++) {
+            bits |= (to_bits(mask.v[i]) >> 31) << i;
+        }
+        return bits;
+    }
+#endif
+
+    // out = a * b for column major 4x4 matrices, one column of out per four multiply-adds. a is read
+    // before anything is written and each column of b right before its column of out, so out may be a or b.
+    inline void mat4_multiply(float *out, const float *a, const float *b) {
+        float4 a0 = load(a);
+        float4 a1 = load(a + 4);
+        float4 a2 = load(a + 8);
+        float4 a3 = load(a + 12);
+        for (int column = 0; column < 4; column++) {
+            const float *bColumn = b + column * 4;
+            store(out + column * 4, a0 * set1(bColumn[0]) + a1 * set1(bColumn[1]) + a2 * set1(bColumn[2]) + a3 * set1(bColumn[3]));
+        }
+    }
+} // namespace simd
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+// Index of a slot plus the generation the slot had when the handle was made. Generation 0 is never
+// handed out, so a zeroed handle is null. Tag keeps handles of different maps apart.
+template <typename Tag> struct SlotHandle {
+    uint32_t index      = 0;
+    uint32_t generation = 0;
+
+    bool is_null() const { return generation == 0; }
+    bool operator==(const SlotHandle &other) const { return index == other.index && generation == other.generation; }
+    bool operator!=(const SlotHandle &other) const { return !(*this == other); }
+};
+
+// Values packed in one array with a slot table in front, insert, erase and lookup are O(1). Erasing
+// moves the last value into the hole, so pointers into the map only hold until the next erase, and
+// bumps the generation of the slot so old handles to it stop resolving.
+template <typename T, typename Tag = T> class SlotMap {
+  public:
+    typedef SlotHandle<Tag> Handle;
+
+    template <typename... Args> Handle emplace(Args &&...args) {
+        uint32_t index;
+        if (_freeHead != NONE) {
+            index     = _freeHead;
+            _freeHead = _slots[index].dense;
+        } else {
+            index = (uint32_t)_slots.size();
+            _slots.push_back(Slot{0, 1});
+        }
+
+        _slots[index].dense = (uint32_t)_values.size();
+        _values.emplace_back(std::forward<Args>(args)...);
+        _slotOf.push_back(index);
+        return Handle{index, _slots[index].generation};
+    }
+    Handle insert(const T &value) { return emplace(value); }
+    Handle insert(T &&value) { return emplace(std::move(value)); }
+
+    // false when the handle was already stale
+    bool erase(Handle handle) {
+        if (!contains(handle)) {
+            return false;
+        }
+
+        Slot    &slot = _slots[handle.index];
+        uint32_t last = (uint32_t)_values.size() - 1;
+        if (slot.dense != last) {
+            _values[slot.dense]         = std::move(_values[last]);
+            _slotOf[slot.dense]         = _slotOf[last];
+            _slots[_slotOf[last]].dense = slot.dense;
+        }
+        _values.pop_back();
+        _slotOf.pop_back();
+
+        slot.generation = slot.generation + 1 == 0 ? 1 : slot.generation + 1;
+        slot.dense      = _freeHead;
+        _freeHead       = handle.index;
+        return true;
+    }
+
+    // the value of a live slot points back at it, a free slot holds the next free one in dense instead
+    bool contains(Handle handle) const {
+        if (handle.index >= _slots.size() || handle.is_null()) {
+            return false;
+        }
+        const Slot &slot = _slots[handle.index];
+        return slot.generation == handle.generation && slot.dense < _slotOf.size() && _slotOf[slot.dense] == handle.index;
+    }
+
+    // nullptr for stale handles
+    T       *get(Handle handle) { return contains(handle) ? &_values[_slots[handle.index].dense] : nullptr; }
+    const T *get(Handle handle) const { return contains(handle) ? &_values[_slots[handle.index].dense] : nullptr; }
+
+    void clear() {
+        // keeps the slots so old handles stay stale
+        for (uint32_t index : _slotOf) {
+            Slot &slot      = _slots[index];
+            slot.generation = slot.generation + 1 == 0 ? 1 : slot.generation + 1;
+            slot.dense      = _freeHead;
+            _freeHead       = index;
+        }
+        _values.clear();
+        _slotOf.clear();
+    }
+
+    void reserve(uint32_t count) {
+        _values.reserve(count);
+        _slotOf.reserve(count);
+        _slots.reserve(count);
+    }
+
+    uint32_t size() const { return (uint32_t)_values.size(); }
+    bool     empty() const { return _values.empty(); }
+
+    // live values in packed order, which changes on erase
+    T       *begin() { return _values.data(); }
+    T       *end() { return _values.data() + _values.size(); }
+    const T *begin() const { return _values.data(); }
+    const T *end() const { return _values.data() + _values.size(); }
+
+    // handle of the value at begin() + dense
+    Handle handle_at(uint32_t dense) const { return Handle{_slotOf[dense], _slots[_slotOf[dense]].generation}; }
+
+  private:
+    static constexpr uint32_t NONE = 0xFFFFFFFF;
+
+    struct Slot {
+        uint32_t dense; // index in _values, the next free slot while free
+        uint32_t generation;
+    };
+
+    std::vector<T>        _values;
+    std::vector<uint32_t> _slotOf; // slot of every value
+    std::vector<Slot>     _slots;
+    uint32_t              _freeHead = NONE;
+};
@@ -0,0 +1,214 @@
+#include "transform_hierarchy.h"
+
+#include "simd.h"
+
+#include <algorithm>
+#include <cstdio>
+
+const uint32_t PARALLEL_MIN_NODES = 2048; // smaller levels are composed on the calling thread
+const uint32_t NODES_PER_JOB      = 512;
+
+uint32_t TransformHierarchy::create(uint32_t parent, const glm::mat4 &local, uint32_t object) {
+    uint32_t id;
+    if (!_freeIds.empty()) {
+        id = _freeIds.back();
+        _freeIds.pop_back();
+    } else {
+        id = (uint32_t)_indexOf.size();
+        _indexOf.push_back(NULL_NODE);
+    }
+
+    // appended at the end, update moves it to its level
+    _indexOf[id] = (uint32_t)_ids.size();
+    _ids.push_back(id);
+    _parents.push_back(parent == NULL_NODE ? NULL_NODE : _indexOf[parent]);
+    _objects.push_back(object);
+    _dirty.push_back(1);
+    _locals.push_back(local);
+    _worlds.push_back(local);
+    _unsorted = true;
+    return id;
+}
+
+uint32_t TransformHierarchy::get_parent(uint32_t node) const {
+    uint32_t parent = _parents[_indexOf[node]];
+    return parent == NULL_NODE ? NULL_NODE : _ids[parent];
+}
+
+void TransformHierarchy::set_parent(uint32_t node, uint32_t parent) {
+    uint32_t index       = _indexOf[node];
+    uint32_t parentIndex = parent == NULL_NODE ? NULL_NODE : _indexOf[parent];
+
+    for (uint32_t above = parentIndex; above != NULL_NODE; above = _parents[above]) {
+        if (above == index) {
+            printf("transform node %u can't be parented to its own child %u\n", node, parent);
+            return;
+        }
+    }
+
+    _parents[index] = parentIndex;
+    _dirty[index]   = 1;
+    _unsorted       = true;
+}
+
+void TransformHierarchy::destroy(uint32_t node) {
+    if (!alive(node)) {
+        return;
+    }
+    if (_unsorted) {
+        sort_by_depth();
+    }
+
+    // parents come first, so one pass finds the whole subtree. Kept nodes stay in order.
+    std::vector<uint32_t> newIndex(_ids.size());
+    uint32_t              root = _indexOf[node];
+    uint32_t              kept = 0;
+    for (uint32_t i = 0; i < _ids.size(); i++) {
+        uint32_t parent = _parents[i];
+        if (i == root || (parent != NULL_NODE && newIndex[parent] == NULL_NODE)) {
+            newIndex[i]       = NULL_NODE;
+            _indexOf[_ids[i]] = NULL_NODE;
+            _freeIds.push_back(_ids[i]);
+            continue;
+        }
+
+        newIndex[i]       = kept;
+        _ids[kept]        = _ids[i];
+        _parents[kept]    = parent == NULL_NODE ? NULL_NODE : newIndex[parent];
+        _objects[kept]    = _objects[i];
+        _dirty[kept]      = _dirty[i];
+        _locals[kept]     = _locals[i];
+        _worlds[kept]     = _worlds[i];
+        _indexOf[_ids[i]] = kept;
+        kept++;
+    }
+
+    _ids.resize(kept);
+    _parents.resize(kept);
+    _objects.resize(kept);
+    _dirty.resize(kept);
+    _locals.resize(kept);
+    _worlds.resize(kept);
+    _unsorted = true; // levels moved
+}
+
+// stable counting sort on the depth, also rebuilds the level starts
+void TransformHierarchy::sort_by_depth() {
+    uint32_t count = (uint32_t)_ids.size();
+
+    // walks up to the first node with a known depth and fills in the chain on the way back
+    std::vector<uint32_t> depths(count, NULL_NODE);
+    std::vector<uint32_t> chain;
+    uint32_t              levels = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t index = i;
+        while (index != NULL_NODE && depths[index] == NULL_NODE) {
+            chain.push_back(index);
+            index = _parents[index];
+        }
+        uint32_t depth = index == NULL_NODE ? 0 : depths[index] + 1;
+        for (; !chain.empty(); chain.pop_back(), depth++) {
+            depths[chain.back()] = depth;
+        }
+        levels = std::max(levels, depths[i] + 1);
+    }
+
+    _levelStarts.assign(levels + 1, 0);
+    for (uint32_t i = 0; i < count; i++) {
+        _levelStarts[depths[i] + 1]++;
+    }
+    for (uint32_t level = 0; level < levels; level++) {
+        _levelStarts[level + 1] += _levelStarts[level];
+    }
+
+    std::vector<uint32_t> newIndex(count);
+    std::vector<uint32_t> next(_levelStarts.begin(), _levelStarts.end() - 1);
+    for (uint32_t i = 0; i < count; i++) {
+        newIndex[i] = next[depths[i]]++;
+    }
+
+    std::vector<uint32_t>  ids(count), parents(count), objects(count);
+    std::vector<uint8_t>   dirty(count);
+    std::vector<glm::mat4> locals(count), worlds(count);
+    for (uint32_t i = 0; i < count; i++) {
+        uint32_t to       = newIndex[i];
+        ids[to]           = _ids[i];
+        parents[to]       = _parents[i] == NULL_NODE ? NULL_NODE : newIndex[_parents[i]];
+        objects[to]       = _objects[i];
+        dirty[to]         = _dirty[i];
+        locals[to]        = _locals[i];
+        worlds[to]        = _worlds[i];
+        _indexOf[ids[to]] = to;
+    }
+
+    _ids      = std::move(ids);
+    _parents  = std::move(parents);
+    _objects  = std::move(objects);
+    _dirty    = std::move(dirty);
+    _locals   = std::move(locals);
+    _worlds   = std::move(worlds);
+    _unsorted = false;
+}
+
+// world = parent world * local, the parents are a level up and already done
+void TransformHierarchy::compose(const uint32_t *indices, uint32_t count) {
+    for (uint32_t k = 0; k < count; k++) {
+        uint32_t index  = indices[k];
+        uint32_t parent = _parents[index];
+        if (parent == NULL_NODE) {
+            _worlds[index] = _locals[index];
+        } else {
+            simd::mat4_multiply(&_worlds[index][0][0], &_worlds[parent][0][0], &_locals[index][0][0]);
+        }
+    }
+}
+
+void TransformHierarchy::update(JobSystem *jobs) {
+    if (_unsorted) {
+        sort_by_depth();
+    }
+
+    _changed.clear();
+    for (uint32_t level = 0; level + 1 < _levelStarts.size(); level++) {
+        // a node is dirty when it was set or its parent was recomputed
+        _levelDirty.clear();
+        for (uint32_t i = _levelStarts[level]; i < _levelStarts[level + 1]; i++) {
+            uint32_t parent = _parents[i];
+            _dirty[i] |= parent != NULL_NODE && _dirty[parent];
+            if (_dirty[i]) {
+                _levelDirty.push_back(i);
+            }
+        }
+
+        uint32_t dirtyCount = (uint32_t)_levelDirty.size();
+        if (jobs && dirtyCount >= PARALLEL_MIN_NODES) {
+            jobs->parallel_for(dirtyCount, NODES_PER_JOB, [&](uint32_t begin, uint32_t end) { compose(_levelDirty.data() + begin, end - begin); });
+        } else {
+            compose(_levelDirty.data(), dirtyCount);
+        }
+
+        for (uint32_t index : _levelDirty) {
+            _changed.push_back(_ids[index]);
+        }
+    }
+
+    // the flags are cleared only now, children read them from their parents above
+    _levelDirty.clear();
+    for (uint32_t node : _changed) {
+        uint32_t index = _indexOf[node];
+        _dirty[index]  = 0;
+        if (_objects[index] != NO_OBJECT) {
+            _levelDirty.push_back(_objects[index]);
+        }
+    }
+
+    std::sort(_levelDirty.begin(), _levelDirty.end());
+    _dirtyRanges.clear();
+    for (uint32_t object : _levelDirty) {
+        if (!_dirtyRanges.empty() && _dirtyRanges.back().first + _dirtyRanges.back().count >= object) {
+            _dirtyRanges.back().count = object - _dirtyRanges.back().first + 1;
+        } else {
+            _dirtyRanges.push_back(ObjectRange{object, 1});
+        }
+    }
+}
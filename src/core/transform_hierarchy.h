@@ -0,0 +1,77 @@
+#pragma once
+
+#include "job_system.h"
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+const uint32_t NULL_NODE = 0xFFFFFFFF;
+const uint32_t NO_OBJECT = 0xFFFFFFFF;
+
+// consecutive object slots, first..first + count - 1
+struct ObjectRange {
+    uint32_t first;
+    uint32_t count;
+};
+
+// Parent/child transforms in flat arrays sorted by depth, roots first, so every parent is done
+// before its children and one level is a contiguous batch. Nodes are handed out as stable ids, the
+// arrays behind them are reordered when the tree changes shape. Only nodes whose local transform
+// changed, and everything below them, are recomputed by update.
+class TransformHierarchy {
+  public:
+    // object is an output slot (the instance in the object buffer) or NO_OBJECT for grouping nodes
+    uint32_t create(uint32_t parent = NULL_NODE, const glm::mat4 &local = glm::mat4(1.0f), uint32_t object = NO_OBJECT);
+    // removes the node together with all of its children
+    void destroy(uint32_t node);
+    // keeps the local transform, the world transform follows the new parent. Refused when parent is below node.
+    void set_parent(uint32_t node, uint32_t parent);
+
+    // different nodes can be set from different threads
+    void set_local(uint32_t node, const glm::mat4 &local) {
+        uint32_t index = _indexOf[node];
+        _locals[index] = local;
+        _dirty[index]  = 1;
+    }
+
+    bool             alive(uint32_t node) const { return node < _indexOf.size() && _indexOf[node] != NULL_NODE; }
+    uint32_t         get_parent(uint32_t node) const;
+    uint32_t         get_object(uint32_t node) const { return _objects[_indexOf[node]]; }
+    const glm::mat4 &get_local(uint32_t node) const { return _locals[_indexOf[node]]; }
+    // as of the last update
+    const glm::mat4 &get_world(uint32_t node) const { return _worlds[_indexOf[node]]; }
+
+    // recomputes the world transforms of the dirty subtrees, levels with many dirty nodes are split over jobs
+    void update(JobSystem *jobs = nullptr);
+
+    // nodes whose world transform changed in the last update, parents before children
+    const std::vector<uint32_t> &get_changed() const { return _changed; }
+    // object slots of the changed nodes, sorted and merged, so only these parts of the object buffer are written back
+    const std::vector<ObjectRange> &get_dirty_ranges() const { return _dirtyRanges; }
+
+    uint32_t get_node_count() const { return (uint32_t)_ids.size(); }
+    uint32_t get_depth() const { return _levelStarts.empty() ? 0 : (uint32_t)_levelStarts.size() - 1; }
+
+  private:
+    void sort_by_depth();
+    void compose(const uint32_t *indices, uint32_t count);
+
+    // by index, in depth order after each update
+    std::vector<uint32_t>  _ids;
+    std::vector<uint32_t>  _parents; // index of the parent, NULL_NODE for roots
+    std::vector<uint32_t>  _objects;
+    std::vector<uint8_t>   _dirty;
+    std::vector<glm::mat4> _locals;
+    std::vector<glm::mat4> _worlds;
+
+    // by id
+    std::vector<uint32_t> _indexOf; // NULL_NODE for free ids
+    std::vector<uint32_t> _freeIds;
+
+    std::vector<uint32_t>    _levelStarts; // first index of every depth, plus the node count at the end
+    bool                     _unsorted = false;
+    std::vector<uint32_t>    _levelDirty;
+    std::vector<uint32_t>    _changed;
+    std::vector<ObjectRange> _dirtyRanges;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Single producer / single consumer hand-off of the latest value. The writer fills write_buffer()
+// and publishes it, the reader always gets the newest published value. Neither side ever waits.
+template <typename T> class TripleBuffer {
+  public:
+    T &write_buffer() { return _slots[_writeIndex].value; }
+
+    void publish() {
+        uint32_t previous = _middle.exchange(_writeIndex | FRESH_BIT, std::memory_order_acq_rel);
+        _writeIndex       = previous & INDEX_MASK;
+    }
+
+    // newest published value, or the last one read if nothing new arrived
+    const T &read() {
+        if (_middle.load(std::memory_order_relaxed) & FRESH_BIT) {
+            uint32_t previous = _middle.exchange(_readIndex, std::memory_order_acq_rel);
+            _readIndex        = previous & INDEX_MASK;
+        }
+        return _slots[_readIndex].value;
+    }
+
+    bool has_new() const { return _middle.load(std::memory_order_relaxed) & FRESH_BIT; }
+
+  private:
+    static const uint32_t INDEX_MASK = 0x3;
+    static const uint32_t FRESH_BIT  = 0x4;
+
+    // one cache line each so the two threads don't fight over them
+    struct alignas(64) Slot {
+        T value{};
+    };
+
+    Slot                  _slots[3];
+    alignas(64) std::atomic<uint32_t> _middle{1};
+    alignas(64) uint32_t  _writeIndex = 0; // only touched by the writer
+    alignas(64) uint32_t  _readIndex  = 2; // only touched by the reader
+};
@@ -0,0 +1,65 @@
+#include "ccd.h"
+
+#include <algorithm>
+#include <cfloat>
+
+// Slab test of the box center against target grown by the box extents
+bool sweep_aabb(const AABB &box, glm::vec3 delta, const AABB &target, SweepHit &hit) {
+    glm::vec3 origin  = box.center();
+    glm::vec3 extents = box.extents();
+    glm::vec3 slabMin = target.min - extents;
+    glm::vec3 slabMax = target.max + extents;
+    float     enter   = -FLT_MAX;
+    float     exit    = FLT_MAX;
+    int       hitAxis = 0;
+
+    for (int axis = 0; axis < 3; axis++) {
+        if (delta[axis] == 0.0f) {
+            if (origin[axis] <= slabMin[axis] || origin[axis] >= slabMax[axis]) {
+                return false;
+            }
+            continue;
+        }
+
+        float t0 = (slabMin[axis] - origin[axis]) / delta[axis];
+        float t1 = (slabMax[axis] - origin[axis]) / delta[axis];
+        if (t0 > t1) {
+            std::swap(t0, t1);
+        }
+
+        if (t0 > enter) {
+            enter   = t0;
+            hitAxis = axis;
+        }
+        exit = glm::min(exit, t1);
+    }
+
+    // already touching at the start is left to the contact solver
+    if (enter > exit || enter < 0.0f || enter > 1.0f) {
+        return false;
+    }
+
+    hit.time            = enter;
+    hit.normal          = glm::vec3(0.0f);
+    hit.normal[hitAxis] = delta[hitAxis] > 0.0f ? -1.0f : 1.0f;
+    return true;
+}
+
+bool sweep_blocks(const ChunkStore &world, const AABB &box, glm::vec3 delta, SweepHit &hit) {
+    AABB       swept = box.swept(delta);
+    glm::ivec3 minBlock(glm::floor(swept.min));
+    glm::ivec3 maxBlock(glm::floor(swept.max));
+
+    bool found = false;
+    hit.time   = 1.0f;
+
+    world.for_each_solid(minBlock, maxBlock, [&](glm::ivec3 block) {
+        AABB     blockBox{glm::vec3(block), glm::vec3(block) + 1.0f};
+        SweepHit blockHit;
+        if (sweep_aabb(box, delta, blockBox, blockHit) && blockHit.time <= hit.time) {
+            hit   = blockHit;
+            found = true;
+        }
+    });
+    return found;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "../collision/aabb.h"
+#include "../collision/voxel_world.h"
+
+#include <glm/glm.hpp>
+
+struct SweepHit {
+    float     time;   // fraction of the movement, 0..1
+    glm::vec3 normal; // surface normal of what was hit, points against the movement
+};
+
+// first time a box moving by delta touches target, boxes that already overlap at the start are ignored
+bool sweep_aabb(const AABB &box, glm::vec3 delta, const AABB &target, SweepHit &hit);
+
+// first solid block the moving box touches, only the blocks inside the swept volume are visited
+bool sweep_blocks(const ChunkStore &world, const AABB &box, glm::vec3 delta, SweepHit &hit);
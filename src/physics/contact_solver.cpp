@@ -0,0 +1,192 @@
+#include "contact_solver.h"
+
+#include <algorithm>
+#include <cmath>
+
+static void compute_tangents(glm::vec3 normal, glm::vec3 &tangent0, glm::vec3 &tangent1) {
+    if (std::fabs(normal.x) >= 0.57735f) {
+        tangent0 = glm::normalize(glm::vec3(normal.y, -normal.x, 0.0f));
+    } else {
+        tangent0 = glm::normalize(glm::vec3(0.0f, normal.z, -normal.y));
+    }
+    tangent1 = glm::cross(normal, tangent0);
+}
+
+static float effective_mass(float inverseMassA, const glm::mat3 &inverseInertiaA, float inverseMassB, const glm::mat3 &inverseInertiaB, glm::vec3 rA, glm::vec3 rB, glm::vec3 direction) {
+    glm::vec3 angularA = glm::cross(rA, direction);
+    glm::vec3 angularB = glm::cross(rB, direction);
+
+    float k = inverseMassA + inverseMassB + glm::dot(angularA, inverseInertiaA * angularA) + glm::dot(angularB, inverseInertiaB * angularB);
+    return k > 0.0f ? 1.0f / k : 0.0f;
+}
+
+void IslandSolver::apply_impulse(ManifoldConstraint &constraint, PointConstraint &point, glm::vec3 impulse) {
+    SolverBody &a = _bodies[constraint.a];
+    SolverBody &b = _bodies[constraint.b];
+
+    a.linearVelocity -= impulse * a.inverseMass;
+    a.angularVelocity -= a.inverseInertia * glm::cross(point.rA, impulse);
+    b.linearVelocity += impulse * b.inverseMass;
+    b.angularVelocity += b.inverseInertia * glm::cross(point.rB, impulse);
+}
+
+void IslandSolver::solve(std::vector<RigidBody> &bodies, const uint32_t *islandBodies, uint32_t bodyCount, ContactManifold *const *manifolds, uint32_t manifoldCount, uint32_t *localIndex, float dt,
+                         const SolverSettings &settings) {
+    /*Bodies*/
+    // index 0 stands in for every static body and the blocks
+    _bodies.resize(bodyCount + 1);
+    _bodies[0] = SolverBody{glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f), glm::vec3(0.0f), glm::mat3(0.0f), 0.0f};
+
+    for (uint32_t i = 0; i < bodyCount; i++) {
+        const RigidBody &body = bodies[islandBodies[i]];
+        glm::mat3        R    = glm::mat3_cast(body.orientation);
+        glm::mat3        inertia(glm::vec3(body.inverseInertia.x, 0.0f, 0.0f), glm::vec3(0.0f, body.inverseInertia.y, 0.0f), glm::vec3(0.0f, 0.0f, body.inverseInertia.z));
+
+        SolverBody &solverBody         = _bodies[i + 1];
+        solverBody.linearVelocity      = body.linearVelocity;
+        solverBody.angularVelocity     = body.angularVelocity;
+        solverBody.biasLinearVelocity  = glm::vec3(0.0f);
+        solverBody.biasAngularVelocity = glm::vec3(0.0f);
+        solverBody.inverseInertia      = R * inertia * glm::transpose(R);
+        solverBody.inverseMass         = body.inverseMass;
+
+        localIndex[islandBodies[i]] = i + 1;
+    }
+
+    auto local_body = [&](uint32_t body) -> uint32_t { return body == WORLD_BODY || bodies[body].is_static() ? 0 : localIndex[body]; };
+
+    /*Constraints*/
+    _manifolds.clear();
+    _points.clear();
+
+    for (uint32_t i = 0; i < manifoldCount; i++) {
+        ContactManifold &manifold = *manifolds[i];
+
+        ManifoldConstraint constraint;
+        constraint.a          = local_body(manifold.bodyA);
+        constraint.b          = local_body(manifold.bodyB);
+        constraint.normal     = manifold.normal;
+        constraint.firstPoint = (uint32_t)_points.size();
+        constraint.pointCount = manifold.pointCount;
+        compute_tangents(manifold.normal, constraint.tangent[0], constraint.tangent[1]);
+
+        const RigidBody &bodyA       = bodies[manifold.bodyA];
+        float            frictionB   = manifold.bodyB == WORLD_BODY ? settings.worldFriction : bodies[manifold.bodyB].friction;
+        float            restitution = manifold.bodyB == WORLD_BODY ? bodyA.restitution : std::max(bodyA.restitution, bodies[manifold.bodyB].restitution);
+        constraint.friction          = std::sqrt(bodyA.friction * frictionB);
+
+        const SolverBody &a = _bodies[constraint.a];
+        const SolverBody &b = _bodies[constraint.b];
+
+        for (uint32_t p = 0; p < manifold.pointCount; p++) {
+            ContactPoint &contact = manifold.points[p];
+
+            PointConstraint point;
+            point.point       = &contact;
+            point.rA          = constraint.a != 0 ? contact.position - bodyA.position : glm::vec3(0.0f);
+            point.rB          = constraint.b != 0 ? contact.position - bodies[manifold.bodyB].position : glm::vec3(0.0f);
+            point.biasImpulse = 0.0f;
+
+            point.normalMass = effective_mass(a.inverseMass, a.inverseInertia, b.inverseMass, b.inverseInertia, point.rA, point.rB, constraint.normal);
+            for (int k = 0; k < 2; k++) {
+                point.tangentMass[k] = effective_mass(a.inverseMass, a.inverseInertia, b.inverseMass, b.inverseInertia, point.rA, point.rB, constraint.tangent[k]);
+            }
+
+            // a point that is not touching yet lets the bodies close the gap this step
+            point.velocityBias = contact.depth < 0.0f ? contact.depth / dt : 0.0f;
+
+            glm::vec3 relative = b.linearVelocity + glm::cross(b.angularVelocity, point.rB) - a.linearVelocity - glm::cross(a.angularVelocity, point.rA);
+            float     closing  = glm::dot(relative, constraint.normal);
+            if (closing < -settings.restitutionThreshold) {
+                point.velocityBias = std::max(point.velocityBias, -restitution * closing);
+            }
+
+            _points.push_back(point);
+        }
+        _manifolds.push_back(constraint);
+    }
+
+    /*Warm start*/
+    for (ManifoldConstraint &constraint : _manifolds) {
+        for (uint32_t p = 0; p < constraint.pointCount; p++) {
+            PointConstraint &point   = _points[constraint.firstPoint + p];
+            glm::vec3        impulse = constraint.normal * point.point->normalImpulse + constraint.tangent[0] * point.point->tangentImpulse[0] + constraint.tangent[1] * point.point->tangentImpulse[1];
+            apply_impulse(constraint, point, impulse);
+        }
+    }
+
+    /*Velocities*/
+    for (uint32_t iteration = 0; iteration < settings.velocityIterations; iteration++) {
+        for (ManifoldConstraint &constraint : _manifolds) {
+            SolverBody &a = _bodies[constraint.a];
+            SolverBody &b = _bodies[constraint.b];
+
+            // friction first, normal impulses are more important and get the last word
+            for (uint32_t p = 0; p < constraint.pointCount; p++) {
+                PointConstraint &point       = _points[constraint.firstPoint + p];
+                float            maxFriction = constraint.friction * point.point->normalImpulse;
+
+                for (int k = 0; k < 2; k++) {
+                    glm::vec3 relative = b.linearVelocity + glm::cross(b.angularVelocity, point.rB) - a.linearVelocity - glm::cross(a.angularVelocity, point.rA);
+                    float     lambda   = -glm::dot(relative, constraint.tangent[k]) * point.tangentMass[k];
+
+                    float previous                 = point.point->tangentImpulse[k];
+                    point.point->tangentImpulse[k] = glm::clamp(previous + lambda, -maxFriction, maxFriction);
+                    apply_impulse(constraint, point, constraint.tangent[k] * (point.point->tangentImpulse[k] - previous));
+                }
+            }
+
+            for (uint32_t p = 0; p < constraint.pointCount; p++) {
+                PointConstraint &point    = _points[constraint.firstPoint + p];
+                glm::vec3        relative = b.linearVelocity + glm::cross(b.angularVelocity, point.rB) - a.linearVelocity - glm::cross(a.angularVelocity, point.rA);
+                float            lambda   = point.normalMass * (point.velocityBias - glm::dot(relative, constraint.normal));
+
+                float previous             = point.point->normalImpulse;
+                point.point->normalImpulse = std::max(previous + lambda, 0.0f);
+                apply_impulse(constraint, point, constraint.normal * (point.point->normalImpulse - previous));
+            }
+        }
+    }
+
+    /*Split impulse*/
+    for (uint32_t iteration = 0; iteration < settings.positionIterations; iteration++) {
+        for (ManifoldConstraint &constraint : _manifolds) {
+            SolverBody &a = _bodies[constraint.a];
+            SolverBody &b = _bodies[constraint.b];
+
+            for (uint32_t p = 0; p < constraint.pointCount; p++) {
+                PointConstraint &point = _points[constraint.firstPoint + p];
+
+                float target = settings.baumgarte * std::max(point.point->depth - settings.linearSlop, 0.0f) / dt;
+                if (target == 0.0f && point.biasImpulse == 0.0f) {
+                    continue;
+                }
+
+                glm::vec3 relative = b.biasLinearVelocity + glm::cross(b.biasAngularVelocity, point.rB) - a.biasLinearVelocity - glm::cross(a.biasAngularVelocity, point.rA);
+                float     lambda   = point.normalMass * (target - glm::dot(relative, constraint.normal));
+
+                float previous    = point.biasImpulse;
+                point.biasImpulse = std::max(previous + lambda, 0.0f);
+
+                glm::vec3 impulse = constraint.normal * (point.biasImpulse - previous);
+                a.biasLinearVelocity -= impulse * a.inverseMass;
+                a.biasAngularVelocity -= a.inverseInertia * glm::cross(point.rA, impulse);
+                b.biasLinearVelocity += impulse * b.inverseMass;
+                b.biasAngularVelocity += b.inverseInertia * glm::cross(point.rB, impulse);
+            }
+        }
+    }
+
+    /*Integrate*/
+    for (uint32_t i = 0; i < bodyCount; i++) {
+        RigidBody        &body       = bodies[islandBodies[i]];
+        const SolverBody &solverBody = _bodies[i + 1];
+
+        body.linearVelocity  = solverBody.linearVelocity;
+        body.angularVelocity = solverBody.angularVelocity;
+
+        glm::vec3 angular = solverBody.angularVelocity + solverBody.biasAngularVelocity;
+        body.position += (solverBody.linearVelocity + solverBody.biasLinearVelocity) * dt;
+        body.orientation = glm::normalize(body.orientation + glm::quat(0.0f, angular) * body.orientation * (0.5f * dt));
+    }
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "../collision/narrow_phase.h"
+#include "rigid_body.h"
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+struct SolverSettings {
+    uint32_t velocityIterations   = 8;
+    uint32_t positionIterations   = 3;
+    float    baumgarte            = 0.2f;   // part of the penetration removed per step
+    float    linearSlop           = 0.005f; // penetration that is left alone, keeps resting contacts from jittering
+    float    restitutionThreshold = 1.0f;   // slower impacts don't bounce
+    float    worldFriction        = 0.6f;   // friction of the blocks
+};
+
+// Sequential impulse solver for one island. The accumulated impulses of the contact points are used
+// to warm start and are written back for the next step. Penetration is fixed with split impulses,
+// a separate pseudo velocity that moves the bodies but is thrown away afterwards, so pushing boxes
+// apart doesn't add energy.
+class IslandSolver {
+  public:
+    // localIndex is scratch indexed by body, only the entries of this island are written so islands
+    // can be solved on different threads at the same time
+    void solve(std::vector<RigidBody> &bodies, const uint32_t *islandBodies, uint32_t bodyCount, ContactManifold *const *manifolds, uint32_t manifoldCount, uint32_t *localIndex, float dt,
+               const SolverSettings &settings);
+
+  private:
+    struct SolverBody {
+        glm::vec3 linearVelocity;
+        glm::vec3 angularVelocity;
+        glm::vec3 biasLinearVelocity;
+        glm::vec3 biasAngularVelocity;
+        glm::mat3 inverseInertia; // world space
+        float     inverseMass;
+    };
+
+    struct PointConstraint {
+        ContactPoint *point;
+        glm::vec3     rA;
+        glm::vec3     rB;
+        float         normalMass;
+        float         tangentMass[2];
+        float         velocityBias;
+        float         biasImpulse;
+    };
+
+    struct ManifoldConstraint {
+        uint32_t  a; // local body index, 0 is the fixed body
+        uint32_t  b;
+        glm::vec3 normal;
+        glm::vec3 tangent[2];
+        float     friction;
+        uint32_t  firstPoint;
+        uint32_t  pointCount;
+    };
+
+    void apply_impulse(ManifoldConstraint &constraint, PointConstraint &point, glm::vec3 impulse);
+
+    std::vector<SolverBody>         _bodies;
+    std::vector<ManifoldConstraint> _manifolds;
+    std::vector<PointConstraint>    _points;
+};
@@ -0,0 +1,291 @@
+#include "physics_world.h"
+
+#include "ccd.h"
+
+#include <algorithm>
+
+const uint32_t NO_ISLAND = 0xFFFFFFFF;
+
+// continuous bodies stop this far before what they hit, inside the contact margin so the contact is found next step
+const float SWEEP_BACKOFF = CONTACT_MARGIN * 0.5f;
+
+void PhysicsWorld::init(JobSystem *jobs, const ChunkStore *world) {
+    _jobs  = jobs;
+    _world = world;
+    _solvers.resize(jobs->worker_count() + 1);
+}
+
+uint32_t PhysicsWorld::add_box(glm::vec3 position, glm::vec3 halfExtents, float mass) {
+    RigidBody body;
+    body.position    = position;
+    body.halfExtents = halfExtents;
+    body.set_mass(mass);
+
+    _bodies.push_back(body);
+    return (uint32_t)_bodies.size() - 1;
+}
+
+void PhysicsWorld::step(float dt) {
+    for (RigidBody &body : _bodies) {
+        if (body.is_static() || !body.awake) {
+            continue;
+        }
+
+        body.linearVelocity += gravity * dt;
+        body.angularVelocity *= 1.0f / (1.0f + dt * angularDamping);
+    }
+
+    collide();
+    build_islands();
+
+    _continuousBodies.clear();
+    _continuousStart.clear();
+    for (uint32_t i = 0; i < (uint32_t)_bodies.size(); i++) {
+        if (_bodies[i].continuous && _bodies[i].awake && !_bodies[i].is_static()) {
+            _continuousBodies.push_back(i);
+            _continuousStart.push_back(_bodies[i].position);
+        }
+    }
+
+    _jobs->parallel_for((uint32_t)_islandOrder.size(), 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t i = begin; i < end; i++) {
+            solve_island(_islandOrder[i], dt);
+        }
+    });
+
+    solve_continuous();
+}
+
+void PhysicsWorld::collide() {
+    uint32_t count = (uint32_t)_bodies.size();
+    _boxes.resize(count);
+    _bounds.resize(count);
+
+    for (uint32_t i = 0; i < count; i++) {
+        _boxes[i] = _bodies[i].get_box();
+
+        // grown by the margin so contacts that are about to touch are found too
+        _bounds[i] = _boxes[i].get_bounds();
+        _bounds[i].min -= glm::vec3(CONTACT_MARGIN);
+        _bounds[i].max += glm::vec3(CONTACT_MARGIN);
+    }
+
+    _broadPhase.update(_bounds);
+
+    // pairs without anything awake and dynamic can't change
+    auto is_active = [&](uint32_t body) { return !_bodies[body].is_static() && _bodies[body].awake; };
+
+    _activePairs.clear();
+    for (const BroadPhasePair &pair : _broadPhase.get_pairs()) {
+        if (is_active(pair.a) || is_active(pair.b)) {
+            _activePairs.push_back(pair);
+        }
+    }
+
+    _worldQueries.clear();
+    for (uint32_t i = 0; i < count; i++) {
+        if (is_active(i)) {
+            _worldQueries.push_back(i);
+        }
+    }
+
+    _narrowPhase.collide(_boxes, _activePairs, _world, _worldQueries, *_jobs);
+}
+
+uint32_t PhysicsWorld::find_root(uint32_t body) {
+    while (_parent[body] != body) {
+        _parent[body] = _parent[_parent[body]];
+        body          = _parent[body];
+    }
+    return body;
+}
+
+void PhysicsWorld::build_islands() {
+    uint32_t                      count     = (uint32_t)_bodies.size();
+    std::vector<ContactManifold> &manifolds = _narrowPhase.get_manifolds();
+
+    _parent.resize(count);
+    for (uint32_t i = 0; i < count; i++) {
+        _parent[i] = i;
+    }
+
+    // static bodies and blocks don't join islands, everything resting on the ground would be one island otherwise
+    for (const ContactManifold &manifold : manifolds) {
+        if (manifold.bodyB == WORLD_BODY || _bodies[manifold.bodyA].is_static() || _bodies[manifold.bodyB].is_static()) {
+            continue;
+        }
+
+        uint32_t rootA = find_root(manifold.bodyA);
+        uint32_t rootB = find_root(manifold.bodyB);
+        if (rootA != rootB) {
+            _parent[std::max(rootA, rootB)] = std::min(rootA, rootB);
+        }
+    }
+
+    // an island with one awake body wakes up completely, the ids are handed out to the roots first
+    _islandOfBody.assign(count, NO_ISLAND);
+    uint32_t islandCount = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        if (!_bodies[i].is_static() && _bodies[i].awake) {
+            uint32_t root = find_root(i);
+            if (_islandOfBody[root] == NO_ISLAND) {
+                _islandOfBody[root] = islandCount++;
+            }
+        }
+    }
+
+    _islandBodyStart.assign(islandCount + 1, 0);
+    for (uint32_t i = 0; i < count; i++) {
+        if (_bodies[i].is_static()) {
+            continue;
+        }
+
+        uint32_t island = _islandOfBody[find_root(i)];
+        if (island == NO_ISLAND) {
+            continue;
+        }
+
+        _islandOfBody[i] = island;
+        if (!_bodies[i].awake) {
+            _bodies[i].wake_up();
+        }
+        _islandBodyStart[island + 1]++;
+    }
+
+    // counting sort of the bodies and manifolds by island
+    for (uint32_t i = 0; i < islandCount; i++) {
+        _islandBodyStart[i + 1] += _islandBodyStart[i];
+    }
+    _islandBodies.resize(_islandBodyStart[islandCount]);
+    std::vector<uint32_t> cursor(_islandBodyStart.begin(), _islandBodyStart.end() - 1);
+    for (uint32_t i = 0; i < count; i++) {
+        if (!_bodies[i].is_static() && _islandOfBody[i] != NO_ISLAND) {
+            _islandBodies[cursor[_islandOfBody[i]]++] = i;
+        }
+    }
+
+    auto manifold_island = [&](const ContactManifold &manifold) { return _bodies[manifold.bodyA].is_static() ? _islandOfBody[manifold.bodyB] : _islandOfBody[manifold.bodyA]; };
+
+    _islandManifoldStart.assign(islandCount + 1, 0);
+    for (const ContactManifold &manifold : manifolds) {
+        _islandManifoldStart[manifold_island(manifold) + 1]++;
+    }
+    for (uint32_t i = 0; i < islandCount; i++) {
+        _islandManifoldStart[i + 1] += _islandManifoldStart[i];
+    }
+    _islandManifolds.resize(_islandManifoldStart[islandCount]);
+    cursor.assign(_islandManifoldStart.begin(), _islandManifoldStart.end() - 1);
+    for (ContactManifold &manifold : manifolds) {
+        _islandManifolds[cursor[manifold_island(manifold)]++] = &manifold;
+    }
+
+    _islandOrder.resize(islandCount);
+    for (uint32_t i = 0; i < islandCount; i++) {
+        _islandOrder[i] = i;
+    }
+    std::sort(_islandOrder.begin(), _islandOrder.end(), [&](uint32_t a, uint32_t b) {
+        return _islandBodyStart[a + 1] - _islandBodyStart[a] > _islandBodyStart[b + 1] - _islandBodyStart[b];
+    });
+
+    _localIndex.resize(count);
+}
+
+void PhysicsWorld::solve_island(uint32_t island, float dt) {
+    const uint32_t *bodies        = &_islandBodies[_islandBodyStart[island]];
+    uint32_t        bodyCount     = _islandBodyStart[island + 1] - _islandBodyStart[island];
+    uint32_t        manifoldStart = _islandManifoldStart[island];
+    uint32_t        manifoldCount = _islandManifoldStart[island + 1] - manifoldStart;
+
+    IslandSolver &islandSolver = _solvers[JobSystem::thread_index()];
+    islandSolver.solve(_bodies, bodies, bodyCount, _islandManifolds.data() + manifoldStart, manifoldCount, _localIndex.data(), dt, solver);
+
+    /*Sleep*/
+    float minSleepTime = timeToSleep;
+    for (uint32_t i = 0; i < bodyCount; i++) {
+        RigidBody &body = _bodies[bodies[i]];
+
+        bool slow = glm::dot(body.linearVelocity, body.linearVelocity) < sleepLinearVelocity * sleepLinearVelocity &&
+                    glm::dot(body.angularVelocity, body.angularVelocity) < sleepAngularVelocity * sleepAngularVelocity;
+        body.sleepTime = slow ? body.sleepTime + dt : 0.0f;
+        minSleepTime   = std::min(minSleepTime, body.sleepTime);
+    }
+
+    if (minSleepTime < timeToSleep) {
+        return;
+    }
+
+    for (uint32_t i = 0; i < bodyCount; i++) {
+        RigidBody &body      = _bodies[bodies[i]];
+        body.awake           = false;
+        body.linearVelocity  = glm::vec3(0.0f);
+        body.angularVelocity = glm::vec3(0.0f);
+    }
+}
+
+// Sweeps the movement the solver gave each continuous body against the blocks and the other bodies.
+// Blocks stop the body and the rest of the movement slides along the surface, a hit body just stops
+// it at the contact and the solver handles the impact next step.
+void PhysicsWorld::solve_continuous() {
+    for (uint32_t k = 0; k < (uint32_t)_continuousBodies.size(); k++) {
+        RigidBody &body  = _bodies[_continuousBodies[k]];
+        glm::vec3  start = _continuousStart[k];
+        glm::vec3  delta = body.position - start;
+
+        // moving less than half its size per step, the regular contacts catch it
+        float minExtent = glm::min(body.halfExtents.x, glm::min(body.halfExtents.y, body.halfExtents.z));
+        if (glm::dot(delta, delta) < minExtent * minExtent * 0.25f) {
+            continue;
+        }
+
+        AABB      box      = OBB{start, body.halfExtents, glm::mat3_cast(body.orientation)}.get_bounds();
+        glm::vec3 position = start;
+
+        for (uint32_t sweep = 0; sweep < maxContinuousSteps; sweep++) {
+            SweepHit hit, candidate;
+            hit.time     = 1.0f;
+            bool found   = false;
+            bool hitBody = false;
+
+            if (_world != nullptr && sweep_blocks(*_world, box, delta, candidate)) {
+                hit   = candidate;
+                found = true;
+            }
+
+            _broadPhase.query(_bounds, box.swept(delta), _sweepCandidates);
+            for (uint32_t other : _sweepCandidates) {
+                if (other != _continuousBodies[k] && sweep_aabb(box, delta, _bodies[other].get_box().get_bounds(), candidate) && candidate.time < hit.time) {
+                    hit     = candidate;
+                    found   = true;
+                    hitBody = true;
+                }
+            }
+
+            if (!found) {
+                position += delta;
+                break;
+            }
+
+            float     time  = glm::max(hit.time - SWEEP_BACKOFF / glm::length(delta), 0.0f);
+            glm::vec3 moved = delta * time;
+            position += moved;
+            box.translate(moved);
+
+            if (hitBody) {
+                break;
+            }
+
+            float into = glm::dot(body.linearVelocity, hit.normal);
+            if (into < 0.0f) {
+                body.linearVelocity -= hit.normal * (into * (1.0f + body.restitution));
+            }
+
+            delta -= moved;
+            delta -= hit.normal * glm::min(glm::dot(delta, hit.normal), 0.0f);
+            if (glm::dot(delta, delta) < 1e-8f) {
+                break;
+            }
+        }
+
+        body.position = position;
+    }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include "../collision/broad_phase.h"
+#include "../collision/narrow_phase.h"
+#include "../collision/voxel_world.h"
+#include "../core/job_system.h"
+#include "contact_solver.h"
+#include "rigid_body.h"
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+
+// Rigid boxes colliding with each other and the solid blocks. Touching dynamic bodies are grouped
+// into islands, every island is solved on its own and islands that stay slow long enough fall
+// asleep until something awake touches them.
+class PhysicsWorld {
+  public:
+    void init(JobSystem *jobs, const ChunkStore *world);
+
+    // mass 0 adds a static body
+    uint32_t add_box(glm::vec3 position, glm::vec3 halfExtents, float mass);
+
+    RigidBody                    &get_body(uint32_t body) { return _bodies[body]; }
+    const std::vector<RigidBody> &get_bodies() const { return _bodies; }
+    uint32_t                      get_island_count() const { return (uint32_t)_islandOrder.size(); }
+
+    void step(float dt);
+
+    glm::vec3      gravity = glm::vec3(0.0f, -9.81f, 0.0f);
+    SolverSettings solver;
+
+    float angularDamping       = 0.05f;
+    float sleepLinearVelocity  = 0.05f;
+    float sleepAngularVelocity = 0.05f;
+    float timeToSleep          = 0.5f;
+
+    uint32_t maxContinuousSteps = 4; // sweeps per step for one continuous body, it slides along what it hits
+
+  private:
+    void     collide();
+    void     build_islands();
+    void     solve_island(uint32_t island, float dt);
+    void     solve_continuous();
+    uint32_t find_root(uint32_t body);
+
+    JobSystem        *_jobs  = nullptr;
+    const ChunkStore *_world = nullptr;
+
+    std::vector<RigidBody> _bodies;
+    std::vector<OBB>       _boxes;
+    std::vector<AABB>      _bounds;
+
+    SweepAndPrune               _broadPhase;
+    NarrowPhase                 _narrowPhase;
+    std::vector<BroadPhasePair> _activePairs;
+    std::vector<uint32_t>       _worldQueries;
+
+    /*Continuous*/
+    std::vector<uint32_t>  _continuousBodies;
+    std::vector<glm::vec3> _continuousStart; // positions before the solver moved them
+    std::vector<uint32_t>  _sweepCandidates;
+
+    /*Islands*/
+    std::vector<uint32_t>          _parent;              // union-find over the bodies
+    std::vector<uint32_t>          _islandOfBody;        // UINT32_MAX for static and sleeping bodies
+    std::vector<uint32_t>          _islandBodyStart;     // island i owns _islandBodies[start[i], start[i + 1])
+    std::vector<uint32_t>          _islandBodies;
+    std::vector<uint32_t>          _islandManifoldStart;
+    std::vector<ContactManifold *> _islandManifolds;
+    std::vector<uint32_t>          _islandOrder;         // biggest first so the long ones start early
+    std::vector<uint32_t>          _localIndex;
+    std::vector<IslandSolver>      _solvers;             // one per thread of the job system
+};
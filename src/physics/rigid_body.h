@@ -0,0 +1,47 @@
+#pragma once
+
+#include "../collision/obb.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// Box shaped body, a body with an inverse mass of zero never moves
+struct RigidBody {
+    glm::vec3 position        = glm::vec3(0.0f); // center of mass
+    glm::quat orientation     = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+    glm::vec3 linearVelocity  = glm::vec3(0.0f);
+    glm::vec3 angularVelocity = glm::vec3(0.0f);
+    glm::vec3 halfExtents     = glm::vec3(0.5f);
+
+    float     inverseMass    = 0.0f;
+    glm::vec3 inverseInertia = glm::vec3(0.0f); // local space, a box only has the diagonal
+    float     friction       = 0.6f;
+    float     restitution    = 0.0f;
+
+    bool continuous = false; // sweeps its movement every step so it can't pass through thin walls
+
+    bool  awake     = true;
+    float sleepTime = 0.0f; // how long the body has been slow enough to sleep
+
+    bool is_static() const { return inverseMass == 0.0f; }
+
+    // mass 0 makes the body static
+    void set_mass(float mass) {
+        if (mass <= 0.0f) {
+            inverseMass    = 0.0f;
+            inverseInertia = glm::vec3(0.0f);
+            return;
+        }
+
+        glm::vec3 size = halfExtents * halfExtents;
+        inverseMass    = 1.0f / mass;
+        inverseInertia = glm::vec3(3.0f / (mass * (size.y + size.z)), 3.0f / (mass * (size.x + size.z)), 3.0f / (mass * (size.x + size.y)));
+    }
+
+    void wake_up() {
+        awake     = true;
+        sleepTime = 0.0f;
+    }
+
+    OBB get_box() const { return OBB{position, halfExtents, glm::mat3_cast(orientation)}; }
+};
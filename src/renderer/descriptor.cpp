@@ -56,7 +56,7 @@ VkDescriptorSetLayout DescriptorLayoutBuilder::build(VkDevice device, VkShaderSt
 }
 
 void DescriptorWriter::write_image(int binding, VkImageView image, VkSampler sampler, VkImageLayout layout, VkDescriptorType type) {
-    VkDescriptorImageInfo &info = imageInfos.emplace_back(VkDescriptorImageInfo{.sampler = sampler, .imageView = image, .imageLayout = layout});
+    imageInfos.push_back(VkDescriptorImageInfo{.sampler = sampler, .imageView = image, .imageLayout = layout});
 
     VkWriteDescriptorSet write = {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
 
@@ -64,13 +64,13 @@ void DescriptorWriter::write_image(int binding, VkImageView image, VkSampler sam
     write.dstSet          = VK_NULL_HANDLE; // left empty for now until we need to write it
     write.descriptorCount = 1;
     write.descriptorType  = type;
-    write.pImageInfo      = &info;
+    write.pImageInfo      = nullptr; // set by update_set, the vector may still move
 
     writes.push_back(write);
 }
 
 void DescriptorWriter::write_buffer(int binding, VkBuffer buffer, size_t size, size_t offset, VkDescriptorType type) {
-    VkDescriptorBufferInfo &info = bufferInfos.emplace_back(VkDescriptorBufferInfo{.buffer = buffer, .offset = offset, .range = size});
+    bufferInfos.push_back(VkDescriptorBufferInfo{.buffer = buffer, .offset = offset, .range = size});
 
     VkWriteDescriptorSet write = {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
 
@@ -78,7 +78,7 @@ void DescriptorWriter::write_buffer(int binding, VkBuffer buffer, size_t size, s
     write.dstSet          = VK_NULL_HANDLE; // left empty for now until we need to write it
     write.descriptorCount = 1;
     write.descriptorType  = type;
-    write.pBufferInfo     = &info;
+    write.pBufferInfo     = nullptr; // set by update_set
 
     writes.push_back(write);
 }
@@ -89,9 +89,22 @@ void DescriptorWriter::clear() {
     bufferInfos.clear();
 }
 
+static bool is_image_descriptor(VkDescriptorType type) {
+    return type == VK_DESCRIPTOR_TYPE_SAMPLER || type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER || type == VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE || type == VK_DESCRIPTOR_TYPE_STORAGE_IMAGE ||
+           type == VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT;
+}
+
 void DescriptorWriter::update_set(VkDevice device, VkDescriptorSet set) {
+    // the writes use the infos in the order they were added
+    size_t image  = 0;
+    size_t buffer = 0;
     for (VkWriteDescriptorSet &write : writes) {
         write.dstSet = set;
+        if (is_image_descriptor(write.descriptorType)) {
+            write.pImageInfo = &imageInfos[image++];
+        } else {
+            write.pBufferInfo = &bufferInfos[buffer++];
+        }
     }
 
     vkUpdateDescriptorSets(device, (uint32_t)writes.size(), writes.data(), 0, nullptr);
@@ -3,7 +3,6 @@
 #include "vk_types.h"
 #include <cstddef>
 #include <cstdint>
-#include <deque>
 #include <span>
 #include <unordered_map>
 #include <vector>
@@ -24,10 +23,12 @@ struct Desc {
 //< descriptor_layout
 //
 //> writer
+// The infos are kept in vectors and the writes point into them only in update_set, so they can
+// grow freely and a writer that is cleared and reused keeps its memory.
 struct DescriptorWriter {
-    std::deque<VkDescriptorImageInfo>  imageInfos;
-    std::deque<VkDescriptorBufferInfo> bufferInfos;
-    std::vector<VkWriteDescriptorSet>  writes;
+    std::vector<VkDescriptorImageInfo>  imageInfos;
+    std::vector<VkDescriptorBufferInfo> bufferInfos;
+    std::vector<VkWriteDescriptorSet>   writes;
 
     void write_image(int binding, VkImageView image, VkSampler sampler, VkImageLayout layout, VkDescriptorType type);
     void write_buffer(int binding, VkBuffer buffer, size_t size, size_t offset, VkDescriptorType type);
@@ -6,10 +6,10 @@
 #include <cstring>
 
 namespace Quad {
-    AllocatedBuffer quadVerticesBuffer;
+    MeshRangeHandle quadMesh;
     AllocatedBuffer quadScreenBuffer;
     uint32_t verticesSize;
-    void init_quad_vertices() {
+    void init_quad_vertices(MeshArena &arena) {
 
         std::vector<VertexTemp> quadVertices = {
             // Vertex 1
@@ -24,41 +24,10 @@ namespace Quad {
             // Vertex 4
             {{0.5f, 0.5f, 0.0f}, {0.0f, 0.0f, 1.0f}, {1, 1}, 0},
         };
+        const std::vector<uint32_t> quadIndices = {0, 1, 2, 2, 1, 3};
 
         verticesSize = quadVertices.size();
-        const size_t vertexBufferSize = quadVertices.size() * sizeof(VertexTemp);
-
-        VkBufferCreateInfo stagingBufferInfo = {};
-        stagingBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        stagingBufferInfo.size = vertexBufferSize;
-        stagingBufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-
-        VmaAllocationCreateInfo stagingAllocInfo = {};
-        stagingAllocInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
-
-        AllocatedBuffer stagingBuffer;
-        VK_CHECK(vmaCreateBuffer(Helper::allocator, &stagingBufferInfo, &stagingAllocInfo, &stagingBuffer._buffer, &stagingBuffer._allocation, nullptr));
-
-        // Copy vertex data to staging buffer
-        void *stagingData;
-        vmaMapMemory(Helper::allocator, stagingBuffer._allocation, &stagingData);
-        memcpy(stagingData, quadVertices.data(), vertexBufferSize);
-        vmaUnmapMemory(Helper::allocator, stagingBuffer._allocation);
-
-        // Vertex buffer for GPU usage
-        VkBufferCreateInfo vertexBufferInfo = {};
-        vertexBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        vertexBufferInfo.size = vertexBufferSize;
-        vertexBufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
-
-        VmaAllocationCreateInfo vertexAllocInfo = {};
-        vertexAllocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-
-        VK_CHECK(vmaCreateBuffer(Helper::allocator, &vertexBufferInfo, &vertexAllocInfo, &quadVerticesBuffer._buffer, &quadVerticesBuffer._allocation, nullptr));
-
-        Helper::copy_buffer(stagingBuffer._buffer, quadVerticesBuffer._buffer, vertexBufferSize);
-
-        vmaDestroyBuffer(Helper::allocator, stagingBuffer._buffer, stagingBuffer._allocation);
+        quadMesh = arena.add(quadVertices.data(), quadVertices.size(), quadIndices.data(), quadIndices.size());
     }
 
     void init_quad_screen_vertices() {
@@ -111,15 +80,16 @@ namespace Quad {
 
         vmaDestroyBuffer(Helper::allocator, stagingBuffer._buffer, stagingBuffer._allocation);
     }
+    MeshRangeHandle get_mesh() { return quadMesh; }
     AllocatedBuffer get_screen_vertices() { return quadScreenBuffer; }
 } // namespace Quad
 
 namespace Cube {
 
-    AllocatedBuffer cubeVerticesBuffer;
+    MeshRangeHandle cubeMesh;
     uint32_t verticesSize = 0;
 
-    void init_cube_vertices() {
+    void init_cube_vertices(MeshArena &arena) {
 
         const std::vector<VertexTemp> cubeVertices = {                                                             // Right face
                                                       {{0.5f, 0.5f, 0.5f}, {1.0f, 0.0f, 0.0f}, {1.0f, 1.0f}, 0},   // Top left
@@ -170,49 +140,16 @@ namespace Cube {
                                                       {{-0.5f, -0.5f, -0.5f}, {0.0f, 0.0f, -1.0f}, {1.0f, 1.0f}, 4}};
 
         verticesSize = cubeVertices.size();
-
-        const size_t vertexBufferSize = cubeVertices.size() * sizeof(VertexTemp);
-
-        VkBufferCreateInfo stagingBufferInfo = {};
-        stagingBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        stagingBufferInfo.size = vertexBufferSize;
-        stagingBufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
-
-        VmaAllocationCreateInfo stagingAllocInfo = {};
-        stagingAllocInfo.usage = VMA_MEMORY_USAGE_CPU_ONLY;
-
-        AllocatedBuffer stagingBuffer;
-        VK_CHECK(vmaCreateBuffer(Helper::allocator, &stagingBufferInfo, &stagingAllocInfo, &stagingBuffer._buffer, &stagingBuffer._allocation, nullptr));
-
-        // Copy vertex data to staging buffer
-        void *stagingData;
-        vmaMapMemory(Helper::allocator, stagingBuffer._allocation, &stagingData);
-        memcpy(stagingData, cubeVertices.data(), vertexBufferSize);
-        vmaUnmapMemory(Helper::allocator, stagingBuffer._allocation);
-
-        // Vertex buffer for GPU usage
-        VkBufferCreateInfo vertexBufferInfo = {};
-        vertexBufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
-        vertexBufferInfo.size = vertexBufferSize;
-        vertexBufferInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
-
-        VmaAllocationCreateInfo vertexAllocInfo = {};
-        vertexAllocInfo.usage = VMA_MEMORY_USAGE_GPU_ONLY;
-
-        VK_CHECK(vmaCreateBuffer(Helper::allocator, &vertexBufferInfo, &vertexAllocInfo, &cubeVerticesBuffer._buffer, &cubeVerticesBuffer._allocation, nullptr));
-
-        Helper::copy_buffer(stagingBuffer._buffer, cubeVerticesBuffer._buffer, vertexBufferSize);
-
-        vmaDestroyBuffer(Helper::allocator, stagingBuffer._buffer, stagingBuffer._allocation);
+        cubeMesh = arena.add(cubeVertices.data(), cubeVertices.size(), nullptr, 0);
     }
 
-    const AllocatedBuffer get_vertices_buffer() { return cubeVerticesBuffer; };
+    MeshRangeHandle get_mesh() { return cubeMesh; }
     uint32_t get_vertices_size() { return verticesSize; }
 } // namespace Cube
 
-void init_mesh() {
-    Quad::init_quad_vertices();
+void init_mesh(MeshArena &arena) {
+    Quad::init_quad_vertices(arena);
     Quad::init_quad_screen_vertices();
 
-    Cube::init_cube_vertices();
+    Cube::init_cube_vertices(arena);
 }
\ No newline at end of file
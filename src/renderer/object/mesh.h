@@ -4,7 +4,8 @@
 #include "../vk_types.h"
 #include <cstdint>
 
-void init_mesh();
+// the block meshes go into the shared arena
+void init_mesh(MeshArena &arena);
 
 enum MeshType {
     Mesh_Quad,
@@ -21,6 +22,8 @@ namespace Block {
         BIRCH_TREE,
         BIRCH_PLANKS,
         FLOWER_RED,
+
+        TYPE_COUNT,
     };
 
     void init_texture();
@@ -30,18 +33,18 @@ namespace Block {
 } // namespace Block
 
 namespace Quad {
-    static AllocatedBuffer get_vertices();
+    MeshRangeHandle get_mesh();
     AllocatedBuffer get_screen_vertices();
 } // namespace Quad
 
 namespace Cube {
-    AllocatedBuffer get_vertices();
+    MeshRangeHandle get_mesh();
     uint32_t get_vertices_size();
-    const AllocatedBuffer get_vertices_buffer();
 } // namespace Cube
 
 namespace TextureHelper {
 
     void load_texture_array(const char *filePath, uint32_t gridLength, AllocatedImage &textureArray, VkImageView *view);
+    bool load_block_texture_array(const char *filePath, AllocatedImage &textureArray, VkImageView *view);
     void load_cube_map(AllocatedImage *cubeMapImage, VkImageView *view);
 } // namespace TextureHelper
@@ -94,15 +94,34 @@ namespace TextureHelper {
 
     void load_texture_array(const char *filePath, uint32_t gridLength, AllocatedImage &textureArray, VkImageView *view) {
         uint32_t layers;
-        Helper::create_texture_array(filePath, gridLength, textureArray, layers);
+        uint32_t levels;
+        Helper::create_texture_array(filePath, gridLength, textureArray, layers, levels);
 
         VkImageViewCreateInfo viewInfo = vkinit::imageview_create_info(VK_FORMAT_R8G8B8A8_SRGB, textureArray._image, VK_IMAGE_ASPECT_COLOR_BIT);
         viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
         viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
         viewInfo.pNext = nullptr;
         viewInfo.subresourceRange.layerCount = layers;
+        viewInfo.subresourceRange.levelCount = levels;
         viewInfo.image = textureArray._image;
 
         vkCreateImageView(Helper::device, &viewInfo, nullptr, view);
     }
+
+    bool load_block_texture_array(const char *filePath, AllocatedImage &textureArray, VkImageView *view) {
+        VkFormat format;
+        uint32_t layers;
+        uint32_t levels;
+        if (!Helper::create_block_texture_array(filePath, textureArray, format, layers, levels)) {
+            return false;
+        }
+
+        VkImageViewCreateInfo viewInfo = vkinit::imageview_create_info(format, textureArray._image, VK_IMAGE_ASPECT_COLOR_BIT);
+        viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+        viewInfo.subresourceRange.layerCount = layers;
+        viewInfo.subresourceRange.levelCount = levels;
+
+        vkCreateImageView(Helper::device, &viewInfo, nullptr, view);
+        return true;
+    }
 } // namespace TextureHelper
\ No newline at end of file
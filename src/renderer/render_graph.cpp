@@ -0,0 +1,514 @@
+#include "render_graph.h"
+
+#include "util/vk_initializers.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+void RenderGraph::init(VkDevice device, VmaAllocator allocator) {
+    _device    = device;
+    _allocator = allocator;
+}
+
+void RenderGraph::cleanup() {
+    for (Image &image : _images) {
+        if (image.transient && image.image != VK_NULL_HANDLE) {
+            vkDestroyImageView(_device, image.view, nullptr);
+            vkDestroyImage(_device, image.image, nullptr);
+            image.image = VK_NULL_HANDLE;
+            image.view  = VK_NULL_HANDLE;
+        }
+    }
+    for (MemoryBlock &block : _blocks) {
+        vmaFreeMemory(_allocator, block.allocation);
+    }
+    _blocks.clear();
+}
+
+/*Declare*/
+
+uint32_t RenderGraph::import_image(const char *name, VkImageAspectFlags aspect, VkImageLayout initialLayout, VkPipelineStageFlags2 initialStage, VkImageLayout finalLayout) {
+    Image image;
+    image.name          = name;
+    image.transient     = false;
+    image.info          = TransientImageInfo{VK_FORMAT_UNDEFINED, {0, 0}, 0, aspect};
+    image.initialLayout = initialLayout;
+    image.initialStage  = initialStage;
+    image.finalLayout   = finalLayout;
+    _images.push_back(image);
+    return (uint32_t)_images.size() - 1;
+}
+
+uint32_t RenderGraph::create_image(const char *name, const TransientImageInfo &info) {
+    Image image;
+    image.name          = name;
+    image.transient     = true;
+    image.info          = info;
+    image.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    image.initialStage  = VK_PIPELINE_STAGE_2_NONE;
+    image.finalLayout   = VK_IMAGE_LAYOUT_UNDEFINED;
+    _images.push_back(image);
+    return (uint32_t)_images.size() - 1;
+}
+
+uint32_t RenderGraph::import_buffer(const char *name, VkBuffer buffer, bool hostRead) {
+    _buffers.push_back(Buffer{name, buffer, hostRead});
+    return (uint32_t)_buffers.size() - 1;
+}
+
+uint32_t RenderGraph::add_pass(const char *name, ExecuteFn execute) {
+    Pass pass;
+    pass.name    = name;
+    pass.execute = std::move(execute);
+    _passes.push_back(std::move(pass));
+    return (uint32_t)_passes.size() - 1;
+}
+
+void RenderGraph::read(uint32_t pass, uint32_t image, ImageUsage usage) { _passes[pass].uses.push_back(Use{image, usage, false}); }
+
+void RenderGraph::write(uint32_t pass, uint32_t image, ImageUsage usage) {
+    if (usage == ImageUsage::SAMPLED || usage == ImageUsage::COMPUTE_SAMPLED) {
+        printf("render graph: pass %s writes %s through a sampler\n", _passes[pass].name.c_str(), _images[image].name.c_str());
+        abort();
+    }
+    _passes[pass].uses.push_back(Use{image, usage, true});
+}
+
+void RenderGraph::read_buffer(uint32_t pass, uint32_t buffer, BufferUsage usage) { _passes[pass].bufferUses.push_back(BufferUse{buffer, usage, false}); }
+
+void RenderGraph::write_buffer(uint32_t pass, uint32_t buffer, BufferUsage usage) {
+    if (usage == BufferUsage::INDIRECT || usage == BufferUsage::VERTEX || usage == BufferUsage::VERTEX_STORAGE) {
+        printf("render graph: pass %s writes %s as draw input\n", _passes[pass].name.c_str(), _buffers[buffer].name.c_str());
+        abort();
+    }
+    _passes[pass].bufferUses.push_back(BufferUse{buffer, usage, true});
+}
+
+void RenderGraph::set_side_effect(uint32_t pass) { _passes[pass].sideEffect = true; }
+
+/*Compile*/
+
+static void usage_state(ImageUsage usage, bool write, VkPipelineStageFlags2 &stages, VkAccessFlags2 &access, VkImageLayout &layout) {
+    switch (usage) {
+    case ImageUsage::COLOR_ATTACHMENT:
+        stages = VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT;
+        access = VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT | (write ? VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT : 0);
+        layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+        break;
+    case ImageUsage::DEPTH_ATTACHMENT:
+        stages = VK_PIPELINE_STAGE_2_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_2_LATE_FRAGMENT_TESTS_BIT;
+        access = VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_READ_BIT | (write ? VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT : 0);
+        layout = write ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL;
+        break;
+    case ImageUsage::SAMPLED:
+        stages = VK_PIPELINE_STAGE_2_FRAGMENT_SHADER_BIT;
+        access = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+        layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        break;
+    case ImageUsage::COMPUTE_SAMPLED:
+        stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        access = VK_ACCESS_2_SHADER_SAMPLED_READ_BIT;
+        layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        break;
+    case ImageUsage::STORAGE:
+        stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | (write ? VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT : 0);
+        layout = VK_IMAGE_LAYOUT_GENERAL;
+        break;
+    case ImageUsage::TRANSFER:
+        stages = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+        access = write ? VK_ACCESS_2_TRANSFER_WRITE_BIT : VK_ACCESS_2_TRANSFER_READ_BIT;
+        layout = write ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        break;
+    }
+}
+
+void RenderGraph::compile() {
+    // an image used twice by one pass has to be in one layout for both
+    for (const Pass &pass : _passes) {
+        for (uint32_t a = 0; a < pass.uses.size(); a++) {
+            for (uint32_t b = a + 1; b < pass.uses.size(); b++) {
+                VkPipelineStageFlags2 stages;
+                VkAccessFlags2        access;
+                VkImageLayout         layoutA, layoutB;
+                usage_state(pass.uses[a].usage, pass.uses[a].write, stages, access, layoutA);
+                usage_state(pass.uses[b].usage, pass.uses[b].write, stages, access, layoutB);
+                if (pass.uses[a].image == pass.uses[b].image && layoutA != layoutB) {
+                    printf("render graph: pass %s uses %s in two layouts\n", pass.name.c_str(), _images[pass.uses[a].image].name.c_str());
+                    abort();
+                }
+            }
+        }
+    }
+
+    cull();
+    place_transients();
+
+    // the first use of a transient waits for the last use of whatever had its memory before, which
+    // can be the last occupant of the previous frame
+    std::vector<ImageState> endStates;
+    std::vector<ImageState> bufferEndStates;
+    plan_barriers(false, endStates, bufferEndStates);
+    plan_barriers(true, endStates, bufferEndStates);
+}
+
+// backwards from the outputs, a pass is live when a later live pass or an output needs what it writes
+void RenderGraph::cull() {
+    std::vector<bool> needed(_images.size(), false);
+    for (uint32_t i = 0; i < _images.size(); i++) {
+        needed[i] = !_images[i].transient && _images[i].finalLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+    }
+
+    std::vector<bool> neededBuffers(_buffers.size(), false);
+    for (uint32_t i = 0; i < _buffers.size(); i++) {
+        neededBuffers[i] = _buffers[i].hostRead;
+    }
+
+    std::vector<bool> live(_passes.size(), false);
+    for (uint32_t i = (uint32_t)_passes.size(); i-- > 0;) {
+        const Pass &pass = _passes[i];
+
+        live[i] = pass.sideEffect;
+        for (const Use &use : pass.uses) {
+            live[i] = live[i] || (use.write && needed[use.image]);
+        }
+        for (const BufferUse &use : pass.bufferUses) {
+            live[i] = live[i] || (use.write && neededBuffers[use.buffer]);
+        }
+        if (live[i]) {
+            for (const Use &use : pass.uses) {
+                needed[use.image] = true;
+            }
+            for (const BufferUse &use : pass.bufferUses) {
+                neededBuffers[use.buffer] = true;
+            }
+        }
+    }
+
+    _order.clear();
+    for (uint32_t i = 0; i < _passes.size(); i++) {
+        if (live[i]) {
+            _order.push_back(i);
+        }
+    }
+}
+
+// Biggest images first, each goes into the first block whose images all live in other passes and
+// that has a compatible memory type. A block is as large as its largest image.
+void RenderGraph::place_transients() {
+    std::vector<uint32_t> transients;
+    for (uint32_t o = 0; o < _order.size(); o++) {
+        for (const Use &use : _passes[_order[o]].uses) {
+            Image &image = _images[use.image];
+            if (!image.transient) {
+                continue;
+            }
+            if (image.first == NO_GRAPH_IMAGE) {
+                image.first = o;
+                transients.push_back(use.image);
+            }
+            image.last = o;
+        }
+    }
+
+    for (uint32_t index : transients) {
+        Image &image = _images[index];
+
+        VkExtent3D        extent    = {image.info.extent.width, image.info.extent.height, 1};
+        VkImageCreateInfo imageInfo = vkinit::image_create_info(image.info.format, image.info.usage, extent);
+        VK_CHECK(vkCreateImage(_device, &imageInfo, nullptr, &image.image));
+        vkGetImageMemoryRequirements(_device, image.image, &image.requirements);
+        _transientSize += image.requirements.size;
+    }
+
+    std::sort(transients.begin(), transients.end(), [&](uint32_t a, uint32_t b) { return _images[a].requirements.size > _images[b].requirements.size; });
+
+    for (uint32_t index : transients) {
+        Image &image = _images[index];
+
+        for (uint32_t b = 0; b < _blocks.size() && image.block == NO_GRAPH_IMAGE; b++) {
+            MemoryBlock &block = _blocks[b];
+            if ((block.requirements.memoryTypeBits & image.requirements.memoryTypeBits) == 0) {
+                continue;
+            }
+
+            bool overlaps = false;
+            for (uint32_t other : block.images) {
+                overlaps = overlaps || (image.first <= _images[other].last && _images[other].first <= image.last);
+            }
+            if (!overlaps) {
+                block.requirements.size      = std::max(block.requirements.size, image.requirements.size);
+                block.requirements.alignment = std::max(block.requirements.alignment, image.requirements.alignment);
+                block.requirements.memoryTypeBits &= image.requirements.memoryTypeBits;
+                block.images.push_back(index);
+                image.block = b;
+            }
+        }
+
+        if (image.block == NO_GRAPH_IMAGE) {
+            MemoryBlock block;
+            block.requirements = image.requirements;
+            block.images.push_back(index);
+            image.block = (uint32_t)_blocks.size();
+            _blocks.push_back(std::move(block));
+        }
+    }
+
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage                   = VMA_MEMORY_USAGE_GPU_ONLY;
+    allocInfo.requiredFlags           = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    for (MemoryBlock &block : _blocks) {
+        VK_CHECK(vmaAllocateMemory(_allocator, &block.requirements, &allocInfo, &block.allocation, nullptr));
+
+        for (uint32_t index : block.images) {
+            Image &image = _images[index];
+            VK_CHECK(vmaBindImageMemory(_allocator, block.allocation, image.image));
+
+            VkImageViewCreateInfo viewInfo = vkinit::imageview_create_info(image.info.format, image.image, image.info.aspect);
+            VK_CHECK(vkCreateImageView(_device, &viewInfo, nullptr, &image.view));
+        }
+    }
+}
+
+VkDeviceSize RenderGraph::get_aliased_size() const {
+    VkDeviceSize size = 0;
+    for (const MemoryBlock &block : _blocks) {
+        size += block.requirements.size;
+    }
+    return size;
+}
+
+static void buffer_usage_state(BufferUsage usage, bool write, VkPipelineStageFlags2 &stages, VkAccessFlags2 &access) {
+    switch (usage) {
+    case BufferUsage::INDIRECT:
+        stages = VK_PIPELINE_STAGE_2_DRAW_INDIRECT_BIT;
+        access = VK_ACCESS_2_INDIRECT_COMMAND_READ_BIT;
+        break;
+    case BufferUsage::VERTEX:
+        stages = VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT | VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT;
+        access = VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_2_INDEX_READ_BIT;
+        break;
+    case BufferUsage::VERTEX_STORAGE:
+        stages = VK_PIPELINE_STAGE_2_VERTEX_SHADER_BIT;
+        access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT;
+        break;
+    case BufferUsage::STORAGE:
+        stages = VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT;
+        access = VK_ACCESS_2_SHADER_STORAGE_READ_BIT | (write ? VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT : 0);
+        break;
+    case BufferUsage::TRANSFER:
+        // a write can copy from another part of the same buffer
+        stages = VK_PIPELINE_STAGE_2_ALL_TRANSFER_BIT;
+        access = VK_ACCESS_2_TRANSFER_READ_BIT | (write ? VK_ACCESS_2_TRANSFER_WRITE_BIT : 0);
+        break;
+    }
+}
+
+// Reads in the same layout after a read need nothing, and neither does a read from a stage that
+// already waited for the last write. Everything else waits for the last write and the reads since.
+bool RenderGraph::advance(ImageState &state, VkPipelineStageFlags2 stages, VkImageLayout layout, bool write, VkAccessFlags2 access, VkPipelineStageFlags2 &srcStages, VkAccessFlags2 &srcAccess) {
+    bool transition = layout != state.layout;
+    if (!transition && !write && ((stages & ~state.readStages) == 0 || state.writeStages == 0)) {
+        state.readStages |= stages;
+        return false;
+    }
+
+    srcStages = (transition || write) ? state.writeStages | state.readStages : state.writeStages;
+    srcAccess = state.writeAccess;
+
+    if (write || transition) {
+        // a transition writes the image as well, the stages behind it are the ones to wait for next
+        state.writeStages = stages;
+        state.writeAccess = write ? access & (VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_2_SHADER_STORAGE_WRITE_BIT | VK_ACCESS_2_TRANSFER_WRITE_BIT) : 0;
+        state.readStages  = write ? 0 : stages;
+    } else {
+        state.readStages |= stages;
+    }
+    state.layout = layout;
+    return true;
+}
+
+void RenderGraph::add_barrier(bool record, uint32_t image, ImageState &state, VkPipelineStageFlags2 stages, VkAccessFlags2 access, VkImageLayout layout, bool write) {
+    VkImageLayout         oldLayout = state.layout;
+    VkPipelineStageFlags2 srcStages;
+    VkAccessFlags2        srcAccess;
+    if (!advance(state, stages, layout, write, access, srcStages, srcAccess) || !record) {
+        return;
+    }
+
+    VkImageMemoryBarrier2 barrier = {.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+    barrier.srcStageMask          = srcStages;
+    barrier.srcAccessMask         = srcAccess;
+    barrier.dstStageMask          = stages;
+    barrier.dstAccessMask         = access;
+    barrier.oldLayout             = oldLayout;
+    barrier.newLayout             = layout;
+    barrier.subresourceRange      = {_images[image].info.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS};
+    _barriers.push_back(barrier);
+    _barrierImages.push_back(image);
+}
+
+void RenderGraph::add_buffer_barrier(bool record, uint32_t buffer, ImageState &state, VkPipelineStageFlags2 stages, VkAccessFlags2 access, bool write) {
+    VkPipelineStageFlags2 srcStages;
+    VkAccessFlags2        srcAccess;
+    if (!advance(state, stages, VK_IMAGE_LAYOUT_UNDEFINED, write, access, srcStages, srcAccess) || !record) {
+        return;
+    }
+
+    VkBufferMemoryBarrier2 barrier = {.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2};
+    barrier.srcStageMask           = srcStages;
+    barrier.srcAccessMask          = srcAccess;
+    barrier.dstStageMask           = stages;
+    barrier.dstAccessMask          = access;
+    barrier.buffer                 = _buffers[buffer].buffer;
+    barrier.offset                 = 0;
+    barrier.size                   = VK_WHOLE_SIZE;
+    _bufferBarriers.push_back(barrier);
+}
+
+void RenderGraph::plan_barriers(bool record, std::vector<ImageState> &endStates, std::vector<ImageState> &bufferEndStates) {
+    std::vector<ImageState> states(_images.size());
+    for (uint32_t i = 0; i < _images.size(); i++) {
+        const Image &image = _images[i];
+        states[i]          = ImageState{image.initialLayout, image.initialStage, 0, 0};
+    }
+
+    // buffers continue where the previous frame left them
+    std::vector<ImageState> bufferStates(_buffers.size(), ImageState{VK_IMAGE_LAYOUT_UNDEFINED, 0, 0, 0});
+    if (record) {
+        bufferStates = bufferEndStates;
+    }
+
+    // the memory of a transient was last used by the block occupant that ended before it, or by the
+    // last one of the block in the previous frame
+    if (record) {
+        for (uint32_t i = 0; i < _images.size(); i++) {
+            const Image &image = _images[i];
+            if (!image.transient || image.block == NO_GRAPH_IMAGE) {
+                continue;
+            }
+
+            uint32_t previous = NO_GRAPH_IMAGE;
+            uint32_t latest   = i;
+            for (uint32_t other : _blocks[image.block].images) {
+                const Image &otherImage = _images[other];
+                if (otherImage.last < image.first && (previous == NO_GRAPH_IMAGE || otherImage.last > _images[previous].last)) {
+                    previous = other;
+                }
+                if (otherImage.last > _images[latest].last) {
+                    latest = other;
+                }
+            }
+            const ImageState &end = endStates[previous != NO_GRAPH_IMAGE ? previous : latest];
+            states[i]             = ImageState{VK_IMAGE_LAYOUT_UNDEFINED, end.writeStages | end.readStages, end.writeAccess, 0};
+        }
+
+        _barriers.clear();
+        _barrierImages.clear();
+        _bufferBarriers.clear();
+    }
+
+    for (uint32_t passIndex : _order) {
+        Pass &pass = _passes[passIndex];
+
+        pass.firstBarrier = (uint32_t)_barriers.size();
+        for (const Use &use : pass.uses) {
+            VkPipelineStageFlags2 stages;
+            VkAccessFlags2        access;
+            VkImageLayout         layout;
+            usage_state(use.usage, use.write, stages, access, layout);
+
+            add_barrier(record, use.image, states[use.image], stages, access, layout, use.write);
+        }
+        pass.barrierCount = (uint32_t)_barriers.size() - pass.firstBarrier;
+
+        pass.firstBufferBarrier = (uint32_t)_bufferBarriers.size();
+        for (const BufferUse &use : pass.bufferUses) {
+            VkPipelineStageFlags2 stages;
+            VkAccessFlags2        access;
+            buffer_usage_state(use.usage, use.write, stages, access);
+            add_buffer_barrier(record, use.buffer, bufferStates[use.buffer], stages, access, use.write);
+        }
+        pass.bufferBarrierCount = (uint32_t)_bufferBarriers.size() - pass.firstBufferBarrier;
+    }
+
+    // outputs are handed over in their final layout, whatever comes next waits on a semaphore or fence
+    _finalBarrier = (uint32_t)_barriers.size();
+    for (uint32_t i = 0; i < _images.size(); i++) {
+        const Image &image = _images[i];
+        if (image.transient || image.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED || states[i].layout == image.finalLayout) {
+            continue;
+        }
+        if (record) {
+            VkImageMemoryBarrier2 barrier = {.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER_2};
+            barrier.srcStageMask          = states[i].writeStages | states[i].readStages;
+            barrier.srcAccessMask         = states[i].writeAccess;
+            barrier.dstStageMask          = VK_PIPELINE_STAGE_2_NONE;
+            barrier.dstAccessMask         = VK_ACCESS_2_NONE;
+            barrier.oldLayout             = states[i].layout;
+            barrier.newLayout             = image.finalLayout;
+            barrier.subresourceRange      = {image.info.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS};
+            _barriers.push_back(barrier);
+            _barrierImages.push_back(i);
+        }
+    }
+    _finalBarrierCount = (uint32_t)_barriers.size() - _finalBarrier;
+
+    // the fence wait makes them visible, the state stays as it is since the host is done with them
+    // before the next frame is submitted
+    _finalBufferBarrier = (uint32_t)_bufferBarriers.size();
+    for (uint32_t i = 0; i < _buffers.size(); i++) {
+        if (!_buffers[i].hostRead || bufferStates[i].writeStages == 0 || !record) {
+            continue;
+        }
+        VkBufferMemoryBarrier2 barrier = {.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2};
+        barrier.srcStageMask           = bufferStates[i].writeStages;
+        barrier.srcAccessMask          = bufferStates[i].writeAccess;
+        barrier.dstStageMask           = VK_PIPELINE_STAGE_2_HOST_BIT;
+        barrier.dstAccessMask          = VK_ACCESS_2_HOST_READ_BIT;
+        barrier.buffer                 = _buffers[i].buffer;
+        barrier.offset                 = 0;
+        barrier.size                   = VK_WHOLE_SIZE;
+        _bufferBarriers.push_back(barrier);
+    }
+    _finalBufferBarrierCount = (uint32_t)_bufferBarriers.size() - _finalBufferBarrier;
+
+    endStates       = std::move(states);
+    bufferEndStates = std::move(bufferStates);
+}
+
+/*Frame*/
+
+void RenderGraph::set_external(uint32_t image, VkImage vkImage, VkImageView view) {
+    _images[image].image = vkImage;
+    _images[image].view  = view;
+}
+
+void RenderGraph::execute(VkCommandBuffer cmd) {
+    for (uint32_t b = 0; b < _barriers.size(); b++) {
+        _barriers[b].image = _images[_barrierImages[b]].image;
+    }
+
+    VkDependencyInfo dependency = {.sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO};
+    for (uint32_t passIndex : _order) {
+        const Pass &pass = _passes[passIndex];
+        if (pass.barrierCount > 0 || pass.bufferBarrierCount > 0) {
+            dependency.imageMemoryBarrierCount  = pass.barrierCount;
+            dependency.pImageMemoryBarriers     = _barriers.data() + pass.firstBarrier;
+            dependency.bufferMemoryBarrierCount = pass.bufferBarrierCount;
+            dependency.pBufferMemoryBarriers    = _bufferBarriers.data() + pass.firstBufferBarrier;
+            vkCmdPipelineBarrier2(cmd, &dependency);
+        }
+        pass.execute(cmd);
+    }
+
+    if (_finalBarrierCount > 0 || _finalBufferBarrierCount > 0) {
+        dependency.imageMemoryBarrierCount  = _finalBarrierCount;
+        dependency.pImageMemoryBarriers     = _barriers.data() + _finalBarrier;
+        dependency.bufferMemoryBarrierCount = _finalBufferBarrierCount;
+        dependency.pBufferMemoryBarriers    = _bufferBarriers.data() + _finalBufferBarrier;
+        vkCmdPipelineBarrier2(cmd, &dependency);
+    }
+}
@@ -0,0 +1,189 @@
+#pragma once
+
+#include "vk_types.h"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+const uint32_t NO_GRAPH_IMAGE = 0xFFFFFFFF;
+
+// How a pass touches an image. Together with read or write it decides the layout, the stages and
+// the access of the barriers in front of the pass.
+enum class ImageUsage {
+    COLOR_ATTACHMENT,
+    DEPTH_ATTACHMENT, // read only depth test when read
+    SAMPLED,          // fragment shader
+    COMPUTE_SAMPLED,
+    STORAGE, // compute shader, GENERAL layout
+    TRANSFER,
+};
+
+// buffers are always imported and never change layout, only the stages and access matter
+enum class BufferUsage {
+    INDIRECT,       // draw parameters and counts, read only
+    VERTEX,         // vertex and index input, read only
+    VERTEX_STORAGE, // pulled by vertex shaders, read only
+    STORAGE,        // compute shader
+    TRANSFER,
+};
+
+struct TransientImageInfo {
+    VkFormat           format;
+    VkExtent2D         extent;
+    VkImageUsageFlags  usage;
+    VkImageAspectFlags aspect;
+};
+
+// The passes of a frame in submission order together with the images they read and write. compile
+// drops the passes nothing visible depends on, places transient images whose lifetimes don't overlap
+// in the same memory and works out every barrier up front. execute then records one batched sync2
+// barrier per pass that needs any, followed by the pass itself, without allocating. The graph is
+// declared once, only the imported images change from frame to frame.
+class RenderGraph {
+  public:
+    typedef std::function<void(VkCommandBuffer cmd)> ExecuteFn;
+
+    void init(VkDevice device, VmaAllocator allocator);
+    // destroys the transient images and their memory
+    void cleanup();
+
+    /*Declare*/
+
+    // Image owned outside the graph, set_external hands in the VkImage of every frame. It holds
+    // initialLayout when the frame starts and initialStage is what the first barrier waits for, the
+    // stage of the semaphore wait for a swapchain image. Images with a finalLayout are outputs, the
+    // graph leaves them in that layout and keeps the passes that write them.
+    uint32_t import_image(const char *name, VkImageAspectFlags aspect, VkImageLayout initialLayout, VkPipelineStageFlags2 initialStage, VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+    // image that only lives within the frame, created by compile. Its contents are undefined when the
+    // first pass gets it, that pass has to clear or overwrite it.
+    uint32_t create_image(const char *name, const TransientImageInfo &info);
+
+    // buffer owned outside the graph that keeps its contents from frame to frame, the first use of a
+    // frame waits for the last use of the frame before. A buffer the host reads after the frame's
+    // fence is an output, its writes are made visible to the host at the end.
+    uint32_t import_buffer(const char *name, VkBuffer buffer, bool hostRead = false);
+
+    uint32_t add_pass(const char *name, ExecuteFn execute);
+    void     read(uint32_t pass, uint32_t image, ImageUsage usage);
+    // a written attachment may be loaded, so the passes that wrote it before are kept as well
+    void write(uint32_t pass, uint32_t image, ImageUsage usage);
+    void read_buffer(uint32_t pass, uint32_t buffer, BufferUsage usage);
+    void write_buffer(uint32_t pass, uint32_t buffer, BufferUsage usage);
+    // keeps a pass even when nothing it writes is used
+    void set_side_effect(uint32_t pass);
+
+    // call once after declaring everything
+    void compile();
+
+    /*Frame*/
+
+    void set_external(uint32_t image, VkImage vkImage, VkImageView view);
+    void execute(VkCommandBuffer cmd);
+
+    VkImage     get_image(uint32_t image) const { return _images[image].image; }
+    VkImageView get_view(uint32_t image) const { return _images[image].view; }
+    VkBuffer    get_buffer(uint32_t buffer) const { return _buffers[buffer].buffer; }
+
+    uint32_t get_culled_pass_count() const { return (uint32_t)(_passes.size() - _order.size()); }
+    uint32_t get_memory_block_count() const { return (uint32_t)_blocks.size(); }
+    // memory the transient images would take without aliasing, and with it
+    VkDeviceSize get_transient_size() const { return _transientSize; }
+    VkDeviceSize get_aliased_size() const;
+
+  private:
+    struct Image {
+        std::string           name;
+        bool                  transient;
+        TransientImageInfo    info;
+        VkImageLayout         initialLayout;
+        VkPipelineStageFlags2 initialStage;
+        VkImageLayout         finalLayout;
+
+        VkImage     image = VK_NULL_HANDLE;
+        VkImageView view  = VK_NULL_HANDLE;
+
+        // live passes in _order that use it, transients only
+        uint32_t             first = NO_GRAPH_IMAGE;
+        uint32_t             last  = 0;
+        uint32_t             block = NO_GRAPH_IMAGE;
+        VkMemoryRequirements requirements;
+    };
+
+    struct Use {
+        uint32_t   image;
+        ImageUsage usage;
+        bool       write;
+    };
+
+    struct Buffer {
+        std::string name;
+        VkBuffer    buffer;
+        bool        hostRead;
+    };
+
+    struct BufferUse {
+        uint32_t    buffer;
+        BufferUsage usage;
+        bool        write;
+    };
+
+    struct Pass {
+        std::string            name;
+        ExecuteFn              execute;
+        std::vector<Use>       uses;
+        std::vector<BufferUse> bufferUses;
+        bool                   sideEffect = false;
+
+        // ranges of _barriers and _bufferBarriers in front of the pass
+        uint32_t firstBarrier       = 0;
+        uint32_t barrierCount       = 0;
+        uint32_t firstBufferBarrier = 0;
+        uint32_t bufferBarrierCount = 0;
+    };
+
+    // what the previous accesses left behind, the next barrier has to wait for it. Buffers keep the
+    // layout UNDEFINED.
+    struct ImageState {
+        VkImageLayout         layout;
+        VkPipelineStageFlags2 writeStages;
+        VkAccessFlags2        writeAccess;
+        VkPipelineStageFlags2 readStages; // already see the last write
+    };
+
+    // transient images sharing one allocation
+    struct MemoryBlock {
+        VmaAllocation         allocation;
+        VkMemoryRequirements  requirements;
+        std::vector<uint32_t> images;
+    };
+
+    void cull();
+    void place_transients();
+    // walks the live passes, with record the barriers are stored, without it only the end states are
+    void plan_barriers(bool record, std::vector<ImageState> &endStates, std::vector<ImageState> &bufferEndStates);
+    // moves state on to the access, false when it doesn't have to wait for anything
+    bool advance(ImageState &state, VkPipelineStageFlags2 stages, VkImageLayout layout, bool write, VkAccessFlags2 access, VkPipelineStageFlags2 &srcStages, VkAccessFlags2 &srcAccess);
+    void add_barrier(bool record, uint32_t image, ImageState &state, VkPipelineStageFlags2 stages, VkAccessFlags2 access, VkImageLayout layout, bool write);
+    void add_buffer_barrier(bool record, uint32_t buffer, ImageState &state, VkPipelineStageFlags2 stages, VkAccessFlags2 access, bool write);
+
+    VkDevice     _device;
+    VmaAllocator _allocator;
+
+    std::vector<Image>       _images;
+    std::vector<Buffer>      _buffers;
+    std::vector<Pass>        _passes;
+    std::vector<uint32_t>    _order; // live passes in submission order
+    std::vector<MemoryBlock> _blocks;
+    VkDeviceSize             _transientSize = 0;
+
+    // image of every barrier, the handles of imported images are written into them each frame
+    std::vector<uint32_t>               _barrierImages;
+    std::vector<VkImageMemoryBarrier2>  _barriers;
+    std::vector<VkBufferMemoryBarrier2> _bufferBarriers;
+    uint32_t                            _finalBarrier            = 0; // after the last pass, into the final layouts
+    uint32_t                            _finalBarrierCount       = 0;
+    uint32_t                            _finalBufferBarrier      = 0; // after the last pass, to the host
+    uint32_t                            _finalBufferBarrierCount = 0;
+};
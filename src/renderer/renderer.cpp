@@ -1,3 +1,4 @@
+#include "../core/frame_arena.h"
 #include "util/helper.h"
 #include "util/vk_initializers.h"
 #include "vk_engine.h"
@@ -25,13 +26,14 @@ void ResourceManager::create_descriptor_sets(std::string name, std::vector<DescI
 
 void update_descriptor_sets(std::string name, size_t bindingStart, size_t countBindings) {}
 
-void ResourceManager::create_default_pipeline(std::string pipelineName, std::vector<const char *> layoutNames, std::vector<const char *> shaders, TKVertexType vertexType,
-                                              VertexInputDescription vertexInputDesc, std::vector<VkFormat> colorFormats, VkFormat depthFormat) {
+void ResourceManager::create_default_pipeline(const std::string &pipelineName, const std::vector<const char *> &layoutNames, const std::vector<const char *> &shaders, TKVertexType vertexType,
+                                              const VertexInputDescription &vertexInputDesc, const std::vector<VkFormat> &colorFormats, VkFormat depthFormat) {
     PipelineBuilder pipelineBuilder;
 
     TKPipeline tkPipeline;
 
     /*SHADERS PUSH*/
+    pipelineBuilder._shaderStages.reserve(shaders.size());
     for (auto shaderName : shaders) {
         auto shader = this->shaderModules[shaderName];
         pipelineBuilder._shaderStages.push_back(vkinit::pipeline_shader_stage_create_info((VkShaderStageFlagBits)shader.shaderType, shader.shaderModule));
@@ -40,7 +42,8 @@ void ResourceManager::create_default_pipeline(std::string pipelineName, std::vec
     /*Layout PUSH*/
     VkPipelineLayoutCreateInfo triangleLayoutInfo = vkinit::pipeline_layout_create_info();
 
-    std::vector<VkDescriptorSetLayout> layouts;
+    FrameVector<VkDescriptorSetLayout> layouts;
+    layouts.reserve(layoutNames.size());
     for (auto layoutName : layoutNames) {
         auto layout = this->descriptors[layoutName].layout;
         layouts.push_back(layout);
@@ -81,7 +84,7 @@ void ResourceManager::create_default_pipeline(std::string pipelineName, std::vec
 
     // /*Vertex Bindings*/
 
-    auto description = vertexInputDesc;
+    const VertexInputDescription &description = vertexInputDesc;
 
     pipelineBuilder._vertexInputInfo.pVertexAttributeDescriptions = description.attributes.data();
     pipelineBuilder._vertexInputInfo.pVertexBindingDescriptions   = description.bindings.data();
@@ -130,14 +133,16 @@ void ResourceManager::load_shaders() {
             TKShader tkShader;
             tkShader.shaderModule = shader;
 
-            if (filename.find("vert")) {
+            if (filename.find(".comp") != std::string::npos) {
+                tkShader.shaderType = TKShaderStage::COMPUTE;
+            } else if (filename.find(".vert") != std::string::npos) {
                 tkShader.shaderType = TKShaderStage::VERTEX;
-            } else if (filename.find("frag")) {
+            } else if (filename.find(".frag") != std::string::npos) {
                 tkShader.shaderType = TKShaderStage::FRAGMENT;
             } else {
                 std::cout << "Error with extension "
                              "type, must be either "
-                             "vert or frag"
+                             "vert, frag or comp"
                           << std::endl;
                 exit(-1);
             }
@@ -16,6 +16,7 @@ enum class LayoutPhase { PerFrame, PerRenderPass, PerMaterial, PerObject };
 enum class TKShaderStage {
     VERTEX   = VK_SHADER_STAGE_VERTEX_BIT,
     FRAGMENT = VK_SHADER_STAGE_FRAGMENT_BIT,
+    COMPUTE  = VK_SHADER_STAGE_COMPUTE_BIT,
 };
 
 enum class TKBufferBindType {
@@ -70,8 +71,8 @@ class ResourceManager {
 
     void create_descriptor_sets(std::string name, std::vector<DescInfo> descs);
 
-    void create_default_pipeline(std::string pipelineName, std::vector<const char *> layoutNames, std::vector<const char *> shaders, TKVertexType vertexType, VertexInputDescription vertexInputDesc,
-                                 std::vector<VkFormat> colorFormats, VkFormat depthFormat);
+    void create_default_pipeline(const std::string &pipelineName, const std::vector<const char *> &layoutNames, const std::vector<const char *> &shaders, TKVertexType vertexType,
+                                 const VertexInputDescription &vertexInputDesc, const std::vector<VkFormat> &colorFormats, VkFormat depthFormat);
 
   private:
     std::unordered_map<std::string, TKPipeline>   pipelines;
@@ -38,15 +38,6 @@ namespace vkinit {
 
         return imageRegion;
     }
-    void debug_object_set_name(uint64_t objectHandle, VkObjectType type, const char *name, PFN_vkSetDebugUtilsObjectNameEXT setDebugName, VkDevice device) {
-        VkDebugUtilsObjectNameInfoEXT debugNameInfo = {};
-        debugNameInfo.sType                         = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT;
-        debugNameInfo.objectType                    = type;
-        debugNameInfo.objectHandle                  = objectHandle;
-        debugNameInfo.pObjectName                   = name;
-
-        setDebugName(device, &debugNameInfo);
-    };
 } // namespace vkinit
 // define all descriptorlayoutbuilder
 /* void add_binding(uint32_t binding, VkDescriptorType type);
@@ -21,7 +21,6 @@ typedef uint32_t ResourceIndex;
 namespace vkinit {
     VkBufferImageCopy buffer_image_copy_info(VkExtent3D extent);
     VkImageCopy       image_image_copy_info(VkExtent3D extent);
-    void              debug_object_set_name(uint64_t objectHandle, VkObjectType type, const char *name, PFN_vkSetDebugUtilsObjectNameEXT setDebugName, VkDevice device);
 } // namespace vkinit
 
 enum class BufferType {
@@ -0,0 +1,156 @@
+#include "bindless.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+
+uint32_t BindlessDescriptors::SlotArray::allocate() {
+    if (!free.empty()) {
+        uint32_t slot = free.back();
+        free.pop_back();
+        return slot;
+    }
+    if (next == capacity) {
+        printf("bindless: all %u slots are used\n", capacity);
+        abort();
+    }
+    return next++;
+}
+
+void BindlessDescriptors::init(VkDevice device, VkPhysicalDevice physicalDevice) {
+    _device = device;
+
+    VkPhysicalDeviceVulkan12Properties properties12 = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES};
+    VkPhysicalDeviceProperties2        properties   = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2, .pNext = &properties12};
+    vkGetPhysicalDeviceProperties2(physicalDevice, &properties);
+
+    _textures.capacity = std::min({BINDLESS_MAX_TEXTURES, properties12.maxDescriptorSetUpdateAfterBindSampledImages, properties12.maxPerStageDescriptorUpdateAfterBindSampledImages});
+    _samplers.capacity = std::min({BINDLESS_MAX_SAMPLERS, properties12.maxDescriptorSetUpdateAfterBindSamplers, properties12.maxPerStageDescriptorUpdateAfterBindSamplers});
+    _buffers.capacity  = std::min({BINDLESS_MAX_BUFFERS, properties12.maxDescriptorSetUpdateAfterBindStorageBuffers, properties12.maxPerStageDescriptorUpdateAfterBindStorageBuffers});
+
+    VkDescriptorSetLayoutBinding bindings[3] = {
+        {BINDLESS_TEXTURE_BINDING, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, _textures.capacity, VK_SHADER_STAGE_ALL, nullptr},
+        {BINDLESS_SAMPLER_BINDING, VK_DESCRIPTOR_TYPE_SAMPLER, _samplers.capacity, VK_SHADER_STAGE_ALL, nullptr},
+        {BINDLESS_BUFFER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, _buffers.capacity, VK_SHADER_STAGE_ALL, nullptr},
+    };
+
+    // unused slots are never read, and slots not used by the pending frame can be written under it
+    VkDescriptorBindingFlags                    bindingFlag = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+    VkDescriptorBindingFlags                    flags[3]    = {bindingFlag, bindingFlag, bindingFlag};
+    VkDescriptorSetLayoutBindingFlagsCreateInfo flagsInfo   = {.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO};
+    flagsInfo.bindingCount                                  = 3;
+    flagsInfo.pBindingFlags                                 = flags;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+    layoutInfo.pNext                           = &flagsInfo;
+    layoutInfo.flags                           = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutInfo.bindingCount                    = 3;
+    layoutInfo.pBindings                       = bindings;
+    VK_CHECK(vkCreateDescriptorSetLayout(_device, &layoutInfo, nullptr, &_layout));
+
+    VkDescriptorPoolSize poolSizes[3] = {
+        {VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, _textures.capacity},
+        {VK_DESCRIPTOR_TYPE_SAMPLER, _samplers.capacity},
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, _buffers.capacity},
+    };
+
+    VkDescriptorPoolCreateInfo poolInfo = {.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+    poolInfo.flags                      = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    poolInfo.maxSets                    = 1;
+    poolInfo.poolSizeCount              = 3;
+    poolInfo.pPoolSizes                 = poolSizes;
+    VK_CHECK(vkCreateDescriptorPool(_device, &poolInfo, nullptr, &_pool));
+
+    VkDescriptorSetAllocateInfo allocInfo = {.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+    allocInfo.descriptorPool              = _pool;
+    allocInfo.descriptorSetCount          = 1;
+    allocInfo.pSetLayouts                 = &_layout;
+    VK_CHECK(vkAllocateDescriptorSets(_device, &allocInfo, &_set));
+}
+
+void BindlessDescriptors::cleanup() {
+    // the set goes with the pool
+    vkDestroyDescriptorPool(_device, _pool, nullptr);
+    vkDestroyDescriptorSetLayout(_device, _layout, nullptr);
+    _pool   = VK_NULL_HANDLE;
+    _layout = VK_NULL_HANDLE;
+    _set    = VK_NULL_HANDLE;
+}
+
+/*Slots*/
+
+uint32_t BindlessDescriptors::add_texture(VkImageView view, VkImageLayout layout) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    uint32_t                    slot = _textures.allocate();
+
+    VkDescriptorImageInfo imageInfo = {.sampler = VK_NULL_HANDLE, .imageView = view, .imageLayout = layout};
+    VkWriteDescriptorSet  write     = {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    write.dstSet                    = _set;
+    write.dstBinding                = BINDLESS_TEXTURE_BINDING;
+    write.dstArrayElement           = slot;
+    write.descriptorCount           = 1;
+    write.descriptorType            = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+    write.pImageInfo                = &imageInfo;
+    vkUpdateDescriptorSets(_device, 1, &write, 0, nullptr);
+    return slot;
+}
+
+uint32_t BindlessDescriptors::add_sampler(VkSampler sampler) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    uint32_t                    slot = _samplers.allocate();
+
+    VkDescriptorImageInfo imageInfo = {.sampler = sampler};
+    VkWriteDescriptorSet  write     = {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    write.dstSet                    = _set;
+    write.dstBinding                = BINDLESS_SAMPLER_BINDING;
+    write.dstArrayElement           = slot;
+    write.descriptorCount           = 1;
+    write.descriptorType            = VK_DESCRIPTOR_TYPE_SAMPLER;
+    write.pImageInfo                = &imageInfo;
+    vkUpdateDescriptorSets(_device, 1, &write, 0, nullptr);
+    return slot;
+}
+
+uint32_t BindlessDescriptors::add_storage_buffer(VkBuffer buffer, VkDeviceSize size, VkDeviceSize offset) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    uint32_t                    slot = _buffers.allocate();
+
+    VkDescriptorBufferInfo bufferInfo = {.buffer = buffer, .offset = offset, .range = size};
+    VkWriteDescriptorSet   write      = {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    write.dstSet                      = _set;
+    write.dstBinding                  = BINDLESS_BUFFER_BINDING;
+    write.dstArrayElement             = slot;
+    write.descriptorCount             = 1;
+    write.descriptorType              = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    write.pBufferInfo                 = &bufferInfo;
+    vkUpdateDescriptorSets(_device, 1, &write, 0, nullptr);
+    return slot;
+}
+
+/*Release*/
+
+void BindlessDescriptors::set_frame(uint64_t frame) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _frame = frame;
+}
+
+// the descriptor stays written, partially bound only needs the slot to be unused by the shaders
+void BindlessDescriptors::release(SlotArray &array, uint32_t slot) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _released.push_back(Released{_frame, &array, slot});
+}
+
+void BindlessDescriptors::release_texture(uint32_t slot) { release(_textures, slot); }
+void BindlessDescriptors::release_sampler(uint32_t slot) { release(_samplers, slot); }
+void BindlessDescriptors::release_storage_buffer(uint32_t slot) { release(_buffers, slot); }
+
+void BindlessDescriptors::collect(uint64_t completedFrame) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    size_t ready = 0;
+    while (ready < _released.size() && _released[ready].frame <= completedFrame) {
+        _released[ready].array->free.push_back(_released[ready].slot);
+        ready++;
+    }
+    _released.erase(_released.begin(), _released.begin() + ready);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include "../vk_types.h"
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// slot that is never handed out, shaders treat it as "no texture"
+constexpr uint32_t BINDLESS_NONE = 0xFFFFFFFF;
+
+// binding of every array in the bindless set, mirrored in the shaders
+constexpr uint32_t BINDLESS_TEXTURE_BINDING = 0;
+constexpr uint32_t BINDLESS_SAMPLER_BINDING = 1;
+constexpr uint32_t BINDLESS_BUFFER_BINDING  = 2;
+
+// upper bounds, lowered to the update after bind limits of the device in init
+constexpr uint32_t BINDLESS_MAX_TEXTURES = 4096;
+constexpr uint32_t BINDLESS_MAX_SAMPLERS = 64;
+constexpr uint32_t BINDLESS_MAX_BUFFERS  = 1024;
+
+// One descriptor set with large partially bound arrays of sampled images, samplers and storage
+// buffers. Resources are added once and referenced by their slot from object or material data, so
+// every draw shares the same bound set. The set is update after bind, slots can be written while it
+// is bound, but a released slot may still be read by the frame in flight and is only reused after
+// collect has seen that frame complete.
+class BindlessDescriptors {
+  public:
+    void init(VkDevice device, VkPhysicalDevice physicalDevice);
+    void cleanup();
+
+    // image views have to be 2D arrays, that is the only view type the shaders declare
+    uint32_t add_texture(VkImageView view, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+    uint32_t add_sampler(VkSampler sampler);
+    uint32_t add_storage_buffer(VkBuffer buffer, VkDeviceSize size = VK_WHOLE_SIZE, VkDeviceSize offset = 0);
+
+    // frame being recorded, the following releases wait for its fence
+    void set_frame(uint64_t frame);
+
+    void release_texture(uint32_t slot);
+    void release_sampler(uint32_t slot);
+    void release_storage_buffer(uint32_t slot);
+
+    // makes the slots released in frames up to completedFrame available again
+    void collect(uint64_t completedFrame);
+
+    VkDescriptorSetLayout get_layout() const { return _layout; }
+    VkDescriptorSet       get_set() const { return _set; }
+
+  private:
+    // slots of one binding, released ones come back before the array grows
+    struct SlotArray {
+        uint32_t              capacity = 0;
+        uint32_t              next     = 0; // first slot never handed out
+        std::vector<uint32_t> free;
+
+        uint32_t allocate();
+    };
+
+    struct Released {
+        uint64_t   frame;
+        SlotArray *array;
+        uint32_t   slot;
+    };
+
+    void release(SlotArray &array, uint32_t slot);
+
+    VkDevice              _device;
+    VkDescriptorPool      _pool   = VK_NULL_HANDLE;
+    VkDescriptorSetLayout _layout = VK_NULL_HANDLE;
+    VkDescriptorSet       _set    = VK_NULL_HANDLE;
+
+    std::mutex            _mutex;
+    SlotArray             _textures;
+    SlotArray             _samplers;
+    SlotArray             _buffers;
+    uint64_t              _frame = 0;
+    std::vector<Released> _released; // oldest first
+};
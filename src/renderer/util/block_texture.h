@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+// Texture arrays cooked by AtlasGenerator, in the layout they are uploaded in: level after level,
+// every level all layers, every layer its blocks row by row. Levels halve down to 1x1, the ones under
+// a block still take a whole one. Uncompressed textures have blocks of one texel. No vulkan here, the
+// tool includes it too.
+const uint32_t BLOCK_TEXTURE_MAGIC      = 0x58544342; // "BCTX"
+const uint32_t BLOCK_TEXTURE_MAX_LEVELS = 16;
+
+enum class BlockFormat : uint32_t {
+    RGBA8_SRGB = 0, // 4 bytes a texel, for gpus without bc
+    BC1_SRGB   = 1, // 8 bytes a block, opaque or cut out
+    BC7_SRGB   = 7, // 16 bytes a block, mode 6 only
+};
+
+struct BlockTextureHeader {
+    uint32_t magic;
+    uint32_t format; // BlockFormat
+    uint32_t size;   // width and height of level 0
+    uint32_t layers;
+    uint32_t levels;
+};
+
+inline uint32_t block_bytes(BlockFormat format) { return format == BlockFormat::RGBA8_SRGB ? 4 : format == BlockFormat::BC1_SRGB ? 8 : 16; }
+
+// texels per block row and column
+inline uint32_t block_dimension(BlockFormat format) { return format == BlockFormat::RGBA8_SRGB ? 1 : 4; }
+
+inline uint32_t block_level_size(uint32_t size, uint32_t level) { return (size >> level) > 0 ? size >> level : 1; }
+
+// blocks of one layer per row and column
+inline uint32_t block_level_blocks(BlockFormat format, uint32_t size, uint32_t level) { return (block_level_size(size, level) + block_dimension(format) - 1) / block_dimension(format); }
+
+inline uint64_t block_level_bytes(BlockFormat format, uint32_t size, uint32_t level, uint32_t layers) {
+    uint64_t blocks = block_level_blocks(format, size, level);
+    return blocks * blocks * layers * block_bytes(format);
+}
@@ -0,0 +1,154 @@
+#include "deletion_queue.h"
+
+#include <cstdio>
+#include <string>
+#include <unordered_map>
+
+/*Names*/
+
+struct TrackedObject {
+    VkObjectType type;
+    std::string  name;
+};
+
+static std::mutex                                  trackedMutex;
+static std::unordered_map<uint64_t, TrackedObject> trackedObjects;
+
+void track_object_name(uint64_t handle, VkObjectType type, const char *name) {
+    std::lock_guard<std::mutex> lock(trackedMutex);
+    trackedObjects[handle] = TrackedObject{type, name};
+}
+
+void untrack_object(uint64_t handle) {
+    std::lock_guard<std::mutex> lock(trackedMutex);
+    trackedObjects.erase(handle);
+}
+
+static const char *object_type_name(VkObjectType type) {
+    switch (type) {
+    case VK_OBJECT_TYPE_BUFFER:
+        return "buffer";
+    case VK_OBJECT_TYPE_IMAGE:
+        return "image";
+    case VK_OBJECT_TYPE_IMAGE_VIEW:
+        return "image view";
+    case VK_OBJECT_TYPE_SAMPLER:
+        return "sampler";
+    case VK_OBJECT_TYPE_PIPELINE:
+        return "pipeline";
+    case VK_OBJECT_TYPE_PIPELINE_LAYOUT:
+        return "pipeline layout";
+    case VK_OBJECT_TYPE_DESCRIPTOR_POOL:
+        return "descriptor pool";
+    default:
+        return "object";
+    }
+}
+
+uint32_t report_live_objects() {
+    std::lock_guard<std::mutex> lock(trackedMutex);
+    for (const auto &[handle, object] : trackedObjects) {
+        printf("leaked %s \"%s\" (0x%llx)\n", object_type_name(object.type), object.name.c_str(), (unsigned long long)handle);
+    }
+    return (uint32_t)trackedObjects.size();
+}
+
+/*Queue*/
+
+void DeletionQueue::init(VkDevice device, VmaAllocator allocator) {
+    _device    = device;
+    _allocator = allocator;
+}
+
+void DeletionQueue::set_frame(uint64_t frame) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    _frame = frame;
+}
+
+void DeletionQueue::retire(VkObjectType type, uint64_t handle, VmaAllocation allocation) {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_batches.empty() || _batches.back().frame != _frame) {
+        Batch batch;
+        batch.frame = _frame;
+        if (!_spareObjects.empty()) {
+            batch.objects = std::move(_spareObjects.back());
+            _spareObjects.pop_back();
+        }
+        _batches.push_back(std::move(batch));
+    }
+    _batches.back().objects.push_back(Retired{type, handle, allocation});
+}
+
+void DeletionQueue::retire_buffer(AllocatedBuffer buffer) { retire(VK_OBJECT_TYPE_BUFFER, (uint64_t)buffer._buffer, buffer._allocation); }
+void DeletionQueue::retire_image(AllocatedImage image) { retire(VK_OBJECT_TYPE_IMAGE, (uint64_t)image._image, image._allocation); }
+void DeletionQueue::retire_image_view(VkImageView view) { retire(VK_OBJECT_TYPE_IMAGE_VIEW, (uint64_t)view); }
+void DeletionQueue::retire_sampler(VkSampler sampler) { retire(VK_OBJECT_TYPE_SAMPLER, (uint64_t)sampler); }
+void DeletionQueue::retire_pipeline(VkPipeline pipeline) { retire(VK_OBJECT_TYPE_PIPELINE, (uint64_t)pipeline); }
+void DeletionQueue::retire_pipeline_layout(VkPipelineLayout layout) { retire(VK_OBJECT_TYPE_PIPELINE_LAYOUT, (uint64_t)layout); }
+void DeletionQueue::retire_descriptor_pool(VkDescriptorPool pool) { retire(VK_OBJECT_TYPE_DESCRIPTOR_POOL, (uint64_t)pool); }
+
+void DeletionQueue::destroy(const Retired &object) {
+    switch (object.type) {
+    case VK_OBJECT_TYPE_BUFFER:
+        vmaDestroyBuffer(_allocator, (VkBuffer)object.handle, object.allocation);
+        break;
+    case VK_OBJECT_TYPE_IMAGE:
+        vmaDestroyImage(_allocator, (VkImage)object.handle, object.allocation);
+        break;
+    case VK_OBJECT_TYPE_IMAGE_VIEW:
+        vkDestroyImageView(_device, (VkImageView)object.handle, nullptr);
+        break;
+    case VK_OBJECT_TYPE_SAMPLER:
+        vkDestroySampler(_device, (VkSampler)object.handle, nullptr);
+        break;
+    case VK_OBJECT_TYPE_PIPELINE:
+        vkDestroyPipeline(_device, (VkPipeline)object.handle, nullptr);
+        break;
+    case VK_OBJECT_TYPE_PIPELINE_LAYOUT:
+        vkDestroyPipelineLayout(_device, (VkPipelineLayout)object.handle, nullptr);
+        break;
+    case VK_OBJECT_TYPE_DESCRIPTOR_POOL:
+        vkDestroyDescriptorPool(_device, (VkDescriptorPool)object.handle, nullptr);
+        break;
+    default:
+        break;
+    }
+    untrack_object(object.handle);
+}
+
+// the first count batches, called with the lock held
+void DeletionQueue::destroy_batches(size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        for (const Retired &object : _batches[i].objects) {
+            destroy(object);
+        }
+        _batches[i].objects.clear();
+        _spareObjects.push_back(std::move(_batches[i].objects));
+    }
+    _batches.erase(_batches.begin(), _batches.begin() + count);
+}
+
+void DeletionQueue::collect(uint64_t completedFrame) {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    size_t ready = 0;
+    while (ready < _batches.size() && _batches[ready].frame <= completedFrame) {
+        ready++;
+    }
+    destroy_batches(ready);
+}
+
+void DeletionQueue::flush() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    destroy_batches(_batches.size());
+}
+
+uint32_t DeletionQueue::get_pending_count() const {
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    uint32_t count = 0;
+    for (const Batch &batch : _batches) {
+        count += (uint32_t)batch.objects.size();
+    }
+    return count;
+}
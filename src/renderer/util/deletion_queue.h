@@ -0,0 +1,63 @@
+#pragma once
+
+#include "../vk_types.h"
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+// Objects named with vkinit::debug_object_set_name are remembered until the deletion queue destroys
+// them, report_live_objects lists the rest.
+void track_object_name(uint64_t handle, VkObjectType type, const char *name);
+void untrack_object(uint64_t handle);
+// returns how many were still alive
+uint32_t report_live_objects();
+
+// Resources that an in-flight frame may still read. Everything retired while frame N is recorded
+// is destroyed together once the fence of frame N has signaled. retire can be called from any thread.
+class DeletionQueue {
+  public:
+    void init(VkDevice device, VmaAllocator allocator);
+
+    // frame being recorded, the following retires wait for its fence
+    void set_frame(uint64_t frame);
+
+    void retire_buffer(AllocatedBuffer buffer);
+    void retire_image(AllocatedImage image);
+    void retire_image_view(VkImageView view);
+    void retire_sampler(VkSampler sampler);
+    void retire_pipeline(VkPipeline pipeline);
+    void retire_pipeline_layout(VkPipelineLayout layout);
+    void retire_descriptor_pool(VkDescriptorPool pool);
+
+    // destroys everything retired in frames up to completedFrame
+    void collect(uint64_t completedFrame);
+    // destroys everything, the device has to be idle
+    void flush();
+
+    uint32_t get_pending_count() const;
+
+  private:
+    struct Retired {
+        VkObjectType  type;
+        uint64_t      handle;
+        VmaAllocation allocation; // buffers and images
+    };
+
+    struct Batch {
+        uint64_t             frame;
+        std::vector<Retired> objects;
+    };
+
+    void retire(VkObjectType type, uint64_t handle, VmaAllocation allocation = nullptr);
+    void destroy(const Retired &object);
+    void destroy_batches(size_t count);
+
+    VkDevice     _device;
+    VmaAllocator _allocator;
+
+    mutable std::mutex                _mutex;
+    uint64_t                          _frame = 0;
+    std::vector<Batch>                _batches;      // oldest first, only frames that retired something
+    std::vector<std::vector<Retired>> _spareObjects; // lists of destroyed batches, kept for their capacity
+};
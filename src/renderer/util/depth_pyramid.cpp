@@ -0,0 +1,166 @@
+#include "depth_pyramid.h"
+
+#include "vk_initializers.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+const uint32_t PYRAMID_TILE = 64; // depth pixels one workgroup reduces in each direction
+
+static uint32_t next_power_of_two(uint32_t value) {
+    uint32_t power = 1;
+    while (power < value) {
+        power *= 2;
+    }
+    return power;
+}
+
+void DepthPyramid::init(VkDevice device, VmaAllocator allocator, BindlessDescriptors *bindless, VkExtent2D depthExtent, VkShaderModule shader) {
+    _device      = device;
+    _bindless    = bindless;
+    _depthExtent = depthExtent;
+
+    // the rounded up level sizes reach 1x1 at the same level as the power of two ones
+    VkExtent3D extent = {next_power_of_two((depthExtent.width + 1) / 2), next_power_of_two((depthExtent.height + 1) / 2), 1};
+    _levelCount       = 1;
+    while ((extent.width >> _levelCount) > 0 || (extent.height >> _levelCount) > 0) {
+        _levelCount++;
+    }
+    if (_levelCount > DEPTH_PYRAMID_MAX_LEVELS) {
+        printf("depth pyramid: %u levels, at most %u are supported\n", _levelCount, DEPTH_PYRAMID_MAX_LEVELS);
+        abort();
+    }
+
+    VkImageCreateInfo imageInfo = vkinit::image_create_info(VK_FORMAT_R32_SFLOAT, VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, extent);
+    imageInfo.mipLevels         = _levelCount;
+
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage                   = VMA_MEMORY_USAGE_AUTO;
+    VK_CHECK(vmaCreateImage(allocator, &imageInfo, &allocInfo, &_image._image, &_image._allocation, nullptr));
+
+    // the bindless set only declares 2D arrays
+    VkImageViewCreateInfo viewInfo       = vkinit::imageview_create_info(VK_FORMAT_R32_SFLOAT, _image._image, VK_IMAGE_ASPECT_COLOR_BIT);
+    viewInfo.viewType                    = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+    viewInfo.subresourceRange.levelCount = _levelCount;
+    VK_CHECK(vkCreateImageView(_device, &viewInfo, nullptr, &_view));
+    _texture = _bindless->add_texture(_view);
+
+    viewInfo.viewType                    = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.subresourceRange.levelCount = 1;
+    for (uint32_t level = 0; level < _levelCount; level++) {
+        viewInfo.subresourceRange.baseMipLevel = level;
+        VK_CHECK(vkCreateImageView(_device, &viewInfo, nullptr, &_levelViews[level]));
+    }
+
+    // starts at zero, the shader puts it back every build
+    VkBufferCreateInfo bufferInfo = {.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+    bufferInfo.size               = sizeof(uint32_t);
+    bufferInfo.usage              = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+    bufferInfo.sharingMode        = VK_SHARING_MODE_EXCLUSIVE;
+
+    VmaAllocationCreateInfo counterAllocInfo = {};
+    counterAllocInfo.usage                   = VMA_MEMORY_USAGE_AUTO;
+    counterAllocInfo.flags                   = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    VmaAllocationInfo counterAllocation;
+    VK_CHECK(vmaCreateBuffer(allocator, &bufferInfo, &counterAllocInfo, &_counter._buffer, &_counter._allocation, &counterAllocation));
+    memset(counterAllocation.pMappedData, 0, sizeof(uint32_t));
+    VK_CHECK(vmaFlushAllocation(allocator, _counter._allocation, 0, VK_WHOLE_SIZE));
+
+    /*Levels set*/
+
+    VkDescriptorSetLayoutBinding binding = {0, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, DEPTH_PYRAMID_MAX_LEVELS, VK_SHADER_STAGE_COMPUTE_BIT, nullptr};
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO};
+    layoutInfo.bindingCount                    = 1;
+    layoutInfo.pBindings                       = &binding;
+    VK_CHECK(vkCreateDescriptorSetLayout(_device, &layoutInfo, nullptr, &_levelLayout));
+
+    VkDescriptorPoolSize       poolSize = {VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, DEPTH_PYRAMID_MAX_LEVELS};
+    VkDescriptorPoolCreateInfo poolInfo = {.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO};
+    poolInfo.maxSets                    = 1;
+    poolInfo.poolSizeCount              = 1;
+    poolInfo.pPoolSizes                 = &poolSize;
+    VK_CHECK(vkCreateDescriptorPool(_device, &poolInfo, nullptr, &_pool));
+
+    VkDescriptorSetAllocateInfo setInfo = {.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO};
+    setInfo.descriptorPool              = _pool;
+    setInfo.descriptorSetCount          = 1;
+    setInfo.pSetLayouts                 = &_levelLayout;
+    VK_CHECK(vkAllocateDescriptorSets(_device, &setInfo, &_levelSet));
+
+    // the shader never touches the levels past the last one, they repeat it to keep every slot valid
+    VkDescriptorImageInfo levelInfos[DEPTH_PYRAMID_MAX_LEVELS];
+    for (uint32_t level = 0; level < DEPTH_PYRAMID_MAX_LEVELS; level++) {
+        levelInfos[level] = {VK_NULL_HANDLE, _levelViews[std::min(level, _levelCount - 1)], VK_IMAGE_LAYOUT_GENERAL};
+    }
+    VkWriteDescriptorSet write = {.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET};
+    write.dstSet               = _levelSet;
+    write.dstBinding           = 0;
+    write.descriptorCount      = DEPTH_PYRAMID_MAX_LEVELS;
+    write.descriptorType       = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    write.pImageInfo           = levelInfos;
+    vkUpdateDescriptorSets(_device, 1, &write, 0, nullptr);
+
+    /*Pipeline*/
+
+    VkDescriptorSetLayout layouts[]     = {_bindless->get_layout(), _levelLayout};
+    VkPushConstantRange   pushConstants = {VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PyramidConstants)};
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo = vkinit::pipeline_layout_create_info();
+    pipelineLayoutInfo.pSetLayouts                = layouts;
+    pipelineLayoutInfo.setLayoutCount             = 2;
+    pipelineLayoutInfo.pPushConstantRanges        = &pushConstants;
+    pipelineLayoutInfo.pushConstantRangeCount     = 1;
+    VK_CHECK(vkCreatePipelineLayout(_device, &pipelineLayoutInfo, nullptr, &_pipelineLayout));
+
+    VkComputePipelineCreateInfo pipelineInfo = {.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
+    pipelineInfo.stage                       = vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_COMPUTE_BIT, shader);
+    pipelineInfo.layout                      = _pipelineLayout;
+    VK_CHECK(vkCreateComputePipelines(_device, VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &_pipeline));
+
+    uint32_t groupsX         = (depthExtent.width + PYRAMID_TILE - 1) / PYRAMID_TILE;
+    uint32_t groupsY         = (depthExtent.height + PYRAMID_TILE - 1) / PYRAMID_TILE;
+    _constants.depthTexture  = BINDLESS_NONE;
+    _constants.depthSampler  = BINDLESS_NONE;
+    _constants.counterBuffer = _bindless->add_storage_buffer(_counter._buffer);
+    _constants.levelCount    = _levelCount;
+    _constants.depthWidth    = depthExtent.width;
+    _constants.depthHeight   = depthExtent.height;
+    _constants.groupCount    = groupsX * groupsY;
+}
+
+void DepthPyramid::cleanup(DeletionQueue &deletionQueue) {
+    deletionQueue.retire_pipeline(_pipeline);
+    deletionQueue.retire_pipeline_layout(_pipelineLayout);
+    deletionQueue.retire_descriptor_pool(_pool);
+    for (uint32_t level = 0; level < _levelCount; level++) {
+        deletionQueue.retire_image_view(_levelViews[level]);
+    }
+    deletionQueue.retire_image_view(_view);
+    if (_depthView != VK_NULL_HANDLE) {
+        deletionQueue.retire_image_view(_depthView);
+    }
+    deletionQueue.retire_image(_image);
+    deletionQueue.retire_buffer(_counter);
+    vkDestroyDescriptorSetLayout(_device, _levelLayout, nullptr);
+}
+
+void DepthPyramid::set_depth(VkImage depth, VkFormat format, uint32_t sampler) {
+    VkImageViewCreateInfo viewInfo = vkinit::imageview_create_info(format, depth, VK_IMAGE_ASPECT_DEPTH_BIT);
+    viewInfo.viewType              = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+    VK_CHECK(vkCreateImageView(_device, &viewInfo, nullptr, &_depthView));
+
+    _constants.depthTexture = _bindless->add_texture(_depthView);
+    _constants.depthSampler = sampler;
+}
+
+void DepthPyramid::build(VkCommandBuffer cmd) {
+    VkDescriptorSet sets[] = {_bindless->get_set(), _levelSet};
+    vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _pipeline);
+    vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _pipelineLayout, 0, 2, sets, 0, nullptr);
+    vkCmdPushConstants(cmd, _pipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PyramidConstants), &_constants);
+    vkCmdDispatch(cmd, (_depthExtent.width + PYRAMID_TILE - 1) / PYRAMID_TILE, (_depthExtent.height + PYRAMID_TILE - 1) / PYRAMID_TILE, 1);
+}
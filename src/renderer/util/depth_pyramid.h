@@ -0,0 +1,63 @@
+#pragma once
+
+#include "../vk_types.h"
+#include "bindless.h"
+#include "deletion_queue.h"
+
+#include <cstdint>
+
+// size of the level array in depth_pyramid.comp
+constexpr uint32_t DEPTH_PYRAMID_MAX_LEVELS = 16;
+
+// Farthest depth of every 2x2 block of the level below, level 0 halves the depth buffer. Level sizes
+// round up so the edges are covered, the image itself is a power of two and only partially used.
+// One dispatch builds it all: every workgroup reduces a 64x64 tile of depth to the first six levels
+// in shared memory, and the last workgroup to finish does the small levels that are left.
+class DepthPyramid {
+  public:
+    void init(VkDevice device, VmaAllocator allocator, BindlessDescriptors *bindless, VkExtent2D depthExtent, VkShaderModule shader);
+    void cleanup(DeletionQueue &deletionQueue);
+
+    // the depth image the pyramid is built from, it can't change afterwards
+    void set_depth(VkImage depth, VkFormat format, uint32_t sampler);
+
+    // depth has to be readable by the compute shader, the pyramid and the counter writable
+    void build(VkCommandBuffer cmd);
+
+    VkImage     get_image() const { return _image._image; }
+    VkImageView get_view() const { return _view; }
+    VkBuffer    get_counter_buffer() const { return _counter._buffer; }
+    uint32_t    get_texture() const { return _texture; } // bindless slot of all levels
+    uint32_t    get_level_count() const { return _levelCount; }
+
+  private:
+    // mirrored in depth_pyramid.comp
+    struct PyramidConstants {
+        uint32_t depthTexture;
+        uint32_t depthSampler;
+        uint32_t counterBuffer;
+        uint32_t levelCount;
+        uint32_t depthWidth;
+        uint32_t depthHeight;
+        uint32_t groupCount;
+    };
+
+    VkDevice             _device;
+    BindlessDescriptors *_bindless;
+    VkExtent2D           _depthExtent;
+    uint32_t             _levelCount;
+
+    AllocatedImage  _image;
+    VkImageView     _view;                                 // all levels, sampled
+    VkImageView     _levelViews[DEPTH_PYRAMID_MAX_LEVELS]; // one level each, storage
+    VkImageView     _depthView = VK_NULL_HANDLE;           // 2D array view for the bindless set
+    uint32_t        _texture;
+    AllocatedBuffer _counter;                              // workgroups done, the last one sets it back to zero
+
+    VkDescriptorSetLayout _levelLayout;
+    VkDescriptorPool      _pool;
+    VkDescriptorSet       _levelSet;
+    VkPipelineLayout      _pipelineLayout;
+    VkPipeline            _pipeline;
+    PyramidConstants      _constants;
+};
@@ -1,5 +1,7 @@
 
 #include "helper.h"
+#include <algorithm>
+#include <bit>
 #include <bits/utility.h>
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
@@ -7,10 +9,12 @@
 #include <vulkan/vulkan_core.h>
 
 #include <cstdint>
+#include <cstdio>
 #include <cstring>
 #include <vector>
 
 #include "../vk_types.h"
+#include "block_texture.h"
 #include "vk_initializers.h"
 
 VkDevice                   Helper::device;
@@ -54,30 +58,6 @@ AllocatedBuffer Helper::create_buffer(size_t allocSize, VkBufferUsageFlags usage
     return newBuffer;
 }
 
-void Helper::transition_image_layout(VkImageLayout oldLayout, VkImageLayout newLayout, VkImage image, VkCommandBuffer cmd) {
-
-    const VkImageMemoryBarrier image_memory_barrier2{.sType            = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
-                                                     .srcAccessMask    = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
-                                                     .oldLayout        = oldLayout,
-                                                     .newLayout        = newLayout,
-                                                     .image            = image,
-                                                     .subresourceRange = {
-                                                         .aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT,
-                                                         .baseMipLevel   = 0,
-                                                         .levelCount     = 1,
-                                                         .baseArrayLayer = 0,
-                                                         .layerCount     = 1,
-                                                     }};
-
-    vkCmdPipelineBarrier(cmd,
-                         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, // srcStageMask
-                         VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,          // dstStageMask
-                         0, 0, nullptr, 0, nullptr,
-                         1,                     // imageMemoryBarrierCount
-                         &image_memory_barrier2 // pImageMemoryBarriers
-    );
-}
-
 bool Helper::load_shader_module(const char *filePath, VkShaderModule *outShaderModule) {
     std::string full_path = std::string(PROJECT_ROOT_PATH) + "/" + filePath;
 
@@ -142,17 +122,16 @@ std::string Helper::get_filename_from_path(const char *path) {
     return filename;
 }
 
-void Helper::immediate_submit(std::function<void(VkCommandBuffer cmd)> &&function) {
-    vkinit::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-
+VkCommandBuffer Helper::begin_immediate() {
     VkCommandBuffer cmd = Helper::main_cmd;
 
     VkCommandBufferBeginInfo cmdBeginInfo = vkinit::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
 
     VK_CHECK(vkBeginCommandBuffer(cmd, &cmdBeginInfo));
+    return cmd;
+}
 
-    function(cmd);
-
+void Helper::end_immediate(VkCommandBuffer cmd) {
     VK_CHECK(vkEndCommandBuffer(cmd));
 
     VkSubmitInfo submit = vkinit::submit_info(&cmd);
@@ -342,26 +321,14 @@ void Helper::create_cube_map(const char *fileAtlas, uint32_t gridLength, std::ve
 
     uint32_t cubeMapArraySize = cubeMapping.size() / 6;
 
-    VkDeviceSize imageSize = gridLength * gridLength * pixelSize * 6 * cubeMapArraySize;
-
-    uint32_t maxGridX = texWidth / gridLength;
-    uint32_t maxGridY = texHeight / gridLength;
+    VkDeviceSize imageSize = texWidth * texHeight * pixelSize;
 
+    // the atlas goes up as it is, the copy regions pick the faces out of it
     AllocatedBuffer stagingBuffer = Helper::create_buffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
 
-    char *data;
-    vmaMapMemory(Helper::allocator, stagingBuffer._allocation, (void **)&data);
-
-    for (int i = 0; i < cubeMapping.size(); i++) {
-        uint32_t topLeftStart = (cubeMapping[i].first * gridLength * pixelSize) + cubeMapping[i].second * gridLength * texWidth * pixelSize;
-
-        for (int y = 0; y < gridLength; y++) {
-            int rowStart   = topLeftStart + y * texWidth * pixelSize;
-            int dataOffset = (gridLength * gridLength * pixelSize) * i + y * gridLength * pixelSize;
-
-            memcpy(data + dataOffset, &pixels[rowStart], gridLength * pixelSize);
-        }
-    }
+    void *data;
+    vmaMapMemory(Helper::allocator, stagingBuffer._allocation, &data);
+    memcpy(data, pixels, imageSize);
     vmaUnmapMemory(Helper::allocator, stagingBuffer._allocation);
 
     stbi_image_free(pixels);
@@ -409,19 +376,18 @@ void Helper::create_cube_map(const char *fileAtlas, uint32_t gridLength, std::ve
         // barrier the image into the transfer-receive layout
         vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier_toTransfer);
 
-        VkBufferImageCopy copyRegion = {};
-        copyRegion.bufferOffset      = 0;
-        copyRegion.bufferRowLength   = 0;
-        copyRegion.bufferImageHeight = 0;
-
-        copyRegion.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-        copyRegion.imageSubresource.mipLevel       = 0;
-        copyRegion.imageSubresource.baseArrayLayer = 0;
-        copyRegion.imageSubresource.layerCount     = 6 * cubeMapArraySize;
-        copyRegion.imageExtent                     = imageExtent;
+        // one region per face, from its grid cell of the atlas
+        std::vector<VkBufferImageCopy> copyRegions(cubeMapping.size());
+        for (uint32_t i = 0; i < cubeMapping.size(); i++) {
+            VkBufferImageCopy &copyRegion = copyRegions[i];
+            copyRegion.bufferOffset       = ((VkDeviceSize)cubeMapping[i].second * gridLength * texWidth + cubeMapping[i].first * gridLength) * pixelSize;
+            copyRegion.bufferRowLength    = texWidth;
+            copyRegion.bufferImageHeight  = gridLength;
+            copyRegion.imageSubresource   = {VK_IMAGE_ASPECT_COLOR_BIT, 0, i, 1};
+            copyRegion.imageExtent        = imageExtent;
+        }
 
-        // copy the buffer into the image
-        vkCmdCopyBufferToImage(cmd, stagingBuffer._buffer, newImage._image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+        vkCmdCopyBufferToImage(cmd, stagingBuffer._buffer, newImage._image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, (uint32_t)copyRegions.size(), copyRegions.data());
 
         VkImageMemoryBarrier imageBarrier_toReadable = imageBarrier_toTransfer;
 
@@ -440,7 +406,7 @@ void Helper::create_cube_map(const char *fileAtlas, uint32_t gridLength, std::ve
     *cubeMap = newImage;
 }
 
-void Helper::create_texture_array(const char *fileAtlas, uint32_t gridLength, AllocatedImage &imageArray, uint32_t &layers) {
+void Helper::create_texture_array(const char *fileAtlas, uint32_t gridLength, AllocatedImage &imageArray, uint32_t &layers, uint32_t &levels) {
     int texWidth, texHeight, texChannels;
 
     auto fullpath = std::string(PROJECT_ROOT_PATH) + "/" + fileAtlas;
@@ -454,36 +420,17 @@ void Helper::create_texture_array(const char *fileAtlas, uint32_t gridLength, Al
 
     uint32_t pixelSize = STBI_rgb_alpha;
 
-    VkDeviceSize oneImageSize = pixelSize * gridLength * gridLength;
-
     VkDeviceSize imageSize = texWidth * texHeight * pixelSize;
 
     uint32_t maxGridX = texWidth / gridLength;
     uint32_t maxGridY = texHeight / gridLength;
 
+    // the atlas goes up as it is, the copy regions cut it into layers
     AllocatedBuffer stagingBuffer = Helper::create_buffer(imageSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
 
-    char *data;
-    vmaMapMemory(Helper::allocator, stagingBuffer._allocation, (void **)&data);
-    uint32_t bufferOffset = 0;
-
-    for (int y = 0; y < maxGridY; y++) {
-        uint32_t topLeftStart = y * maxGridX * gridLength * gridLength * pixelSize;
-
-        for (int x = 0; x < maxGridX; x++) {
-            uint32_t topLeftStartOffset = x * gridLength * pixelSize + topLeftStart;
-
-            for (int i = 0; i < gridLength; i++) {
-                uint32_t totalOffset = topLeftStartOffset + i * texWidth * pixelSize;
-
-                memcpy(&data[bufferOffset], &pixels[totalOffset], gridLength * pixelSize);
-
-                bufferOffset += gridLength * pixelSize;
-            }
-            int x_x = 5;
-        }
-    }
-
+    void *data;
+    vmaMapMemory(Helper::allocator, stagingBuffer._allocation, &data);
+    memcpy(data, pixels, imageSize);
     vmaUnmapMemory(Helper::allocator, stagingBuffer._allocation);
 
     stbi_image_free(pixels);
@@ -492,11 +439,14 @@ void Helper::create_texture_array(const char *fileAtlas, uint32_t gridLength, Al
     imageExtent.height = static_cast<uint32_t>(gridLength);
     imageExtent.depth  = 1;
 
-    layers = (texWidth / gridLength) * (texHeight / gridLength);
+    layers = maxGridX * maxGridY;
+    levels = std::bit_width(gridLength); // down to 1x1
 
-    VkImageCreateInfo dimg_info = vkinit::image_create_info(VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, imageExtent);
+    // the smaller levels are blitted from level 0, so the image is a transfer source as well
+    VkImageCreateInfo dimg_info = vkinit::image_create_info(VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, imageExtent);
     dimg_info.imageType         = VK_IMAGE_TYPE_2D;
     dimg_info.arrayLayers       = layers;
+    dimg_info.mipLevels         = levels;
     dimg_info.tiling            = VK_IMAGE_TILING_OPTIMAL;
 
     dimg_info.pNext         = nullptr;
@@ -514,7 +464,7 @@ void Helper::create_texture_array(const char *fileAtlas, uint32_t gridLength, Al
         VkImageSubresourceRange range;
         range.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
         range.baseMipLevel   = 0;
-        range.levelCount     = 1;
+        range.levelCount     = levels;
         range.baseArrayLayer = 0;
         range.layerCount     = layers;
 
@@ -532,34 +482,162 @@ void Helper::create_texture_array(const char *fileAtlas, uint32_t gridLength, Al
         // barrier the image into the transfer-receive layout
         vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier_toTransfer);
 
-        VkBufferImageCopy copyRegion = {};
-        copyRegion.bufferOffset      = 0;
-        copyRegion.bufferRowLength   = 0;
-        copyRegion.bufferImageHeight = 0;
+        // one region per cell, its rows a whole atlas row apart
+        std::vector<VkBufferImageCopy> copyRegions(layers);
+        for (uint32_t layer = 0; layer < layers; layer++) {
+            uint32_t cellX = layer % maxGridX;
+            uint32_t cellY = layer / maxGridX;
+
+            VkBufferImageCopy &copyRegion = copyRegions[layer];
+            copyRegion.bufferOffset       = ((VkDeviceSize)cellY * gridLength * texWidth + cellX * gridLength) * pixelSize;
+            copyRegion.bufferRowLength    = texWidth;
+            copyRegion.bufferImageHeight  = gridLength;
+            copyRegion.imageSubresource   = {VK_IMAGE_ASPECT_COLOR_BIT, 0, layer, 1};
+            copyRegion.imageExtent        = imageExtent;
+        }
 
-        copyRegion.imageSubresource.aspectMask     = VK_IMAGE_ASPECT_COLOR_BIT;
-        copyRegion.imageSubresource.mipLevel       = 0;
-        copyRegion.imageSubresource.baseArrayLayer = 0;
-        copyRegion.imageSubresource.layerCount     = layers;
-        copyRegion.imageExtent                     = imageExtent;
+        vkCmdCopyBufferToImage(cmd, stagingBuffer._buffer, newImage._image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, layers, copyRegions.data());
 
-        // copy the buffer into the image
+        // leaves every level shader readable
+        generate_mipmaps(cmd, newImage._image, VkExtent2D{gridLength, gridLength}, levels, layers);
+    });
 
-        vkCmdCopyBufferToImage(cmd, stagingBuffer._buffer, newImage._image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+    vmaDestroyBuffer(Helper::allocator, stagingBuffer._buffer, stagingBuffer._allocation);
 
-        VkImageMemoryBarrier imageBarrier_toReadable = imageBarrier_toTransfer;
+    imageArray = newImage;
+}
 
-        imageBarrier_toReadable.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-        imageBarrier_toReadable.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+bool Helper::create_block_texture_array(const char *file, AllocatedImage &imageArray, VkFormat &format, uint32_t &layers, uint32_t &levels) {
+    auto  fullpath = std::string(PROJECT_ROOT_PATH) + "/" + file;
+    FILE *input    = fopen(fullpath.c_str(), "rb");
+    if (input == nullptr) {
+        return false;
+    }
 
-        imageBarrier_toReadable.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-        imageBarrier_toReadable.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    BlockTextureHeader header;
+    bool               valid = fread(&header, sizeof(header), 1, input) == 1 && header.magic == BLOCK_TEXTURE_MAGIC && header.layers > 0 && header.levels > 0;
+    valid                    = valid && header.levels <= std::min(BLOCK_TEXTURE_MAX_LEVELS, (uint32_t)std::bit_width(header.size));
+    BlockFormat blockFormat  = (BlockFormat)header.format;
+    if (valid && blockFormat == BlockFormat::RGBA8_SRGB) {
+        format = VK_FORMAT_R8G8B8A8_SRGB;
+    } else if (valid && blockFormat == BlockFormat::BC1_SRGB) {
+        format = VK_FORMAT_BC1_RGBA_SRGB_BLOCK;
+    } else if (valid && blockFormat == BlockFormat::BC7_SRGB) {
+        format = VK_FORMAT_BC7_SRGB_BLOCK;
+    } else {
+        printf("Invalid cooked texture %s\n", file);
+        fclose(input);
+        return false;
+    }
 
-        // barrier the image into the shader readable layout
-        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &imageBarrier_toReadable);
+    VkDeviceSize levelOffsets[BLOCK_TEXTURE_MAX_LEVELS];
+    VkDeviceSize size = 0;
+    for (uint32_t level = 0; level < header.levels; level++) {
+        levelOffsets[level] = size;
+        size += block_level_bytes(blockFormat, header.size, level, header.layers);
+    }
+
+    // the file is already in upload order, it is read straight into the staging buffer with no decoding
+    AllocatedBuffer stagingBuffer = Helper::create_buffer(size, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VMA_MEMORY_USAGE_CPU_ONLY);
+    char           *data;
+    vmaMapMemory(Helper::allocator, stagingBuffer._allocation, (void **)&data);
+    valid = fread(data, 1, size, input) == size;
+    vmaUnmapMemory(Helper::allocator, stagingBuffer._allocation);
+    fclose(input);
+    if (!valid) {
+        printf("Truncated cooked texture %s\n", file);
+        vmaDestroyBuffer(Helper::allocator, stagingBuffer._buffer, stagingBuffer._allocation);
+        return false;
+    }
+
+    layers = header.layers;
+    levels = header.levels;
+
+    VkImageCreateInfo imageInfo = vkinit::image_create_info(format, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, VkExtent3D{header.size, header.size, 1});
+    imageInfo.arrayLayers       = layers;
+    imageInfo.mipLevels         = levels;
+
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage                   = VMA_MEMORY_USAGE_GPU_ONLY;
+    VK_CHECK(vmaCreateImage(Helper::allocator, &imageInfo, &allocInfo, &imageArray._image, &imageArray._allocation, nullptr));
+
+    Helper::immediate_submit([&](VkCommandBuffer cmd) {
+        VkImageMemoryBarrier barrier = {.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+        barrier.srcQueueFamilyIndex  = VK_QUEUE_FAMILY_IGNORED;
+        barrier.dstQueueFamilyIndex  = VK_QUEUE_FAMILY_IGNORED;
+        barrier.image                = imageArray._image;
+        barrier.subresourceRange     = {VK_IMAGE_ASPECT_COLOR_BIT, 0, levels, 0, layers};
+        barrier.oldLayout            = VK_IMAGE_LAYOUT_UNDEFINED;
+        barrier.newLayout            = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.srcAccessMask        = 0;
+        barrier.dstAccessMask        = VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        // one region per level, all layers of it. The extent is the real one, compressed blocks are padded
+        VkBufferImageCopy regions[BLOCK_TEXTURE_MAX_LEVELS] = {};
+        for (uint32_t level = 0; level < levels; level++) {
+            uint32_t levelSize              = block_level_size(header.size, level);
+            regions[level].bufferOffset     = levelOffsets[level];
+            regions[level].imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, layers};
+            regions[level].imageExtent      = {levelSize, levelSize, 1};
+        }
+        vkCmdCopyBufferToImage(cmd, stagingBuffer._buffer, imageArray._image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, levels, regions);
+
+        barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
     });
 
     vmaDestroyBuffer(Helper::allocator, stagingBuffer._buffer, stagingBuffer._allocation);
+    return true;
+}
 
-    imageArray = newImage;
-}
\ No newline at end of file
+void Helper::generate_mipmaps(VkCommandBuffer cmd, VkImage image, VkExtent2D extent, uint32_t levels, uint32_t layers) {
+    VkImageMemoryBarrier barrier = {.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER};
+    barrier.srcQueueFamilyIndex  = VK_QUEUE_FAMILY_IGNORED;
+    barrier.dstQueueFamilyIndex  = VK_QUEUE_FAMILY_IGNORED;
+    barrier.image                = image;
+    barrier.subresourceRange     = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, layers};
+
+    // every level is read once, to make the next one, and is done after that
+    int32_t width  = (int32_t)extent.width;
+    int32_t height = (int32_t)extent.height;
+    for (uint32_t level = 1; level < levels; level++) {
+        barrier.subresourceRange.baseMipLevel = level - 1;
+        barrier.oldLayout                     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        barrier.newLayout                     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.srcAccessMask                 = VK_ACCESS_TRANSFER_WRITE_BIT;
+        barrier.dstAccessMask                 = VK_ACCESS_TRANSFER_READ_BIT;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        int32_t nextWidth  = std::max(width / 2, 1);
+        int32_t nextHeight = std::max(height / 2, 1);
+
+        // all layers at once, linear filtering of an srgb format averages the decoded colors
+        VkImageBlit blit    = {};
+        blit.srcSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, layers};
+        blit.srcOffsets[1]  = {width, height, 1};
+        blit.dstSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, level, 0, layers};
+        blit.dstOffsets[1]  = {nextWidth, nextHeight, 1};
+        vkCmdBlitImage(cmd, image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &blit, VK_FILTER_LINEAR);
+
+        barrier.oldLayout     = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        barrier.newLayout     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        barrier.srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+        vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+        width  = nextWidth;
+        height = nextHeight;
+    }
+
+    // the last level was only written
+    barrier.subresourceRange.baseMipLevel = levels - 1;
+    barrier.oldLayout                     = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout                     = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barrier.srcAccessMask                 = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask                 = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(cmd, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
@@ -3,8 +3,6 @@
 #include <cstdint>
 #include <vulkan/vulkan_core.h>
 
-#include <functional>
-
 #include "../vk_types.h"
 
 class Helper {
@@ -15,9 +13,13 @@ class Helper {
 
     static AllocatedBuffer create_buffer(size_t allocSize, VkBufferUsageFlags usage, VmaMemoryUsage memoryUsage);
     static bool load_shader_module(const char *filePath, VkShaderModule *outShaderModule);
-    static void immediate_submit(std::function<void(VkCommandBuffer cmd)> &&function);
-
-    static void transition_image_layout(VkImageLayout oldLayout, VkImageLayout newLayout, VkImage image, VkCommandBuffer cmd = Helper::main_cmd);
+    // records function(cmd) into the main command buffer, submits it and waits. A template so the
+    // lambda is called directly instead of through a heap allocated std::function.
+    template <typename Fn> static void immediate_submit(Fn &&function) {
+        VkCommandBuffer cmd = begin_immediate();
+        function(cmd);
+        end_immediate(cmd);
+    }
 
     void load_image_slices(const char *file, std::vector<AllocatedImage> &outImage, size_t sizeX, size_t sizeY);
 
@@ -35,7 +37,15 @@ class Helper {
     static VkCommandBuffer main_cmd;
     static VkQueue graphicQueue;
     static void create_cube_map(const char *fileAtlas, uint32_t gridLength, std::vector<std::pair<uint32_t, uint32_t>> cubeMapping, AllocatedImage *cubeMap);
-    static void create_texture_array(const char *fileAtlas, uint32_t gridLength, AllocatedImage &imageArray, uint32_t &layers);
+    // one layer per grid cell of the atlas, with a full mip chain
+    static void create_texture_array(const char *fileAtlas, uint32_t gridLength, AllocatedImage &imageArray, uint32_t &layers, uint32_t &levels);
+    // the same from a texture cooked by AtlasGenerator, mips included. False if it is missing or broken
+    static bool create_block_texture_array(const char *file, AllocatedImage &imageArray, VkFormat &format, uint32_t &layers, uint32_t &levels);
+    // Fills levels 1 and up of every layer by blitting each level from the one above it. The image has
+    // to be in TRANSFER_DST_OPTIMAL with level 0 written, and ends up SHADER_READ_ONLY_OPTIMAL.
+    static void generate_mipmaps(VkCommandBuffer cmd, VkImage image, VkExtent2D extent, uint32_t levels, uint32_t layers);
 
   private:
+    static VkCommandBuffer begin_immediate();
+    static void            end_immediate(VkCommandBuffer cmd);
 };
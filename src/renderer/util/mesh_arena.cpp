@@ -0,0 +1,217 @@
+#include "mesh_arena.h"
+
+#include "../../core/frame_arena.h"
+
+#include <algorithm>
+#include <cstring>
+
+void MeshArena::init(VkDevice device, VmaAllocator allocator, DeletionQueue *deletionQueue, uint32_t vertexStride, VkBufferUsageFlags vertexUsage, uint32_t vertexCapacity, uint32_t indexCapacity,
+                     uint32_t maxMeshes) {
+    _device        = device;
+    _allocator     = allocator;
+    _deletionQueue = deletionQueue;
+
+    // moves copy within the buffer, so it is the source as well
+    VkBufferUsageFlags transfer = VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    create_space(_vertices, vertexUsage | transfer, vertexStride, vertexCapacity, maxMeshes);
+    create_space(_indices, VK_BUFFER_USAGE_INDEX_BUFFER_BIT | transfer, sizeof(uint32_t), indexCapacity, maxMeshes);
+    _meshes.reserve(maxMeshes);
+}
+
+void MeshArena::cleanup() {
+    for (const AllocatedBuffer &staging : _staging) {
+        _deletionQueue->retire_buffer(staging);
+    }
+    _staging.clear();
+    _copies.clear();
+    _deletionQueue->retire_buffer(_vertices.buffer);
+    if (_indices.buffer._buffer != VK_NULL_HANDLE) {
+        _deletionQueue->retire_buffer(_indices.buffer);
+    }
+}
+
+MeshRangeHandle MeshArena::add(const void *vertices, uint32_t vertexCount, const uint32_t *indices, uint32_t indexCount) {
+    if (vertexCount == 0) {
+        return MeshRangeHandle{};
+    }
+
+    // nothing has been copied into a range that fails here, so it can go back right away
+    OffsetAllocator::Allocation vertexRange = _vertices.allocator.allocate(vertexCount);
+    if (vertexRange.is_null()) {
+        return MeshRangeHandle{};
+    }
+    OffsetAllocator::Allocation indexRange;
+    if (indexCount > 0) {
+        indexRange = _indices.allocator.allocate(indexCount);
+        if (indexRange.is_null()) {
+            _vertices.allocator.free(vertexRange);
+            return MeshRangeHandle{};
+        }
+    }
+
+    VkDeviceSize vertexBytes = (VkDeviceSize)vertexCount * _vertices.stride;
+    VkDeviceSize indexBytes  = (VkDeviceSize)indexCount * sizeof(uint32_t);
+
+    VkBufferCreateInfo bufferInfo = {.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+    bufferInfo.size               = vertexBytes + indexBytes;
+    bufferInfo.usage              = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode        = VK_SHARING_MODE_EXCLUSIVE;
+
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage                   = VMA_MEMORY_USAGE_AUTO;
+    allocInfo.flags                   = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    AllocatedBuffer   staging;
+    VmaAllocationInfo stagingAllocation;
+    VK_CHECK(vmaCreateBuffer(_allocator, &bufferInfo, &allocInfo, &staging._buffer, &staging._allocation, &stagingAllocation));
+    memcpy(stagingAllocation.pMappedData, vertices, vertexBytes);
+    if (indexCount > 0) {
+        memcpy((uint8_t *)stagingAllocation.pMappedData + vertexBytes, indices, indexBytes);
+    }
+    VK_CHECK(vmaFlushAllocation(_allocator, staging._allocation, 0, VK_WHOLE_SIZE));
+    _staging.push_back(staging);
+
+    _copies.push_back(Copy{staging._buffer, _vertices.buffer._buffer, VkBufferCopy{0, vertexRange.offset * (VkDeviceSize)_vertices.stride, vertexBytes}});
+    if (indexCount > 0) {
+        _copies.push_back(Copy{staging._buffer, _indices.buffer._buffer, VkBufferCopy{vertexBytes, indexRange.offset * (VkDeviceSize)sizeof(uint32_t), indexBytes}});
+    }
+
+    MeshRange range = {vertexRange.offset, vertexCount, indexCount > 0 ? indexRange.offset : 0, indexCount};
+    return _meshes.emplace(Entry{range, vertexRange, indexRange, true});
+}
+
+void MeshArena::remove(MeshRangeHandle mesh) {
+    Entry *entry = _meshes.get(mesh);
+    if (entry == nullptr) {
+        return;
+    }
+    free_later(_vertices, entry->vertices);
+    free_later(_indices, entry->indices);
+    _meshes.erase(mesh);
+}
+
+void MeshArena::set_frame(uint64_t frame) { _frame = frame; }
+
+void MeshArena::collect(uint64_t completedFrame) {
+    size_t count = 0;
+    while (count < _freed.size() && _freed[count].frame <= completedFrame) {
+        _freed[count].space->allocator.free(_freed[count].allocation);
+        count++;
+    }
+    _freed.erase(_freed.begin(), _freed.begin() + count);
+}
+
+void MeshArena::compact() {
+    uint32_t moves = compact_space(_vertices, false, MESH_ARENA_MOVES_PER_FRAME);
+    moves += compact_space(_indices, true, MESH_ARENA_MOVES_PER_FRAME - moves);
+    if (moves > 0) {
+        _version++;
+        _moved += moves;
+    }
+}
+
+void MeshArena::record_uploads(VkCommandBuffer cmd) {
+    // one call per run of copies between the same two buffers
+    FrameVector<VkBufferCopy> regions;
+    for (size_t i = 0; i < _copies.size(); i++) {
+        regions.push_back(_copies[i].region);
+        if (i + 1 == _copies.size() || _copies[i + 1].src != _copies[i].src || _copies[i + 1].dst != _copies[i].dst) {
+            vkCmdCopyBuffer(cmd, _copies[i].src, _copies[i].dst, (uint32_t)regions.size(), regions.data());
+            regions.clear();
+        }
+    }
+    _copies.clear();
+
+    for (const AllocatedBuffer &staging : _staging) {
+        _deletionQueue->retire_buffer(staging);
+    }
+    _staging.clear();
+
+    for (Entry &entry : _meshes) {
+        entry.staged = false;
+    }
+}
+
+MeshArena::Report MeshArena::report() const {
+    Report report;
+    report.vertices = _vertices.allocator.report();
+    report.indices  = _indices.allocator.report();
+    report.meshes   = _meshes.size();
+    report.moved    = _moved;
+    return report;
+}
+
+void MeshArena::create_space(Space &space, VkBufferUsageFlags usage, uint32_t stride, uint32_t capacity, uint32_t maxMeshes) {
+    // an allocator that was never initialized has no room
+    space.buffer = AllocatedBuffer{VK_NULL_HANDLE, nullptr};
+    space.stride = stride;
+    if (capacity == 0) {
+        return;
+    }
+
+    VkBufferCreateInfo bufferInfo = {.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+    bufferInfo.size               = (VkDeviceSize)capacity * stride;
+    bufferInfo.usage              = usage;
+    bufferInfo.sharingMode        = VK_SHARING_MODE_EXCLUSIVE;
+
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage                   = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+    VK_CHECK(vmaCreateBuffer(_allocator, &bufferInfo, &allocInfo, &space.buffer._buffer, &space.buffer._allocation, nullptr));
+
+    space.allocator.init(capacity, maxMeshes);
+}
+
+void MeshArena::free_later(Space &space, OffsetAllocator::Allocation allocation) {
+    if (!allocation.is_null()) {
+        _freed.push_back(Freed{_frame, &space, allocation});
+    }
+}
+
+uint32_t MeshArena::compact_space(Space &space, bool indices, uint32_t maxMoves) {
+    OffsetAllocator::Report report = space.allocator.report();
+    if (maxMoves == 0 || report.freeRanges < 2 || report.fragmentation < MESH_ARENA_COMPACT_FRAGMENTATION) {
+        return 0;
+    }
+
+    // the meshes furthest into the arena, by offset and place in the map
+    FrameVector<std::pair<uint32_t, uint32_t>> candidates;
+    for (uint32_t dense = 0; dense < _meshes.size(); dense++) {
+        const Entry                       &entry = _meshes.begin()[dense];
+        const OffsetAllocator::Allocation &range = indices ? entry.indices : entry.vertices;
+        if (!range.is_null() && !entry.staged) {
+            candidates.push_back({range.offset, dense});
+        }
+    }
+    uint32_t count = std::min(maxMoves, (uint32_t)candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(), [](const auto &a, const auto &b) { return a.first > b.first; });
+
+    // The old range stays allocated until the frames drawing from it are done, so the new one never
+    // overlaps it and a single copy within the buffer moves the mesh. A fit after the old range gains
+    // nothing and goes straight back.
+    uint32_t moves = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        Entry                       &entry = _meshes.begin()[candidates[i].second];
+        OffsetAllocator::Allocation &range = indices ? entry.indices : entry.vertices;
+        uint32_t                     size  = space.allocator.get_allocation_size(range);
+
+        OffsetAllocator::Allocation moved = space.allocator.allocate(size);
+        if (moved.is_null()) {
+            continue;
+        }
+        if (moved.offset > range.offset) {
+            space.allocator.free(moved);
+            continue;
+        }
+
+        _copies.push_back(Copy{space.buffer._buffer, space.buffer._buffer, VkBufferCopy{range.offset * (VkDeviceSize)space.stride, moved.offset * (VkDeviceSize)space.stride, size * (VkDeviceSize)space.stride}});
+        free_later(space, range);
+        range = moved;
+        if (indices) {
+            entry.range.firstIndex = moved.offset;
+        } else {
+            entry.range.firstVertex = moved.offset;
+        }
+        moves++;
+    }
+    return moves;
+}
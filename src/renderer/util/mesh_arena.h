@@ -0,0 +1,109 @@
+#pragma once
+
+#include "../../core/offset_allocator.h"
+#include "../../core/slot_map.h"
+#include "../vk_types.h"
+#include "deletion_queue.h"
+
+#include <cstdint>
+#include <vector>
+
+// compaction starts once this much of the free space is outside the largest free range
+const float    MESH_ARENA_COMPACT_FRAGMENTATION = 0.5f;
+const uint32_t MESH_ARENA_MOVES_PER_FRAME       = 16;
+
+// where a mesh is in the arena, in vertices and indices
+struct MeshRange {
+    uint32_t firstVertex;
+    uint32_t vertexCount;
+    uint32_t firstIndex;
+    uint32_t indexCount;
+};
+
+typedef SlotHandle<MeshRange> MeshRangeHandle;
+
+// One device local vertex buffer and one index buffer for every mesh, the ranges handed out by an
+// offset allocator. Draws bind both once and pick their mesh with firstVertex and firstIndex, the
+// indices are relative to the mesh. Uploads are staged and copied in the frame by record_uploads,
+// removed ranges are given back once the frames that could still draw from them are done.
+// When the free space gets fragmented, compact moves a few meshes per frame from the end of the arena
+// into holes before them, so ranges are looked up every frame instead of kept.
+class MeshArena {
+  public:
+    struct Report {
+        OffsetAllocator::Report vertices;
+        OffsetAllocator::Report indices;
+        uint32_t                meshes;
+        uint32_t                moved; // since init
+    };
+
+    // vertexUsage is how draws read the vertices, without an index capacity there is no index buffer
+    void init(VkDevice device, VmaAllocator allocator, DeletionQueue *deletionQueue, uint32_t vertexStride, VkBufferUsageFlags vertexUsage, uint32_t vertexCapacity, uint32_t indexCapacity, uint32_t maxMeshes);
+    void cleanup();
+
+    // a null handle when the arena is full, indices can be null
+    MeshRangeHandle  add(const void *vertices, uint32_t vertexCount, const uint32_t *indices, uint32_t indexCount);
+    void             remove(MeshRangeHandle mesh);
+    const MeshRange *get(MeshRangeHandle mesh) const { return _meshes.get(mesh) != nullptr ? &_meshes.get(mesh)->range : nullptr; }
+
+    // frame being recorded, ranges freed from now on wait for its fence
+    void set_frame(uint64_t frame);
+    // gives back the ranges freed in frames up to completedFrame
+    void collect(uint64_t completedFrame);
+
+    // plans the moves of this frame when the arena is fragmented, before any range is read for it
+    void compact();
+    // the staged uploads and the moves, has to come before every draw from the arena
+    void record_uploads(VkCommandBuffer cmd);
+
+    VkBuffer get_vertex_buffer() const { return _vertices.buffer._buffer; }
+    VkBuffer get_index_buffer() const { return _indices.buffer._buffer; }
+    uint32_t get_version() const { return _version; } // changes whenever a range moved
+    Report   report() const;
+
+  private:
+    struct Space {
+        AllocatedBuffer buffer;
+        OffsetAllocator allocator;
+        uint32_t        stride;
+    };
+
+    struct Entry {
+        MeshRange                   range;
+        OffsetAllocator::Allocation vertices;
+        OffsetAllocator::Allocation indices;
+        bool                        staged; // its upload isn't recorded yet, so it can't move
+    };
+
+    struct Copy {
+        VkBuffer     src;
+        VkBuffer     dst;
+        VkBufferCopy region;
+    };
+
+    struct Freed {
+        uint64_t                    frame;
+        Space                      *space;
+        OffsetAllocator::Allocation allocation;
+    };
+
+    void create_space(Space &space, VkBufferUsageFlags usage, uint32_t stride, uint32_t capacity, uint32_t maxMeshes);
+    void free_later(Space &space, OffsetAllocator::Allocation allocation);
+    // moves up to maxMoves of the meshes at the end of space into lower free ranges
+    uint32_t compact_space(Space &space, bool indices, uint32_t maxMoves);
+
+    VkDevice       _device;
+    VmaAllocator   _allocator;
+    DeletionQueue *_deletionQueue;
+
+    Space                     _vertices;
+    Space                     _indices;
+    SlotMap<Entry, MeshRange> _meshes;
+
+    uint64_t                     _frame = 0;
+    std::vector<Copy>            _copies;  // of the frame, uploads first
+    std::vector<AllocatedBuffer> _staging; // retired once the copies are recorded
+    std::vector<Freed>           _freed;   // oldest first
+    uint32_t                     _version = 0;
+    uint32_t                     _moved   = 0;
+};
@@ -0,0 +1,49 @@
+#include "secondary_recorder.h"
+
+#include "../../core/job_system.h"
+#include "vk_initializers.h"
+
+void SecondaryRecorder::init(VkDevice device, uint32_t queueFamily, uint32_t threadCount) {
+    _device = device;
+    _pools  = std::vector<ThreadPool>(threadCount);
+
+    // the pools are only ever reset as a whole
+    VkCommandPoolCreateInfo poolInfo = vkinit::command_pool_create_info(queueFamily, VK_COMMAND_POOL_CREATE_TRANSIENT_BIT);
+    for (ThreadPool &pool : _pools) {
+        VK_CHECK(vkCreateCommandPool(_device, &poolInfo, nullptr, &pool.pool));
+    }
+}
+
+void SecondaryRecorder::cleanup() {
+    // the buffers go with their pool
+    for (ThreadPool &pool : _pools) {
+        vkDestroyCommandPool(_device, pool.pool, nullptr);
+    }
+    _pools.clear();
+}
+
+void SecondaryRecorder::reset() {
+    for (ThreadPool &pool : _pools) {
+        VK_CHECK(vkResetCommandPool(_device, pool.pool, 0));
+        pool.used = 0;
+    }
+}
+
+VkCommandBuffer SecondaryRecorder::begin(const VkCommandBufferInheritanceRenderingInfo &rendering) {
+    ThreadPool &pool = _pools[JobSystem::thread_index()];
+    if (pool.used == pool.buffers.size()) {
+        VkCommandBuffer             buffer;
+        VkCommandBufferAllocateInfo allocInfo = vkinit::command_buffer_allocate_info(pool.pool, 1, VK_COMMAND_BUFFER_LEVEL_SECONDARY);
+        VK_CHECK(vkAllocateCommandBuffers(_device, &allocInfo, &buffer));
+        pool.buffers.push_back(buffer);
+    }
+    VkCommandBuffer buffer = pool.buffers[pool.used++];
+
+    VkCommandBufferInheritanceInfo inheritance = {.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO};
+    inheritance.pNext                          = &rendering;
+
+    VkCommandBufferBeginInfo beginInfo = vkinit::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT);
+    beginInfo.pInheritanceInfo         = &inheritance;
+    VK_CHECK(vkBeginCommandBuffer(buffer, &beginInfo));
+    return buffer;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "../vk_types.h"
+
+#include <cstdint>
+#include <vector>
+
+// Secondary command buffers for recording from several threads. Every thread has its own command
+// pool, indexed by JobSystem::thread_index, so begin takes no lock. The buffers of a frame stay
+// valid until reset, which has to wait until the frame's fence has signaled.
+class SecondaryRecorder {
+  public:
+    // threadCount is the number of JobSystem thread indices, workers plus the calling thread
+    void init(VkDevice device, uint32_t queueFamily, uint32_t threadCount);
+    void cleanup();
+
+    // gives every buffer back to its pool
+    void reset();
+
+    // a begun buffer from the pool of the calling thread that continues the dynamic rendering
+    // described by rendering, end it with vkEndCommandBuffer
+    VkCommandBuffer begin(const VkCommandBufferInheritanceRenderingInfo &rendering);
+
+  private:
+    // one cache line each, the threads only touch their own
+    struct alignas(64) ThreadPool {
+        VkCommandPool                pool;
+        std::vector<VkCommandBuffer> buffers; // allocated so far, reused every frame
+        uint32_t                     used = 0;
+    };
+
+    VkDevice                _device;
+    std::vector<ThreadPool> _pools;
+};
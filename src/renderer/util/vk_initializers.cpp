@@ -1,4 +1,5 @@
 ﻿#include "vk_initializers.h"
+#include "deletion_queue.h"
 #include <vulkan/vulkan_core.h>
 
 VkCommandPoolCreateInfo
@@ -336,3 +337,21 @@ VkSamplerCreateInfo vkinit::sampler_create_info(
 
   return info;
 }
+
+void vkinit::debug_object_set_name(uint64_t objectHandle, VkObjectType type,
+                                   const char *name,
+                                   PFN_vkSetDebugUtilsObjectNameEXT setDebugName,
+                                   VkDevice device) {
+  track_object_name(objectHandle, type, name);
+  if (setDebugName == nullptr) {
+    return;
+  }
+
+  VkDebugUtilsObjectNameInfoEXT debugNameInfo = {};
+  debugNameInfo.sType = VK_STRUCTURE_TYPE_DEBUG_UTILS_OBJECT_NAME_INFO_EXT;
+  debugNameInfo.objectType = type;
+  debugNameInfo.objectHandle = objectHandle;
+  debugNameInfo.pObjectName = name;
+
+  setDebugName(device, &debugNameInfo);
+}
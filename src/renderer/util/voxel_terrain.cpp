@@ -0,0 +1,128 @@
+#include "voxel_terrain.h"
+
+#include "helper.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+const uint32_t VOXEL_INDEX_COUNT = VOXEL_SECTION_MAX_FACES * 6;
+static_assert(VOXEL_SECTION_MAX_FACES * 4 <= 0x10000, "the corners of a section have to fit 16 bit indices");
+
+static uint64_t section_key(glm::ivec3 sectionCoord) {
+    const uint64_t mask = 0x1FFFFF; // 21 bits per axis
+    return ((uint64_t)(sectionCoord.x & mask) << 42) | ((uint64_t)(sectionCoord.y & mask) << 21) | (uint64_t)(sectionCoord.z & mask);
+}
+
+void VoxelTerrain::init(VkDevice device, VmaAllocator allocator, DeletionQueue *deletionQueue, BindlessDescriptors *bindless) {
+    _allocator     = allocator;
+    _deletionQueue = deletionQueue;
+    _bindless      = bindless;
+
+    _faces.init(device, allocator, deletionQueue, sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT, VOXEL_MAX_FACES, 0, VOXEL_MAX_SECTIONS);
+    _faceBuffer = _bindless->add_storage_buffer(_faces.get_vertex_buffer());
+
+    /*Indices*/
+
+    // the same for every section, relative to the first face of the draw
+    VkDeviceSize indexBytes = VOXEL_INDEX_COUNT * sizeof(uint16_t);
+
+    VkBufferCreateInfo bufferInfo = {.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO};
+    bufferInfo.size               = indexBytes;
+    bufferInfo.usage              = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
+    bufferInfo.sharingMode        = VK_SHARING_MODE_EXCLUSIVE;
+
+    VmaAllocationCreateInfo stagingAllocInfo = {};
+    stagingAllocInfo.usage                   = VMA_MEMORY_USAGE_AUTO;
+    stagingAllocInfo.flags                   = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    AllocatedBuffer   staging;
+    VmaAllocationInfo stagingAllocation;
+    VK_CHECK(vmaCreateBuffer(allocator, &bufferInfo, &stagingAllocInfo, &staging._buffer, &staging._allocation, &stagingAllocation));
+
+    const uint16_t corners[6] = {0, 1, 2, 2, 1, 3};
+    uint16_t      *indices    = (uint16_t *)stagingAllocation.pMappedData;
+    for (uint32_t i = 0; i < VOXEL_INDEX_COUNT; i++) {
+        indices[i] = (uint16_t)((i / 6) * 4 + corners[i % 6]);
+    }
+    VK_CHECK(vmaFlushAllocation(allocator, staging._allocation, 0, VK_WHOLE_SIZE));
+
+    bufferInfo.usage = VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+    VmaAllocationCreateInfo allocInfo = {};
+    allocInfo.usage                   = VMA_MEMORY_USAGE_AUTO_PREFER_DEVICE;
+    VK_CHECK(vmaCreateBuffer(allocator, &bufferInfo, &allocInfo, &_indices._buffer, &_indices._allocation, nullptr));
+
+    Helper::immediate_submit([&](VkCommandBuffer cmd) {
+        VkBufferCopy region = {0, 0, indexBytes};
+        vkCmdCopyBuffer(cmd, staging._buffer, _indices._buffer, 1, &region);
+    });
+    vmaDestroyBuffer(allocator, staging._buffer, staging._allocation);
+
+    /*Sections*/
+
+    // a new section writes its own slot, which no frame in flight draws yet
+    bufferInfo.size  = VOXEL_MAX_SECTIONS * sizeof(glm::ivec4);
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+
+    VmaAllocationInfo originAllocation;
+    VK_CHECK(vmaCreateBuffer(allocator, &bufferInfo, &stagingAllocInfo, &_origins._buffer, &_origins._allocation, &originAllocation));
+    _originData    = (glm::ivec4 *)originAllocation.pMappedData;
+    _sectionBuffer = _bindless->add_storage_buffer(_origins._buffer);
+
+    _sections.reserve(VOXEL_MAX_SECTIONS);
+}
+
+void VoxelTerrain::cleanup() {
+    _bindless->release_storage_buffer(_faceBuffer);
+    _bindless->release_storage_buffer(_sectionBuffer);
+    _faces.cleanup();
+    _deletionQueue->retire_buffer(_indices);
+    _deletionQueue->retire_buffer(_origins);
+}
+
+void VoxelTerrain::set_section(glm::ivec3 sectionCoord, const uint32_t *faces, uint32_t faceCount) {
+    auto     found = _slots.find(section_key(sectionCoord));
+    uint32_t slot;
+    if (found != _slots.end()) {
+        slot = found->second;
+    } else {
+        if (faceCount == 0) {
+            return;
+        }
+        if (_sections.size() == VOXEL_MAX_SECTIONS) {
+            printf("voxel terrain: more than %u sections\n", VOXEL_MAX_SECTIONS);
+            abort();
+        }
+        slot = (uint32_t)_sections.size();
+        _slots.emplace(section_key(sectionCoord), slot);
+        _sections.push_back(Section{sectionCoord, MeshRangeHandle{}, 0});
+
+        _originData[slot] = glm::ivec4(sectionCoord * SECTION_SIZE, 0);
+        VK_CHECK(vmaFlushAllocation(_allocator, _origins._allocation, slot * sizeof(glm::ivec4), sizeof(glm::ivec4)));
+    }
+
+    Section &section = _sections[slot];
+    _faces.remove(section.faces);
+    _faceCount -= section.faceCount;
+
+    section.faces     = _faces.add(faces, faceCount, nullptr, 0);
+    section.faceCount = faceCount;
+    if (faceCount > 0 && section.faces.is_null()) {
+        printf("voxel terrain: no room for the %u faces of section %d %d %d\n", faceCount, sectionCoord.x, sectionCoord.y, sectionCoord.z);
+        abort();
+    }
+    _faceCount += faceCount;
+}
+
+void VoxelTerrain::draw(VkCommandBuffer cmd) const {
+    vkCmdBindIndexBuffer(cmd, _indices._buffer, 0, VK_INDEX_TYPE_UINT16);
+
+    // ranges are looked up every frame, compaction may have moved them
+    for (uint32_t slot = 0; slot < _sections.size(); slot++) {
+        const MeshRange *range = _faces.get(_sections[slot].faces);
+        if (range != nullptr) {
+            vkCmdDrawIndexed(cmd, range->vertexCount * 6, 1, 0, (int32_t)(range->firstVertex * 4), slot);
+        }
+    }
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include "../../collision/voxel_world.h"
+#include "../../core/frame_arena.h"
+#include "../vk_types.h"
+#include "bindless.h"
+#include "deletion_queue.h"
+#include "mesh_arena.h"
+
+#include <bit>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+// a section of alternating solid blocks has the most faces, half of its blocks with all six
+const uint32_t VOXEL_SECTION_MAX_FACES = SECTION_SIZE * SECTION_SIZE * SECTION_SIZE * 3;
+const uint32_t VOXEL_MAX_FACES         = 1 << 20;
+const uint32_t VOXEL_MAX_SECTIONS      = 4096;
+
+// directions in the face order of the cube mesh, which Material::faceIndices uses too
+enum VoxelFace : uint32_t {
+    VOXEL_FACE_POS_X = 0,
+    VOXEL_FACE_NEG_X,
+    VOXEL_FACE_POS_Y,
+    VOXEL_FACE_NEG_Y,
+    VOXEL_FACE_NEG_Z,
+    VOXEL_FACE_POS_Z,
+};
+
+// a face in 32 bits, unpacked by voxel.vert: the block in the section (4 bits per axis), the direction
+// (3 bits) and the material (8 bits)
+inline uint32_t pack_voxel_face(uint32_t x, uint32_t y, uint32_t z, uint32_t direction, uint32_t material) { return x | y << 4 | z << 8 | direction << 12 | material << 15; }
+
+// Writes the faces of the solid blocks of a section that no solid block covers, looking into the
+// neighbouring sections at the edges. Every column is compared with the ones around it as bitmasks.
+// material(glm::ivec3 block) gives the material of a solid block, the store only knows solidity.
+template <typename MaterialFn> uint32_t mesh_voxel_section(const ChunkStore &world, glm::ivec3 sectionCoord, MaterialFn &&material, uint32_t *faces) {
+    glm::ivec3 origin = sectionCoord * SECTION_SIZE;
+    uint32_t   count  = 0;
+    for (int32_t z = 0; z < SECTION_SIZE; z++) {
+        for (int32_t x = 0; x < SECTION_SIZE; x++) {
+            // bit 0 is the block below the section and bit 17 the one above, bit y + 1 is block y
+            auto column = [&](int32_t dx, int32_t dz) { return world.column_mask(origin.x + x + dx, origin.z + z + dz, origin.y - 1, origin.y + SECTION_SIZE); };
+
+            uint64_t solid  = column(0, 0);
+            uint64_t inside = (solid >> 1) & 0xFFFF;
+            if (inside == 0) {
+                continue;
+            }
+
+            uint64_t open[6];
+            open[VOXEL_FACE_POS_X] = inside & ~(column(1, 0) >> 1);
+            open[VOXEL_FACE_NEG_X] = inside & ~(column(-1, 0) >> 1);
+            open[VOXEL_FACE_POS_Y] = inside & ~(solid >> 2);
+            open[VOXEL_FACE_NEG_Y] = inside & ~solid;
+            open[VOXEL_FACE_NEG_Z] = inside & ~(column(0, -1) >> 1);
+            open[VOXEL_FACE_POS_Z] = inside & ~(column(0, 1) >> 1);
+
+            for (uint32_t direction = 0; direction < 6; direction++) {
+                uint64_t mask = open[direction];
+                while (mask) {
+                    uint32_t y     = std::countr_zero(mask);
+                    faces[count++] = pack_voxel_face(x, y, z, direction, material(origin + glm::ivec3(x, y, z)));
+                    mask &= mask - 1;
+                }
+            }
+        }
+    }
+    return count;
+}
+
+// Sections of the world drawn without vertex attributes. voxel.vert pulls the packed faces out of a
+// storage buffer: vertices 4f to 4f + 3 are the corners of face f, and one static index buffer makes
+// two triangles out of every four. The faces of a section are a range of a mesh arena, its draw starts
+// there with vertexOffset and finds the origin of the section through the first instance.
+class VoxelTerrain {
+  public:
+    void init(VkDevice device, VmaAllocator allocator, DeletionQueue *deletionQueue, BindlessDescriptors *bindless);
+    void cleanup();
+
+    // meshes the section again from the world, a section without faces isn't drawn
+    template <typename MaterialFn> void update_section(const ChunkStore &world, glm::ivec3 sectionCoord, MaterialFn &&material) {
+        FrameArena        &arena  = frame_arena();
+        FrameArena::Marker marker = arena.mark();
+        uint32_t          *faces  = arena.allocate_array<uint32_t>(VOXEL_SECTION_MAX_FACES);
+        set_section(sectionCoord, faces, mesh_voxel_section(world, sectionCoord, material, faces));
+        arena.rewind(marker);
+    }
+    // the previous faces of the section stay in the arena until the frames drawing them are done
+    void set_section(glm::ivec3 sectionCoord, const uint32_t *faces, uint32_t faceCount);
+
+    // one indexed draw per section, with the voxel pipeline bound
+    void draw(VkCommandBuffer cmd) const;
+
+    MeshArena &get_arena() { return _faces; }
+    uint32_t   get_face_buffer() const { return _faceBuffer; } // bindless slots
+    uint32_t   get_section_buffer() const { return _sectionBuffer; }
+    uint32_t   get_face_count() const { return _faceCount; }
+    uint32_t   get_section_count() const { return (uint32_t)_sections.size(); }
+
+  private:
+    struct Section {
+        glm::ivec3      coord;
+        MeshRangeHandle faces;
+        uint32_t        faceCount;
+    };
+
+    VmaAllocator         _allocator;
+    DeletionQueue       *_deletionQueue;
+    BindlessDescriptors *_bindless;
+
+    MeshArena       _faces;   // a face per vertex, no indices
+    AllocatedBuffer _indices; // 0, 1, 2, 2, 1, 3 + 4 * face, for the most faces a section can have
+    AllocatedBuffer _origins; // glm::ivec4 per section, host mapped
+    glm::ivec4     *_originData;
+    uint32_t        _faceBuffer;
+    uint32_t        _sectionBuffer;
+
+    std::vector<Section>                   _sections; // by slot, which is the first instance of its draw
+    std::unordered_map<uint64_t, uint32_t> _slots;    // section key -> slot
+    uint32_t                               _faceCount = 0;
+};
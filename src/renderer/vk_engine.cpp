@@ -30,6 +30,8 @@
 #include "renderer.h"
 
 constexpr bool bUseValidationLayers = true;
+constexpr bool bThreadedSimulation  = false;
+constexpr bool bGpuDrivenDraws      = true; // frustum and occlusion culled on the gpu, drawn with indirect count draws
 
 // we want to immediately abort when there is an error. In normal engines this
 // would give an error message to the user, or perform a dump of state.
@@ -37,7 +39,38 @@ using namespace std;
 
 std::vector<const char *> device_extensions = {"VK_KHR_dynamic_rendering"};
 
-const uint32_t MAX_OBJECTS = 20;
+const uint32_t MAX_OBJECTS      = 20;
+const uint32_t PHYSICS_BOXES    = 4;
+const uint32_t MAX_DRAW_OBJECTS = MAX_OBJECTS + PHYSICS_BOXES;
+
+const float    FIXED_TIMESTEP     = 1.0f / 60.0f;
+const uint32_t MAX_CATCH_UP_STEPS = 5; // after a stall the rest of the time is dropped
+
+const glm::vec3 EYE_OFFSET = glm::vec3(0.0f, 0.7f, 0.0f);
+
+#ifdef ENGINE_RENDER_STATS
+const bool RENDER_STATS = true;
+#else
+const bool RENDER_STATS = false;
+#endif
+
+const int ALLOCATION_REPORT_FRAMES = 300; // with ENGINE_TRACK_ALLOCATIONS
+const int CULL_REPORT_FRAMES       = 300; // with ENGINE_RENDER_STATS
+const int MESH_REPORT_FRAMES       = 300; // with ENGINE_RENDER_STATS
+
+const uint32_t DRAWS_PER_SECONDARY = 256; // draws recorded by one job into one secondary command buffer
+const uint32_t CULL_GROUP_SIZE     = 64;  // local_size_x of cull.comp
+
+// shared by every mesh, in vertices and indices
+const uint32_t MESH_ARENA_VERTICES = 1 << 20;
+const uint32_t MESH_ARENA_INDICES  = 1 << 22;
+const uint32_t MESH_ARENA_MESHES   = 16384;
+
+const float BLOCK_MAX_ANISOTROPY = 16.0f; // of the block texture sampler, lowered to the device limit
+
+// voxel ground in [-GROUND_RADIUS, GROUND_RADIUS) around the origin, below the spawn
+const int32_t GROUND_RADIUS = 24;
+const int32_t GROUND_HEIGHT = -4;
 
 void VulkanEngine::init() {
     // We initialize SDL and create a window with it.
@@ -58,13 +91,24 @@ void VulkanEngine::init() {
 
     Helper::init(this->_device, this->_gpuProperties, this->_allocator, this->cmd, this->_graphicsQueue);
 
-    init_mesh();
+    _meshArena.init(_device, _allocator, &_deletionQueue, sizeof(VertexTemp), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, MESH_ARENA_VERTICES, MESH_ARENA_INDICES, MESH_ARENA_MESHES);
+    init_mesh(_meshArena);
     Block::init_texture();
 
     init_descriptors();
 
+    _voxelTerrain.init(_device, _allocator, &_deletionQueue, &_bindless);
+    _voxelConstants = GPUVoxelConstants{_voxelTerrain.get_section_buffer(), _drawConstants.materialBuffer, _voxelTerrain.get_face_buffer()};
+
     init_pipelines(shaderModules);
 
+    init_render_graph();
+
+    _jobs.init();
+    _secondaryRecorder.init(_device, _graphicsQueueFamily, _jobs.worker_count() + 1);
+    _physics.init(&_jobs, &_world);
+    init_scene();
+
     // TODO, a check if more then 1 display
     SDL_Rect rect;
     SDL_GetWindowSize(_window, &rect.w, &rect.h);
@@ -75,9 +119,158 @@ void VulkanEngine::init() {
     _isInitialized = true;
 }
 
-void VulkanEngine::cleanup() {}
+void VulkanEngine::cleanup() {
+    _simThread.stop();
+    _jobs.shutdown();
+
+    if (_isInitialized) {
+        vkDeviceWaitIdle(_device);
+
+        _deletionQueue.retire_buffer(c_buffer);
+        _deletionQueue.retire_buffer(_materialBuffer);
+        _deletionQueue.retire_buffer(_drawCommandBuffer);
+        _deletionQueue.retire_buffer(_drawCountBuffer);
+        _deletionQueue.retire_buffer(_visibilityBuffer);
+        _deletionQueue.retire_buffer(_cullDataBuffer);
+        _deletionQueue.retire_buffer(_cullStatsBuffer);
+        _depthPyramid.cleanup(_deletionQueue);
+        _meshArena.cleanup();
+        _voxelTerrain.cleanup();
+        _deletionQueue.flush();
+        _bindless.cleanup();
+        _renderGraph.cleanup();
+        _secondaryRecorder.cleanup();
+
+        // named objects nobody retired
+        uint32_t leaks = report_live_objects();
+        if (leaks > 0) {
+            printf("%u vulkan objects were not destroyed\n", leaks);
+        }
+    }
+}
+
+static glm::mat4 local_matrix(const Transform &transform) {
+    return glm::translate(glm::mat4(1.0f), transform.position) * glm::mat4_cast(transform.orientation) * glm::scale(glm::mat4(1.0f), transform.scale);
+}
+
+void VulkanEngine::init_scene() {
+    // a row of blocks, solid for the collision and drawn with the cube mesh. The row is a group node
+    // so it can be moved as a whole.
+    uint32_t row = _transforms.create();
+    for (int i = 0; i < MAX_OBJECTS; i++) {
+        glm::ivec3 block(i + 1, 0, 0);
+        _world.set_solid(block, true);
+
+        // the cube mesh is centered, a block fills [block, block + 1]
+        Transform transform = Transform{glm::vec3(block) + glm::vec3(0.5f), glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(1.0f)};
+        uint32_t  material  = i % Block::TYPE_COUNT;
+        uint32_t  node      = _transforms.create(row, local_matrix(transform), _objectCount);
+        _scene.create(transform, Renderable{material}, SceneNode{node});
+        init_object(_objectCount++, material);
+    }
+
+    // a small stack to knock over
+    for (uint32_t i = 0; i < PHYSICS_BOXES; i++) {
+        glm::vec3 position    = glm::vec3(5.5f, 1.5f + i * 1.05f, 0.5f);
+        glm::vec3 halfExtents = glm::vec3(0.4f);
+        uint32_t  body        = _physics.add_box(position, halfExtents, 1.0f);
+        Transform transform   = Transform{position, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), halfExtents * 2.0f};
+        uint32_t  node        = _transforms.create(NULL_NODE, local_matrix(transform), _objectCount);
+        _scene.create(transform, Renderable{Block::WOOD_BARREL}, PhysicsBody{body}, SceneNode{node});
+        init_object(_objectCount++, Block::WOOD_BARREL);
+    }
+    for (const RigidBody &body : _physics.get_bodies()) {
+        _previousBodies.push_back(BodyPose{body.position, body.orientation, body.halfExtents});
+    }
+
+    // ground to land on, solid for the collision and meshed into voxel faces a section at a time
+    for (int32_t z = -GROUND_RADIUS; z < GROUND_RADIUS; z++) {
+        for (int32_t x = -GROUND_RADIUS; x < GROUND_RADIUS; x++) {
+            _world.set_solid(glm::ivec3(x, GROUND_HEIGHT, z), true);
+        }
+    }
+    auto       ground     = [](glm::ivec3 block) { return (uint32_t)(((block.x + block.z) & 1) ? Block::ANDESITE : Block::BIRCH_PLANKS); };
+    glm::ivec3 minSection = ChunkStore::section_coord(glm::ivec3(-GROUND_RADIUS, GROUND_HEIGHT, -GROUND_RADIUS));
+    glm::ivec3 maxSection = ChunkStore::section_coord(glm::ivec3(GROUND_RADIUS - 1, GROUND_HEIGHT, GROUND_RADIUS - 1));
+    for (int32_t z = minSection.z; z <= maxSection.z; z++) {
+        for (int32_t x = minSection.x; x <= maxSection.x; x++) {
+            _voxelTerrain.update_section(_world, glm::ivec3(x, minSection.y, z), ground);
+        }
+    }
+
+    _player.teleport(_cam.get_camera_position() - EYE_OFFSET);
+    publish_snapshot(seconds_now());
+}
+
+// the new nodes are dirty, so the first update_objects flushes these with the transform
+void VulkanEngine::init_object(uint32_t object, uint32_t material) {
+    if (object < MAX_DRAW_OBJECTS) {
+        // the cube spans [-0.5, 0.5]
+        _objectData[object].boundingSphere = glm::vec4(0.0f, 0.0f, 0.0f, glm::sqrt(0.75f));
+        _objectData[object].material       = material;
+        set_object_mesh(object, Cube::get_mesh());
+    }
+}
+
+void VulkanEngine::set_object_mesh(uint32_t object, MeshRangeHandle mesh) {
+    if (object >= _objectMeshes.size()) {
+        _objectMeshes.resize(object + 1);
+    }
+    _objectMeshes[object] = mesh;
 
-void VulkanEngine::draw_test() {
+    const MeshRange *range          = _meshArena.get(mesh);
+    _objectData[object].vertexCount = range != nullptr ? range->vertexCount : 0;
+    _objectData[object].firstVertex = range != nullptr ? range->firstVertex : 0;
+}
+
+void VulkanEngine::simulate(float dt) {
+    const SimInput &input = _simInput.read();
+
+    if ((input.flyToggles - _appliedFlyToggles) & 1) {
+        _player.flying = !_player.flying;
+    }
+    _appliedFlyToggles = input.flyToggles;
+
+    _player.step(_world, input.moveDirection, input.jump, dt);
+
+    const std::vector<RigidBody> &bodies = _physics.get_bodies();
+    for (uint32_t i = 0; i < bodies.size(); i++) {
+        _previousBodies[i] = BodyPose{bodies[i].position, bodies[i].orientation, bodies[i].halfExtents};
+    }
+    _physics.step(dt);
+}
+
+void VulkanEngine::publish_snapshot(double stateTime) {
+    SimSnapshot &snapshot           = _simOutput.write_buffer();
+    snapshot.previousPlayerPosition = _player.previousPosition;
+    snapshot.playerPosition         = _player.position;
+    snapshot.previousBodies         = _previousBodies;
+    snapshot.time                   = stateTime;
+
+    snapshot.bodies.clear();
+    for (const RigidBody &body : _physics.get_bodies()) {
+        snapshot.bodies.push_back(BodyPose{body.position, body.orientation, body.halfExtents});
+    }
+    _simOutput.publish();
+}
+
+// Gribb and Hartmann, the planes are the sums and differences of the rows. The near plane is the one
+// of a -1..1 depth range, closer to the camera than the one the projection clips at, so it only
+// culls less.
+static void frustum_planes(const glm::mat4 &viewproj, glm::vec4 planes[6]) {
+    glm::mat4 rows = glm::transpose(viewproj);
+    planes[0]      = rows[3] + rows[0];
+    planes[1]      = rows[3] - rows[0];
+    planes[2]      = rows[3] + rows[1];
+    planes[3]      = rows[3] - rows[1];
+    planes[4]      = rows[3] + rows[2];
+    planes[5]      = rows[3] - rows[2];
+    for (uint32_t i = 0; i < 6; i++) {
+        planes[i] /= glm::length(glm::vec3(planes[i]));
+    }
+}
+
+void VulkanEngine::prepare_draws() {
     /*Camera*/
     auto view = _cam.get_view();
     //  camera projection
@@ -92,57 +285,37 @@ void VulkanEngine::draw_test() {
     void *data;
     this->global.write_descriptor_set("camera", 0, this->_allocator, &camData, sizeof(GPUCamera));
 
-    glm::vec3              position = glm::vec3(0, 0, 0);
-    std::vector<GPUObject> objects;
-    for (int i = 0; i < MAX_OBJECTS; i++) {
-        position.x += 1;
-        glm::mat4 positionMatrix = glm::translate(glm::mat4(1.0f), position);
-        GPUObject object;
-        object.transformMatrix = positionMatrix;
+    const SimSnapshot &snapshot = _simOutput.read();
+    float              alpha    = glm::clamp((float)((seconds_now() - snapshot.time) / FIXED_TIMESTEP), 0.0f, 1.0f);
+    _drawObjectCount            = update_objects(snapshot, alpha);
 
-        objects.push_back(object);
+    // moved meshes are copied before the draws of this frame, which already take the new ranges
+    _meshArena.compact();
+    _voxelTerrain.get_arena().compact();
+    if (_meshArena.get_version() != _meshVersion) {
+        for (uint32_t object = 0; object < _objectMeshes.size(); object++) {
+            set_object_mesh(object, _objectMeshes[object]);
+        }
+        VK_CHECK(vmaFlushAllocation(_allocator, c_buffer._allocation, 0, VK_WHOLE_SIZE));
+        _meshVersion = _meshArena.get_version();
     }
-    //     std::memcpy(dstData, srcData, srcSize);
-    //     vmaUnmapMemory(allocator, set.bindingsPointers[bindingIndex].value()._allocation);
-    DescriptorWriter writer;
-    // writer.write_buffer(0, objects, size_t size, size_t offset, VkDescriptorType type)
-    this->global.write_descriptor_set("object", 0, this->_allocator, objects.data(), sizeof(GPUObject) * MAX_OBJECTS);
 
-    DescriptorSet cameraSet = global.get_descriptor_set("camera");
-    DescriptorSet objectSet = global.get_descriptor_set("object");
-    DescriptorSet cubemap   = global.get_descriptor_set("cubemap");
-
-    vkCmdBindPipeline(this->cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pipeline);
-
-    vkCmdBindDescriptorSets(this->cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pipelineLayout, 0, 1, &cameraSet.descriptorSet, 0, nullptr);
-
-    vkCmdBindDescriptorSets(this->cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pipelineLayout, 1, 1, &objectSet.descriptorSet, 0, nullptr);
-    vkCmdBindDescriptorSets(this->cmd, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pipelineLayout, 2, 1, &cubemap.descriptorSet, 0, nullptr);
-    VkDeviceSize offset         = 0;
-    auto         verticesBuffer = Cube::get_vertices_buffer()._buffer;
-    vkCmdBindVertexBuffers(this->cmd, 0, 1, &verticesBuffer, &offset);
-
-    for (int i = 0; i < MAX_OBJECTS; i++) {
-        vkCmdDraw(this->cmd, Cube::get_vertices_size(), 1, 0, i);
-    }
+    // the flip of y only changes the side of the screen the cull shader maps up to
+    _cullData->view            = view;
+    _cullData->projScaleX      = projection[0][0];
+    _cullData->projScaleY      = -projection[1][1];
+    _cullData->projDepthScale  = projection[2][2];
+    _cullData->projDepthOffset = projection[3][2];
+    _cullData->depthSize       = glm::vec2(_windowExtent.width, _windowExtent.height);
+    _cullData->znear           = 0.1f;
+    _cullData->objectCount     = _drawObjectCount;
+    _cullData->pyramidLevels   = _depthPyramid.get_level_count();
+    _cullData->drawCapacity    = MAX_DRAW_OBJECTS;
+    frustum_planes(camData.viewproj, _cullData->frustum);
+    VK_CHECK(vmaFlushAllocation(_allocator, _cullDataBuffer._allocation, 0, VK_WHOLE_SIZE));
 }
 
-void VulkanEngine::draw() {
-    // // check if window is minimized and skip drawing
-    if (SDL_GetWindowFlags(_window) & SDL_WINDOW_MINIMIZED)
-        return;
-
-    /*SYNC FRAME*/
-    VK_CHECK(vkWaitForFences(_device, 1, &this->fence_wait, true, 1000000000));
-    VK_CHECK(vkResetFences(_device, 1, &this->fence_wait));
-
-    uint32_t swapchainImageIndex;
-    VK_CHECK(vkAcquireNextImageKHR(_device, _swapchain, 1000000000, this->present_semp, nullptr, &swapchainImageIndex));
-
-    VkCommandBufferBeginInfo cmdBeginInfo = vkinit::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
-    VK_CHECK(vkResetCommandBuffer(this->cmd, 0));
-    VK_CHECK(vkBeginCommandBuffer(this->cmd, &cmdBeginInfo));
-
+void VulkanEngine::record_scene(VkCommandBuffer cmd, VkAttachmentLoadOp loadOp, VkAttachmentStoreOp depthStoreOp, uint32_t phase) {
     VkClearValue clearValue;
     clearValue.color = {1.0f, 1.0f, 1.0f, 1.0f};
     VkClearValue depthClear;
@@ -153,8 +326,8 @@ void VulkanEngine::draw() {
     colorAttachment.sType       = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
     colorAttachment.clearValue  = clearValue;
     colorAttachment.imageLayout = VK_IMAGE_LAYOUT_ATTACHMENT_OPTIMAL_KHR;
-    colorAttachment.imageView   = _swapchainImageViews[swapchainImageIndex];
-    colorAttachment.loadOp      = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.imageView   = _renderGraph.get_view(_graphSwapchain);
+    colorAttachment.loadOp      = loadOp;
     colorAttachment.storeOp     = VK_ATTACHMENT_STORE_OP_STORE;
     colorAttachment.resolveMode = VK_RESOLVE_MODE_NONE;
 
@@ -163,28 +336,175 @@ void VulkanEngine::draw() {
     depthAttachment.sType       = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
     depthAttachment.clearValue  = depthClear;
     depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
-    depthAttachment.imageView   = _depthImageView;
-    depthAttachment.loadOp      = VK_ATTACHMENT_LOAD_OP_CLEAR;
-    depthAttachment.storeOp     = VK_ATTACHMENT_STORE_OP_STORE;
+    depthAttachment.imageView   = _renderGraph.get_view(_graphDepth);
+    depthAttachment.loadOp      = loadOp;
+    depthAttachment.storeOp     = depthStoreOp;
 
     VkRenderingInfoKHR dynamicInfo   = {};
     dynamicInfo.pNext                = nullptr;
     dynamicInfo.sType                = VK_STRUCTURE_TYPE_RENDERING_INFO;
+    dynamicInfo.flags                = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
     dynamicInfo.colorAttachmentCount = 1;
     dynamicInfo.pColorAttachments    = &colorAttachment;
     dynamicInfo.pDepthAttachment     = &depthAttachment;
     dynamicInfo.renderArea           = {{0, 0}, _windowExtent};
     dynamicInfo.layerCount           = 1;
 
-    Helper::transition_image_layout(VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, _swapchainImages[swapchainImageIndex], cmd);
-
     deviceFunctions.cmdBeginRenderingKHR(cmd, &dynamicInfo);
 
-    draw_test();
+    draw_test(cmd, phase);
 
     deviceFunctions.cmdEndRenderingKHR(cmd);
+}
+
+void VulkanEngine::draw_test(VkCommandBuffer cmd, uint32_t phase) {
+    DescriptorSet cameraSet = global.get_descriptor_set("camera");
+
+    // secondaries inherit no bound state, each binds these once and the draws bind nothing
+    VkDescriptorSet sets[]         = {cameraSet.descriptorSet, _bindless.get_set()};
+    VkDeviceSize    offset         = 0;
+    VkBuffer        verticesBuffer = _meshArena.get_vertex_buffer();
+
+    VkCommandBufferInheritanceRenderingInfo rendering = {.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO};
+    rendering.colorAttachmentCount                    = 1;
+    rendering.pColorAttachmentFormats                 = &_swapchainImageFormat;
+    rendering.depthAttachmentFormat                   = _depthFormat;
+    rendering.rasterizationSamples                    = VK_SAMPLE_COUNT_1_BIT;
+
+    // The ground isn't culled. It goes first in the early phase, so it is in the depth the pyramid is
+    // built from and hides the objects behind it from the late phase.
+    if (phase == 0 && _voxelTerrain.get_face_count() > 0) {
+        VkCommandBuffer secondary = _secondaryRecorder.begin(rendering);
+        vkCmdBindPipeline(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, _voxelPipeline);
+        vkCmdBindDescriptorSets(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, _voxelLayout, 0, 2, sets, 0, nullptr);
+        vkCmdPushConstants(secondary, _voxelLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(GPUVoxelConstants), &_voxelConstants);
+        _voxelTerrain.draw(secondary);
+        VK_CHECK(vkEndCommandBuffer(secondary));
+
+        vkCmdExecuteCommands(cmd, 1, &secondary);
+    }
+
+    auto begin_draws = [&]() {
+        VkCommandBuffer secondary = _secondaryRecorder.begin(rendering);
+        vkCmdBindPipeline(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pipeline);
+        vkCmdBindDescriptorSets(secondary, VK_PIPELINE_BIND_POINT_GRAPHICS, this->pipelineLayout, 0, 2, sets, 0, nullptr);
+        vkCmdPushConstants(secondary, this->pipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(GPUDrawConstants), &_drawConstants);
+        vkCmdBindVertexBuffers(secondary, 0, 1, &verticesBuffer, &offset);
+        vkCmdBindIndexBuffer(secondary, _meshArena.get_index_buffer(), 0, VK_INDEX_TYPE_UINT32);
+        return secondary;
+    };
+
+    // the cull pass of the phase wrote a draw per visible object, firstInstance is the object
+    if (bGpuDrivenDraws) {
+        VkCommandBuffer secondary = begin_draws();
+        VkDeviceSize    drawStart = phase * MAX_DRAW_OBJECTS * sizeof(VkDrawIndirectCommand);
+        vkCmdDrawIndirectCount(secondary, _drawCommandBuffer._buffer, drawStart, _drawCountBuffer._buffer, phase * sizeof(uint32_t), MAX_DRAW_OBJECTS, sizeof(VkDrawIndirectCommand));
+        VK_CHECK(vkEndCommandBuffer(secondary));
+
+        vkCmdExecuteCommands(cmd, 1, &secondary);
+        return;
+    }
 
-    Helper::transition_image_layout(VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, _swapchainImages[swapchainImageIndex], cmd);
+    // every range of draws goes into its own secondary, executed in range order whichever thread
+    // recorded it
+    const MeshRange             *cube           = _meshArena.get(Cube::get_mesh());
+    uint32_t                     objectCount    = _drawObjectCount;
+    uint32_t                     secondaryCount = std::max(1u, (objectCount + DRAWS_PER_SECONDARY - 1) / DRAWS_PER_SECONDARY);
+    FrameVector<VkCommandBuffer> secondaries(secondaryCount);
+    _jobs.parallel_for(secondaryCount, 1, [&](uint32_t begin, uint32_t end) {
+        for (uint32_t s = begin; s < end; s++) {
+            VkCommandBuffer secondary = begin_draws();
+
+            uint32_t last = std::min(objectCount, (s + 1) * DRAWS_PER_SECONDARY);
+            for (uint32_t i = s * DRAWS_PER_SECONDARY; i < last; i++) {
+                vkCmdDraw(secondary, cube->vertexCount, 1, cube->firstVertex, i);
+            }
+
+            VK_CHECK(vkEndCommandBuffer(secondary));
+            secondaries[s] = secondary;
+        }
+    });
+
+    vkCmdExecuteCommands(cmd, secondaryCount, secondaries.data());
+}
+
+uint32_t VulkanEngine::update_objects(const SimSnapshot &snapshot, float alpha) {
+    // only the bodies move, the static blocks stay clean and are never written again
+    _scene.query<Transform, PhysicsBody, SceneNode>().parallel_each_chunk(_jobs, [&](uint32_t, uint32_t count, const Entity *, Transform *transforms, PhysicsBody *bodies, SceneNode *nodes) {
+        for (uint32_t i = 0; i < count; i++) {
+            const BodyPose &previous = snapshot.previousBodies[bodies[i].body];
+            const BodyPose &current  = snapshot.bodies[bodies[i].body];
+
+            transforms[i].position    = glm::mix(previous.position, current.position, alpha);
+            transforms[i].orientation = glm::slerp(previous.orientation, current.orientation, alpha);
+            _transforms.set_local(nodes[i].node, local_matrix(transforms[i]));
+        }
+    });
+    _transforms.update(&_jobs);
+
+    for (uint32_t node : _transforms.get_changed()) {
+        uint32_t object = _transforms.get_object(node);
+        if (object < MAX_DRAW_OBJECTS) {
+            _objectData[object].transformMatrix = _transforms.get_world(node);
+        }
+    }
+
+    // flush only the slots that were written
+    FrameVector<VmaAllocation> allocations;
+    FrameVector<VkDeviceSize>  offsets;
+    FrameVector<VkDeviceSize>  sizes;
+    for (const ObjectRange &range : _transforms.get_dirty_ranges()) {
+        if (range.first >= MAX_DRAW_OBJECTS) {
+            break;
+        }
+        allocations.push_back(c_buffer._allocation);
+        offsets.push_back(range.first * sizeof(GPUObject));
+        sizes.push_back(std::min(range.count, MAX_DRAW_OBJECTS - range.first) * sizeof(GPUObject));
+    }
+    if (!allocations.empty()) {
+        vmaFlushAllocations(_allocator, (uint32_t)allocations.size(), allocations.data(), offsets.data(), sizes.data());
+    }
+
+    return std::min(_objectCount, MAX_DRAW_OBJECTS);
+}
+
+void VulkanEngine::draw() {
+    // // check if window is minimized and skip drawing
+    if (SDL_GetWindowFlags(_window) & SDL_WINDOW_MINIMIZED)
+        return;
+
+    /*SYNC FRAME*/
+    VK_CHECK(vkWaitForFences(_device, 1, &this->fence_wait, true, 1000000000));
+    VK_CHECK(vkResetFences(_device, 1, &this->fence_wait));
+
+    // the fence belongs to the last submitted frame, what was retired up to it isn't used anymore
+    if (_frameNumber > 0) {
+        _deletionQueue.collect(_frameNumber - 1);
+        _bindless.collect(_frameNumber - 1);
+        _meshArena.collect(_frameNumber - 1);
+        _voxelTerrain.get_arena().collect(_frameNumber - 1);
+    }
+    if (bGpuDrivenDraws && _frameNumber > 0) {
+        VK_CHECK(vmaInvalidateAllocation(_allocator, _cullStatsBuffer._allocation, 0, VK_WHOLE_SIZE));
+        _cullStats = *_cullStatsData;
+    }
+    _deletionQueue.set_frame(_frameNumber);
+    _bindless.set_frame(_frameNumber);
+    _meshArena.set_frame(_frameNumber);
+    _voxelTerrain.get_arena().set_frame(_frameNumber);
+    _secondaryRecorder.reset();
+
+    uint32_t swapchainImageIndex;
+    VK_CHECK(vkAcquireNextImageKHR(_device, _swapchain, 1000000000, this->present_semp, nullptr, &swapchainImageIndex));
+
+    VkCommandBufferBeginInfo cmdBeginInfo = vkinit::command_buffer_begin_info(VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    VK_CHECK(vkResetCommandBuffer(this->cmd, 0));
+    VK_CHECK(vkBeginCommandBuffer(this->cmd, &cmdBeginInfo));
+
+    prepare_draws();
+
+    _renderGraph.set_external(_graphSwapchain, _swapchainImages[swapchainImageIndex], _swapchainImageViews[swapchainImageIndex]);
+    _renderGraph.execute(cmd);
 
     VK_CHECK(vkEndCommandBuffer(cmd));
 
@@ -221,24 +541,27 @@ void VulkanEngine::run() {
     SDL_Event e;
     bool      bQuit = false;
 
-    float delta_time = 0;
-    auto  last_frame = 0.0f;
-
     SDL_bool mouse_inside_window = SDL_FALSE;
     SDL_SetRelativeMouseMode(mouse_inside_window); // fix true later
 
     int  relX, relY;
     bool move_keys[] = {0, 0, 0, 0};
+
+    _simLoop = FixedStepLoop(FIXED_TIMESTEP, MAX_CATCH_UP_STEPS);
+    if (bThreadedSimulation) {
+        _simThread.start(_simLoop, [this](float dt) { simulate(dt); }, [this](double stateTime) { publish_snapshot(stateTime); });
+    } else {
+        _simLoop.reset(seconds_now());
+    }
+
+    uint64_t heapAllocations = heap_allocation_count();
+
     // main loop
     const Uint8 *keystate = SDL_GetKeyboardState(NULL);
     while (!bQuit) {
-        float current_frame = (float)SDL_GetTicks64() / 1000;
+        // nothing from the last frame is used anymore
+        frame_arena().reset();
 
-        delta_time = current_frame - last_frame;
-        last_frame = current_frame;
-
-        SDL_GetRelativeMouseState(&relX, &relY);
-        _cam.process_input(nullptr, delta_time, relX, relY, keystate, mouse_inside_window);
         while (SDL_PollEvent(&e) != 0) {
             // ImGui_ImplSDL2_ProcessEvent(&e);
             if (e.type == SDL_QUIT) {
@@ -249,10 +572,58 @@ void VulkanEngine::run() {
                     mouse_inside_window = (SDL_bool)!mouse_inside_window;
                     SDL_SetRelativeMouseMode(mouse_inside_window);
                 }
+                if (e.key.keysym.sym == SDLK_f) {
+                    _flyToggles++;
+                }
+            }
+        }
+
+        // read the input after the events are pumped, otherwise it lags a frame behind
+        SDL_GetRelativeMouseState(&relX, &relY);
+        _cam.process_input(nullptr, relX, relY, keystate, mouse_inside_window);
+
+        SimInput &input     = _simInput.write_buffer();
+        input.moveDirection = _cam.get_move_direction();
+        input.jump          = keystate[SDL_SCANCODE_SPACE] != 0;
+        input.flyToggles    = _flyToggles;
+        _simInput.publish();
+
+        /*Fixed step*/
+        if (!bThreadedSimulation) {
+            uint32_t steps = _simLoop.advance(seconds_now());
+            for (uint32_t i = 0; i < steps; i++) {
+                simulate((float)_simLoop.step());
+            }
+            if (steps > 0) {
+                publish_snapshot(_simLoop.state_time());
             }
         }
+
+        const SimSnapshot &snapshot = _simOutput.read();
+
+        float alpha = glm::clamp((float)((seconds_now() - snapshot.time) / FIXED_TIMESTEP), 0.0f, 1.0f);
+        _cam.set_camera_position(glm::mix(snapshot.previousPlayerPosition, snapshot.playerPosition, alpha) + EYE_OFFSET);
+
         draw();
+
+        if (TRACK_ALLOCATIONS && _frameNumber % ALLOCATION_REPORT_FRAMES == 0) {
+            uint64_t count = heap_allocation_count();
+            printf("frame %d: %.1f heap allocations per frame, frame arena peak %zu bytes\n", _frameNumber, (double)(count - heapAllocations) / ALLOCATION_REPORT_FRAMES, frame_arena().get_peak());
+            heapAllocations = count;
+        }
+        if (RENDER_STATS && bGpuDrivenDraws && _frameNumber % CULL_REPORT_FRAMES == 0) {
+            uint32_t drawn = _cullStats.drawn[0] + _cullStats.drawn[1];
+            printf("frame %d: %u objects drawn (%u early, %u late), %u outside the frustum, %u occluded\n", _frameNumber, drawn, _cullStats.drawn[0], _cullStats.drawn[1], _cullStats.frustumCulled,
+                   _cullStats.occlusionCulled);
+        }
+        if (RENDER_STATS && _frameNumber % MESH_REPORT_FRAMES == 0) {
+            MeshArena::Report mesh = _meshArena.report();
+            printf("frame %d: %u meshes, %u vertices free in %u ranges (%.0f%% fragmented), %u indices free, %u moved\n", _frameNumber, mesh.meshes, mesh.vertices.freeSize, mesh.vertices.freeRanges,
+                   mesh.vertices.fragmentation * 100.0f, mesh.indices.freeSize, mesh.moved);
+        }
     }
+
+    _simThread.stop();
 }
 
 void VulkanEngine::init_vulkan() {
@@ -277,25 +648,46 @@ void VulkanEngine::init_vulkan() {
     dynamicRendering.sType                     = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_LOCAL_READ_FEATURES_KHR;
     dynamicRendering.dynamicRenderingLocalRead = VK_TRUE;
 
-    VkPhysicalDeviceFeatures features;
+    VkPhysicalDeviceFeatures features{};
 
-    features.imageCubeArray    = true;
-    features.samplerAnisotropy = true;
+    features.imageCubeArray            = true;
+    features.samplerAnisotropy         = true;
+    features.multiDrawIndirect         = true; // the culled draws
+    features.drawIndirectFirstInstance = true;
     VkPhysicalDeviceVulkan11Features features_11;
     features_11.shaderDrawParameters = true;
+    // descriptor indexing for the bindless set
+    VkPhysicalDeviceVulkan12Features features_12{};
+    features_12.descriptorIndexing                            = true;
+    features_12.runtimeDescriptorArray                        = true;
+    features_12.descriptorBindingPartiallyBound               = true;
+    features_12.descriptorBindingUpdateUnusedWhilePending     = true;
+    features_12.descriptorBindingSampledImageUpdateAfterBind  = true;
+    features_12.descriptorBindingStorageBufferUpdateAfterBind = true;
+    features_12.shaderSampledImageArrayNonUniformIndexing     = true;
+    features_12.shaderStorageBufferArrayNonUniformIndexing    = true;
+    features_12.drawIndirectCount                             = true;
     VkPhysicalDeviceVulkan13Features features_13;
     features_13.dynamicRendering = true;
+    features_13.synchronization2 = true;
 
     vkb::PhysicalDeviceSelector selector{vkb_inst};
     vkb::PhysicalDevice         physicalDevice = selector.set_minimum_version(1, 3)
                                              .set_required_features(features)
                                              .set_required_features_11(features_11)
+                                             .set_required_features_12(features_12)
                                              .set_required_features_13(features_13)
                                              .add_required_extension(device_extensions[0])
                                              .set_surface(_surface)
                                              .select()
                                              .value();
 
+    // block compressed textures when the gpu samples them, the png atlas otherwise
+    VkPhysicalDeviceFeatures supported;
+    vkGetPhysicalDeviceFeatures(physicalDevice.physical_device, &supported);
+    _textureCompressionBC                        = supported.textureCompressionBC == VK_TRUE;
+    physicalDevice.features.textureCompressionBC = supported.textureCompressionBC;
+
     // create the final vulkan device
 
     vkb::DeviceBuilder deviceBuilder{physicalDevice};
@@ -321,6 +713,7 @@ void VulkanEngine::init_vulkan() {
     allocatorInfo.device                 = _device;
     allocatorInfo.instance               = _instance;
     vmaCreateAllocator(&allocatorInfo, &_allocator);
+    _deletionQueue.init(_device, _allocator);
 
     vkGetPhysicalDeviceProperties(_chosenGPU, &_gpuProperties);
 
@@ -345,28 +738,8 @@ void VulkanEngine::init_swapchain() {
 
     _swapchainImageFormat = vkbSwapchain.image_format;
 
-    // depth image size will match the window
-    VkExtent3D depthImageExtent = {_windowExtent.width, _windowExtent.height, 1};
-
-    // hardcoding the depth format to 32 bit float
+    // hardcoding the depth format to 32 bit float, the image itself is a transient of the render graph
     _depthFormat = VK_FORMAT_D32_SFLOAT;
-
-    // the depth image will be a image with the format we selected and Depth
-    // Attachment usage flag
-    VkImageCreateInfo dimg_info = vkinit::image_create_info(_depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, depthImageExtent);
-
-    // for the depth image, we want to allocate it from gpu local memory
-    VmaAllocationCreateInfo dimg_allocinfo = {};
-    dimg_allocinfo.usage                   = VMA_MEMORY_USAGE_GPU_ONLY;
-    dimg_allocinfo.requiredFlags           = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
-
-    // allocate and create the image
-    vmaCreateImage(_allocator, &dimg_info, &dimg_allocinfo, &_depthImage._image, &_depthImage._allocation, nullptr);
-
-    // build a image-view for the depth image to use for rendering
-    VkImageViewCreateInfo dview_info = vkinit::imageview_create_info(_depthFormat, _depthImage._image, VK_IMAGE_ASPECT_DEPTH_BIT);
-
-    VK_CHECK(vkCreateImageView(_device, &dview_info, nullptr, &_depthImageView));
 }
 
 void VulkanEngine::init_commands() {
@@ -405,9 +778,13 @@ void VulkanEngine::init_pipelines(std::unordered_map<std::string, VkShaderModule
     /*Layout PUSH*/
     VkPipelineLayoutCreateInfo triangleLayoutInfo = vkinit::pipeline_layout_create_info();
 
-    VkDescriptorSetLayout layouts[]   = {c_cameraLayout, c_objectLayout, c_textureLayout};
-    triangleLayoutInfo.pSetLayouts    = layouts;
-    triangleLayoutInfo.setLayoutCount = sizeof(layouts) / sizeof(layouts[0]);
+    VkPushConstantRange drawConstants = {VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(GPUDrawConstants)};
+
+    VkDescriptorSetLayout layouts[]           = {c_cameraLayout, _bindless.get_layout()};
+    triangleLayoutInfo.pSetLayouts            = layouts;
+    triangleLayoutInfo.setLayoutCount         = sizeof(layouts) / sizeof(layouts[0]);
+    triangleLayoutInfo.pPushConstantRanges    = &drawConstants;
+    triangleLayoutInfo.pushConstantRangeCount = 1;
 
     VK_CHECK(vkCreatePipelineLayout(this->_device, &triangleLayoutInfo, nullptr, &this->pipelineLayout));
 
@@ -458,6 +835,42 @@ void VulkanEngine::init_pipelines(std::unordered_map<std::string, VkShaderModule
     pipelineCreateInfo.depthAttachmentFormat            = _depthFormat;
 
     this->pipeline = pipelineBuilder.build_pipeline(_device, pipelineCreateInfo);
+
+    /*Voxel*/
+    // no vertex input, the vertex shader pulls the faces itself
+    VkPushConstantRange voxelConstants = {VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(GPUVoxelConstants)};
+
+    VkPipelineLayoutCreateInfo voxelLayoutInfo = vkinit::pipeline_layout_create_info();
+    voxelLayoutInfo.pSetLayouts                = layouts;
+    voxelLayoutInfo.setLayoutCount             = sizeof(layouts) / sizeof(layouts[0]);
+    voxelLayoutInfo.pPushConstantRanges        = &voxelConstants;
+    voxelLayoutInfo.pushConstantRangeCount     = 1;
+    VK_CHECK(vkCreatePipelineLayout(_device, &voxelLayoutInfo, nullptr, &_voxelLayout));
+
+    pipelineBuilder._shaderStages[0] = vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_VERTEX_BIT, d.get_shader("voxel.vert.spv").shaderModule);
+    pipelineBuilder._vertexInputInfo = vkinit::vertex_input_state_create_info();
+    pipelineBuilder._pipelineLayout  = _voxelLayout;
+
+    _voxelPipeline = pipelineBuilder.build_pipeline(_device, pipelineCreateInfo);
+
+    /*Cull*/
+    VkPushConstantRange   cullConstants  = {VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(GPUCullConstants)};
+    VkDescriptorSetLayout bindlessLayout = _bindless.get_layout();
+
+    VkPipelineLayoutCreateInfo cullLayoutInfo = vkinit::pipeline_layout_create_info();
+    cullLayoutInfo.pSetLayouts                = &bindlessLayout;
+    cullLayoutInfo.setLayoutCount             = 1;
+    cullLayoutInfo.pPushConstantRanges        = &cullConstants;
+    cullLayoutInfo.pushConstantRangeCount     = 1;
+    VK_CHECK(vkCreatePipelineLayout(_device, &cullLayoutInfo, nullptr, &_cullLayout));
+
+    VkComputePipelineCreateInfo cullInfo = {.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO};
+    cullInfo.stage                       = vkinit::pipeline_shader_stage_create_info(VK_SHADER_STAGE_COMPUTE_BIT, d.get_shader("cull.comp.spv").shaderModule);
+    cullInfo.layout                      = _cullLayout;
+    VK_CHECK(vkCreateComputePipelines(_device, VK_NULL_HANDLE, 1, &cullInfo, nullptr, &_cullPipeline));
+
+    _depthPyramid.init(_device, _allocator, &_bindless, _windowExtent, d.get_shader("depth_pyramid.comp.spv").shaderModule);
+    _cullConstants.pyramidTexture = _depthPyramid.get_texture();
 }
 
 VkPipeline PipelineBuilder::build_pipeline(VkDevice device, VkPipelineRenderingCreateInfoKHR pass) {
@@ -526,66 +939,241 @@ VkPipeline PipelineBuilder::build_pipeline(VkDevice device, VkPipelineRenderingC
 }
 
 void VulkanEngine::init_hdr() {}
+
+void VulkanEngine::init_render_graph() {
+    _renderGraph.init(_device, _allocator);
+
+    // the acquire semaphore is waited on at the color output stage
+    _graphSwapchain  = _renderGraph.import_image("swapchain", VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+    _graphDepth      = _renderGraph.create_image("depth", TransientImageInfo{_depthFormat, _windowExtent, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_IMAGE_ASPECT_DEPTH_BIT});
+    _graphVertices   = _renderGraph.import_buffer("mesh vertices", _meshArena.get_vertex_buffer());
+    _graphIndices    = _renderGraph.import_buffer("mesh indices", _meshArena.get_index_buffer());
+    _graphVoxelFaces = _renderGraph.import_buffer("voxel faces", _voxelTerrain.get_arena().get_vertex_buffer());
+
+    // new meshes and the ones compaction moved
+    uint32_t uploads = _renderGraph.add_pass("mesh uploads", [this](VkCommandBuffer cmd) {
+        _meshArena.record_uploads(cmd);
+        _voxelTerrain.get_arena().record_uploads(cmd);
+    });
+    _renderGraph.write_buffer(uploads, _graphVertices, BufferUsage::TRANSFER);
+    _renderGraph.write_buffer(uploads, _graphIndices, BufferUsage::TRANSFER);
+    _renderGraph.write_buffer(uploads, _graphVoxelFaces, BufferUsage::TRANSFER);
+
+    if (!bGpuDrivenDraws) {
+        uint32_t scene = _renderGraph.add_pass("scene", [this](VkCommandBuffer cmd) { record_scene(cmd, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_DONT_CARE, 0); });
+        _renderGraph.write(scene, _graphSwapchain, ImageUsage::COLOR_ATTACHMENT);
+        _renderGraph.write(scene, _graphDepth, ImageUsage::DEPTH_ATTACHMENT);
+        _renderGraph.read_buffer(scene, _graphVertices, BufferUsage::VERTEX);
+        _renderGraph.read_buffer(scene, _graphIndices, BufferUsage::VERTEX);
+        _renderGraph.read_buffer(scene, _graphVoxelFaces, BufferUsage::VERTEX_STORAGE);
+    } else {
+        // Two phases. The early one draws what was visible last frame, the pyramid is built from its
+        // depth and the late one tests everything against it, drawing only what the early one missed.
+        _graphDrawCommands   = _renderGraph.import_buffer("draw commands", _drawCommandBuffer._buffer);
+        _graphDrawCount      = _renderGraph.import_buffer("draw count", _drawCountBuffer._buffer);
+        _graphVisibility     = _renderGraph.import_buffer("visibility", _visibilityBuffer._buffer);
+        _graphCullStats      = _renderGraph.import_buffer("cull stats", _cullStatsBuffer._buffer, true);
+        _graphPyramidCounter = _renderGraph.import_buffer("depth pyramid counter", _depthPyramid.get_counter_buffer());
+        _graphPyramid        = _renderGraph.import_image("depth pyramid", VK_IMAGE_ASPECT_COLOR_BIT, VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_2_COMPUTE_SHADER_BIT);
+
+        // the cull passes append to the counts, and nothing was visible before the first frame
+        uint32_t clear = _renderGraph.add_pass("clear cull counters", [this](VkCommandBuffer cmd) {
+            vkCmdFillBuffer(cmd, _drawCountBuffer._buffer, 0, VK_WHOLE_SIZE, 0);
+            vkCmdFillBuffer(cmd, _cullStatsBuffer._buffer, 0, VK_WHOLE_SIZE, 0);
+            if (_frameNumber == 0) {
+                vkCmdFillBuffer(cmd, _visibilityBuffer._buffer, 0, VK_WHOLE_SIZE, 0);
+            }
+        });
+        _renderGraph.write_buffer(clear, _graphDrawCount, BufferUsage::TRANSFER);
+        _renderGraph.write_buffer(clear, _graphCullStats, BufferUsage::TRANSFER);
+        _renderGraph.write_buffer(clear, _graphVisibility, BufferUsage::TRANSFER);
+
+        auto cull_phase = [this](uint32_t phase) {
+            return [this, phase](VkCommandBuffer cmd) {
+                GPUCullConstants constants = _cullConstants;
+                constants.phase            = phase;
+                VkDescriptorSet bindlessSet = _bindless.get_set();
+                vkCmdBindPipeline(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _cullPipeline);
+                vkCmdBindDescriptorSets(cmd, VK_PIPELINE_BIND_POINT_COMPUTE, _cullLayout, 0, 1, &bindlessSet, 0, nullptr);
+                vkCmdPushConstants(cmd, _cullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(GPUCullConstants), &constants);
+                vkCmdDispatch(cmd, (_drawObjectCount + CULL_GROUP_SIZE - 1) / CULL_GROUP_SIZE, 1, 1);
+            };
+        };
+
+        uint32_t earlyCull = _renderGraph.add_pass("early cull", cull_phase(0));
+        _renderGraph.read_buffer(earlyCull, _graphVisibility, BufferUsage::STORAGE);
+        _renderGraph.write_buffer(earlyCull, _graphDrawCommands, BufferUsage::STORAGE);
+        _renderGraph.write_buffer(earlyCull, _graphDrawCount, BufferUsage::STORAGE);
+        _renderGraph.write_buffer(earlyCull, _graphCullStats, BufferUsage::STORAGE);
+
+        uint32_t earlyDraw = _renderGraph.add_pass("early draw", [this](VkCommandBuffer cmd) { record_scene(cmd, VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE, 0); });
+        _renderGraph.write(earlyDraw, _graphSwapchain, ImageUsage::COLOR_ATTACHMENT);
+        _renderGraph.write(earlyDraw, _graphDepth, ImageUsage::DEPTH_ATTACHMENT);
+        _renderGraph.read_buffer(earlyDraw, _graphDrawCommands, BufferUsage::INDIRECT);
+        _renderGraph.read_buffer(earlyDraw, _graphDrawCount, BufferUsage::INDIRECT);
+        _renderGraph.read_buffer(earlyDraw, _graphVertices, BufferUsage::VERTEX);
+        _renderGraph.read_buffer(earlyDraw, _graphIndices, BufferUsage::VERTEX);
+        _renderGraph.read_buffer(earlyDraw, _graphVoxelFaces, BufferUsage::VERTEX_STORAGE);
+
+        uint32_t pyramid = _renderGraph.add_pass("depth pyramid", [this](VkCommandBuffer cmd) { _depthPyramid.build(cmd); });
+        _renderGraph.read(pyramid, _graphDepth, ImageUsage::COMPUTE_SAMPLED);
+        _renderGraph.write(pyramid, _graphPyramid, ImageUsage::STORAGE);
+        _renderGraph.write_buffer(pyramid, _graphPyramidCounter, BufferUsage::STORAGE);
+
+        uint32_t lateCull = _renderGraph.add_pass("late cull", cull_phase(1));
+        _renderGraph.read(lateCull, _graphPyramid, ImageUsage::COMPUTE_SAMPLED);
+        _renderGraph.write_buffer(lateCull, _graphVisibility, BufferUsage::STORAGE);
+        _renderGraph.write_buffer(lateCull, _graphDrawCommands, BufferUsage::STORAGE);
+        _renderGraph.write_buffer(lateCull, _graphDrawCount, BufferUsage::STORAGE);
+        _renderGraph.write_buffer(lateCull, _graphCullStats, BufferUsage::STORAGE);
+
+        uint32_t lateDraw = _renderGraph.add_pass("late draw", [this](VkCommandBuffer cmd) { record_scene(cmd, VK_ATTACHMENT_LOAD_OP_LOAD, VK_ATTACHMENT_STORE_OP_DONT_CARE, 1); });
+        _renderGraph.write(lateDraw, _graphSwapchain, ImageUsage::COLOR_ATTACHMENT);
+        _renderGraph.write(lateDraw, _graphDepth, ImageUsage::DEPTH_ATTACHMENT);
+        _renderGraph.read_buffer(lateDraw, _graphDrawCommands, BufferUsage::INDIRECT);
+        _renderGraph.read_buffer(lateDraw, _graphDrawCount, BufferUsage::INDIRECT);
+        _renderGraph.read_buffer(lateDraw, _graphVertices, BufferUsage::VERTEX);
+        _renderGraph.read_buffer(lateDraw, _graphIndices, BufferUsage::VERTEX);
+    }
+
+    _renderGraph.compile();
+    if (bGpuDrivenDraws) {
+        _renderGraph.set_external(_graphPyramid, _depthPyramid.get_image(), _depthPyramid.get_view());
+        _depthPyramid.set_depth(_renderGraph.get_image(_graphDepth), _depthFormat, _cullConstants.pyramidSampler);
+    }
+    if (RENDER_STATS) {
+        printf("render graph: %u passes culled, %llu KB of transients in %llu KB\n", _renderGraph.get_culled_pass_count(), (unsigned long long)_renderGraph.get_transient_size() / 1024,
+               (unsigned long long)_renderGraph.get_aliased_size() / 1024);
+    }
+}
 void VulkanEngine::init_descriptors() {
     // // new code abstract
 
     VkSamplerCreateInfo sampler = vkinit::sampler_create_info(VK_FILTER_NEAREST);
 
-    // TODO, fix minimapping
+    // Blocky up close, trilinear and anisotropic over the whole mip chain of the block textures further
+    // away, where full resolution texels only alias and thrash the texture cache.
     VkSampler blockySampler;
-    sampler.magFilter    = VK_FILTER_NEAREST;
-    sampler.minFilter    = VK_FILTER_NEAREST;
-    sampler.mipmapMode   = VK_SAMPLER_MIPMAP_MODE_NEAREST;
-    sampler.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-    sampler.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-    sampler.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
-    sampler.mipLodBias   = 0.0f;
-    sampler.compareOp    = VK_COMPARE_OP_LESS_OR_EQUAL;
-    sampler.minLod       = 0.0f;
-    sampler.maxLod       = 1.0f;
-    sampler.borderColor  = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
+    sampler.magFilter        = VK_FILTER_NEAREST;
+    sampler.minFilter        = VK_FILTER_LINEAR;
+    sampler.mipmapMode       = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    sampler.addressModeU     = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler.addressModeV     = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler.addressModeW     = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    sampler.mipLodBias       = 0.0f;
+    sampler.anisotropyEnable = VK_TRUE;
+    sampler.maxAnisotropy    = std::min(BLOCK_MAX_ANISOTROPY, _gpuProperties.limits.maxSamplerAnisotropy);
+    sampler.compareOp        = VK_COMPARE_OP_LESS_OR_EQUAL;
+    sampler.minLod           = 0.0f;
+    sampler.maxLod           = VK_LOD_CLAMP_NONE;
+    sampler.borderColor      = VK_BORDER_COLOR_FLOAT_OPAQUE_WHITE;
 
     vkCreateSampler(_device, &sampler, nullptr, &blockySampler);
 
     _blockySampler = blockySampler;
 
-    TextureHelper::load_texture_array("assets/texture_atlas_0.png", 64, _cubemap, &_cubeview);
+    // AtlasGenerator cooks the atlas next to the png, mips included: block compressed when the gpu samples
+    // bc, uncompressed otherwise. The png is decoded and sliced only when neither is there
+    bool cooked = _textureCompressionBC && TextureHelper::load_block_texture_array("assets/texture_atlas_0.bctex", _cubemap, &_cubeview);
+    cooked      = cooked || TextureHelper::load_block_texture_array("assets/texture_atlas_0.tex", _cubemap, &_cubeview);
+    if (!cooked) {
+        TextureHelper::load_texture_array("assets/texture_atlas_0.png", 64, _cubemap, &_cubeview);
+    }
 
-    VkDescriptorImageInfo imageBufferInfo;
-    imageBufferInfo.sampler     = blockySampler;
-    imageBufferInfo.imageView   = _cubeview;
-    imageBufferInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    _bindless.init(_device, _chosenGPU);
+    uint32_t atlasSlot   = _bindless.add_texture(_cubeview);
+    uint32_t samplerSlot = _bindless.add_sampler(blockySampler);
 
     DescriptorLayoutBuilder builder;
-    builder.add_binding(0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER);
-    c_objectLayout = builder.build(_device, VK_SHADER_STAGE_VERTEX_BIT);
-    builder.clear();
-
     builder.add_binding(0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
     c_cameraLayout = builder.build(_device, VK_SHADER_STAGE_VERTEX_BIT);
     builder.clear();
 
-    builder.add_binding(0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-    builder.add_binding(1, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER);
-    c_textureLayout = builder.build(_device, VK_SHADER_STAGE_FRAGMENT_BIT);
-
-    c_textureSet = c_globalAllocator.allocate(_device, c_textureLayout);
-
-    DescriptorWriter writer;
-    writer.write_image(0, _cubeview, blockySampler, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER);
-    writer.update_set(_device, c_textureSet);
-
     VkBufferCreateInfo bufferInfo{};
-    bufferInfo.size        = sizeof(GPUObject) * MAX_OBJECTS;
+    bufferInfo.size        = sizeof(GPUObject) * MAX_DRAW_OBJECTS;
     bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     bufferInfo.usage       = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
     bufferInfo.sType       = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
 
+    // stays mapped, update_objects writes the transforms straight into it every frame
     VmaAllocationCreateInfo allocInfo = {};
-    allocInfo.usage                   = VMA_MEMORY_USAGE_GPU_ONLY;
-    allocInfo.requiredFlags           = VkMemoryPropertyFlags(VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+    allocInfo.usage                   = VMA_MEMORY_USAGE_AUTO;
+    allocInfo.flags                   = VMA_ALLOCATION_CREATE_HOST_ACCESS_SEQUENTIAL_WRITE_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    VmaAllocationInfo objectAllocation;
+    VK_CHECK(vmaCreateBuffer(_allocator, &bufferInfo, &allocInfo, &c_buffer._buffer, &c_buffer._allocation, &objectAllocation));
+    _objectData = (GPUObject *)objectAllocation.pMappedData;
+    vkinit::debug_object_set_name((uint64_t)c_buffer._buffer, VK_OBJECT_TYPE_BUFFER, "object buffer", deviceFunctions.fp_vkSetDebugUtilsObjectNameEXT, _device);
+
+    _drawConstants.objectBuffer = _bindless.add_storage_buffer(c_buffer._buffer);
+
+    // one material per block type, written once
+    bufferInfo.size = sizeof(GPUTexture) * Block::TYPE_COUNT;
+
+    VmaAllocationInfo materialAllocation;
+    VK_CHECK(vmaCreateBuffer(_allocator, &bufferInfo, &allocInfo, &_materialBuffer._buffer, &_materialBuffer._allocation, &materialAllocation));
+    vkinit::debug_object_set_name((uint64_t)_materialBuffer._buffer, VK_OBJECT_TYPE_BUFFER, "material buffer", deviceFunctions.fp_vkSetDebugUtilsObjectNameEXT, _device);
+
+    GPUTexture *materials = (GPUTexture *)materialAllocation.pMappedData;
+    for (uint32_t i = 0; i < Block::TYPE_COUNT; i++) {
+        // there is no normal atlas yet, the shader falls back to the vertex normal
+        materials[i]                = Block::get_texture((Block::Type)i);
+        materials[i].albedoTexture  = atlasSlot;
+        materials[i].textureSampler = samplerSlot;
+    }
+    VK_CHECK(vmaFlushAllocation(_allocator, _materialBuffer._allocation, 0, VK_WHOLE_SIZE));
+    _drawConstants.materialBuffer = _bindless.add_storage_buffer(_materialBuffer._buffer);
+
+    // only the gpu touches the culled draws
+    VmaAllocationCreateInfo gpuAllocInfo = {};
+    gpuAllocInfo.usage                   = VMA_MEMORY_USAGE_AUTO;
+
+    bufferInfo.size  = sizeof(VkDrawIndirectCommand) * MAX_DRAW_OBJECTS * 2;
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    VK_CHECK(vmaCreateBuffer(_allocator, &bufferInfo, &gpuAllocInfo, &_drawCommandBuffer._buffer, &_drawCommandBuffer._allocation, nullptr));
+    vkinit::debug_object_set_name((uint64_t)_drawCommandBuffer._buffer, VK_OBJECT_TYPE_BUFFER, "draw command buffer", deviceFunctions.fp_vkSetDebugUtilsObjectNameEXT, _device);
+
+    bufferInfo.size  = sizeof(uint32_t) * 2;
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    VK_CHECK(vmaCreateBuffer(_allocator, &bufferInfo, &gpuAllocInfo, &_drawCountBuffer._buffer, &_drawCountBuffer._allocation, nullptr));
+    vkinit::debug_object_set_name((uint64_t)_drawCountBuffer._buffer, VK_OBJECT_TYPE_BUFFER, "draw count buffer", deviceFunctions.fp_vkSetDebugUtilsObjectNameEXT, _device);
+
+    bufferInfo.size  = sizeof(uint32_t) * MAX_DRAW_OBJECTS;
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    VK_CHECK(vmaCreateBuffer(_allocator, &bufferInfo, &gpuAllocInfo, &_visibilityBuffer._buffer, &_visibilityBuffer._allocation, nullptr));
+    vkinit::debug_object_set_name((uint64_t)_visibilityBuffer._buffer, VK_OBJECT_TYPE_BUFFER, "visibility buffer", deviceFunctions.fp_vkSetDebugUtilsObjectNameEXT, _device);
+
+    // rewritten by prepare_draws every frame
+    bufferInfo.size  = sizeof(GPUCullData);
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
+
+    VmaAllocationInfo cullDataAllocation;
+    VK_CHECK(vmaCreateBuffer(_allocator, &bufferInfo, &allocInfo, &_cullDataBuffer._buffer, &_cullDataBuffer._allocation, &cullDataAllocation));
+    vkinit::debug_object_set_name((uint64_t)_cullDataBuffer._buffer, VK_OBJECT_TYPE_BUFFER, "cull data buffer", deviceFunctions.fp_vkSetDebugUtilsObjectNameEXT, _device);
+    _cullData = (GPUCullData *)cullDataAllocation.pMappedData;
+
+    // read back by the host
+    VmaAllocationCreateInfo readbackAllocInfo = {};
+    readbackAllocInfo.usage                   = VMA_MEMORY_USAGE_AUTO;
+    readbackAllocInfo.flags                   = VMA_ALLOCATION_CREATE_HOST_ACCESS_RANDOM_BIT | VMA_ALLOCATION_CREATE_MAPPED_BIT;
+
+    bufferInfo.size  = sizeof(GPUCullStats);
+    bufferInfo.usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+
+    VmaAllocationInfo statsAllocation;
+    VK_CHECK(vmaCreateBuffer(_allocator, &bufferInfo, &readbackAllocInfo, &_cullStatsBuffer._buffer, &_cullStatsBuffer._allocation, &statsAllocation));
+    vkinit::debug_object_set_name((uint64_t)_cullStatsBuffer._buffer, VK_OBJECT_TYPE_BUFFER, "cull stats buffer", deviceFunctions.fp_vkSetDebugUtilsObjectNameEXT, _device);
+    _cullStatsData = (GPUCullStats *)statsAllocation.pMappedData;
+
+    _cullConstants.cullData         = _bindless.add_storage_buffer(_cullDataBuffer._buffer);
+    _cullConstants.objectBuffer     = _drawConstants.objectBuffer;
+    _cullConstants.drawBuffer       = _bindless.add_storage_buffer(_drawCommandBuffer._buffer);
+    _cullConstants.countBuffer      = _bindless.add_storage_buffer(_drawCountBuffer._buffer);
+    _cullConstants.visibilityBuffer = _bindless.add_storage_buffer(_visibilityBuffer._buffer);
+    _cullConstants.statsBuffer      = _bindless.add_storage_buffer(_cullStatsBuffer._buffer);
+    _cullConstants.pyramidSampler   = samplerSlot; // nearest, only fetched from
+    _cullConstants.phase            = 0;
 
-    vmaCreateBuffer(_allocator, const VkBufferCreateInfo *_Nonnull pBufferCreateInfo, &allocInfo, buffer, c_buffer, nullptr);
     // GlobalBuilder builder = this->global.begin_build_descriptor();
     // builder.bind_create_buffer(sizeof(GPUObject) * MAX_OBJECTS, BufferType::STORAGE, VK_SHADER_STAGE_VERTEX_BIT).update_descriptor(true).build("object");
 
@@ -20,7 +20,23 @@
 #include <vector>
 
 #include "../camera/camera.h"
+#include "../collision/character_controller.h"
+#include "../collision/voxel_world.h"
+#include "../core/ecs.h"
+#include "../core/fixed_step.h"
+#include "../core/frame_arena.h"
+#include "../core/job_system.h"
+#include "../core/transform_hierarchy.h"
+#include "../core/triple_buffer.h"
+#include "../physics/physics_world.h"
+#include "render_graph.h"
+#include "util/bindless.h"
+#include "util/deletion_queue.h"
+#include "util/depth_pyramid.h"
+#include "util/mesh_arena.h"
+#include "util/secondary_recorder.h"
 #include "util/vk_descriptors.h"
+#include "util/voxel_terrain.h"
 
 #include "vk_create.h"
 #include "vk_mesh.h"
@@ -30,6 +46,10 @@
 
 struct alignas(16) GPUObject {
     glm::mat4 transformMatrix;
+    glm::vec4 boundingSphere; // local center and radius
+    uint32_t  material;       // into the material buffer
+    uint32_t  vertexCount;    // draw the cull pass writes for the object
+    uint32_t  firstVertex;
 };
 
 struct alignas(16) GPUCamera {
@@ -52,6 +72,104 @@ struct alignas(16) GPUAlignedArrayElement {
 struct alignas(16) GPUTexture {
     GPUAlignedArrayElement faceIndices[6]; // 12-byte padding
     GPUMaterial            material;
+    uint32_t               albedoTexture  = BINDLESS_NONE; // bindless slots
+    uint32_t               normalTexture  = BINDLESS_NONE;
+    uint32_t               textureSampler = BINDLESS_NONE;
+};
+
+// pushed once per pass, bindless slots of the buffers every draw reads
+struct GPUDrawConstants {
+    uint32_t objectBuffer;
+    uint32_t materialBuffer;
+};
+
+// pushed to the voxel draws, bindless slots. materialBuffer is where GPUDrawConstants has it, so the
+// fragment shader is shared
+struct GPUVoxelConstants {
+    uint32_t sectionBuffer;
+    uint32_t materialBuffer;
+    uint32_t faceBuffer;
+};
+
+// pushed to the cull passes, bindless slots and the phase
+struct GPUCullConstants {
+    uint32_t cullData; // GPUCullData
+    uint32_t objectBuffer;
+    uint32_t drawBuffer; // VkDrawIndirectCommand per visible object, drawCapacity per phase
+    uint32_t countBuffer;
+    uint32_t visibilityBuffer;
+    uint32_t statsBuffer;
+    uint32_t pyramidTexture;
+    uint32_t pyramidSampler;
+    uint32_t phase; // 0 draws what was visible last frame, 1 tests everything against the depth pyramid
+};
+
+// written every frame for the cull passes
+struct alignas(16) GPUCullData {
+    glm::mat4 view;
+    glm::vec4 frustum[6]; // world space planes, the normals point inside
+    float     projScaleX; // unflipped projection[0][0] and projection[1][1]
+    float     projScaleY;
+    float     projDepthScale; // projection[2][2] and projection[3][2]
+    float     projDepthOffset;
+    glm::vec2 depthSize;
+    float     znear;
+    uint32_t  objectCount;
+    uint32_t  pyramidLevels;
+    uint32_t  drawCapacity;
+};
+
+// counted by the cull passes, read back once the frame's fence has signaled
+struct GPUCullStats {
+    uint32_t drawn[2]; // early and late phase
+    uint32_t frustumCulled;
+    uint32_t occlusionCulled;
+};
+
+// render -> simulation
+struct SimInput {
+    glm::vec3 moveDirection;
+    bool      jump; // space held
+    uint32_t  flyToggles;
+};
+
+/*Scene components*/
+
+// relative to the parent node of the entity
+struct Transform {
+    glm::vec3 position;
+    glm::quat orientation;
+    glm::vec3 scale;
+};
+
+// drawn with the cube mesh, one GPUObject per entity
+struct Renderable {
+    uint32_t material; // into the material buffer, a Block::Type
+};
+
+// node of _transforms, its object slot is the GPUObject of the entity
+struct SceneNode {
+    uint32_t node;
+};
+
+// Transform follows this body of _physics
+struct PhysicsBody {
+    uint32_t body;
+};
+
+struct BodyPose {
+    glm::vec3 position;
+    glm::quat orientation;
+    glm::vec3 halfExtents;
+};
+
+// simulation -> render, interpolated between the previous and the current state
+struct SimSnapshot {
+    glm::vec3             previousPlayerPosition;
+    glm::vec3             playerPosition;
+    std::vector<BodyPose> previousBodies;
+    std::vector<BodyPose> bodies;
+    double                time; // clock time playerPosition belongs to
 };
 
 struct Texture {
@@ -100,6 +218,7 @@ class VulkanEngine {
     VkDevice                 _device;
 
     VkPhysicalDeviceProperties _gpuProperties;
+    bool                       _textureCompressionBC;
 
     VkQueue  _graphicsQueue;
     uint32_t _graphicsQueueFamily;
@@ -117,11 +236,24 @@ class VulkanEngine {
     std::vector<AllocatedImage> hdrimages;
     std::vector<VkImageView>    hdrImageViews;
 
-    VmaAllocator _allocator; // vma lib allocator
-
-    // depth resources
-    VkImageView    _depthImageView;
-    AllocatedImage _depthImage;
+    VmaAllocator  _allocator;     // vma lib allocator
+    DeletionQueue _deletionQueue; // resources still used by frames in flight
+
+    // the frame, its depth image is a transient of the graph
+    RenderGraph       _renderGraph;
+    uint32_t          _graphSwapchain;
+    uint32_t          _graphDepth;
+    uint32_t          _graphDrawCommands;
+    uint32_t          _graphDrawCount;
+    uint32_t          _graphVisibility;
+    uint32_t          _graphCullStats;
+    uint32_t          _graphPyramid;
+    uint32_t          _graphPyramidCounter;
+    uint32_t          _graphVertices;
+    uint32_t          _graphIndices;
+    uint32_t          _graphVoxelFaces;
+    DepthPyramid      _depthPyramid; // of the early draws, for the late occlusion test
+    SecondaryRecorder _secondaryRecorder; // scene draws of the job workers
 
     VkImageView    colorImageView;
     AllocatedImage colorImage;
@@ -138,6 +270,22 @@ class VulkanEngine {
 
     Camera _cam;
 
+    ChunkStore            _world;
+    CharacterController   _player;
+    JobSystem             _jobs;
+    PhysicsWorld          _physics;
+    std::vector<BodyPose> _previousBodies; // poses before the last step
+    EntityWorld           _scene;
+    TransformHierarchy    _transforms;
+    uint32_t              _objectCount = 0; // object slots handed out
+
+    FixedStepLoop             _simLoop;
+    SimulationThread          _simThread;
+    TripleBuffer<SimInput>    _simInput;
+    TripleBuffer<SimSnapshot> _simOutput;
+    uint32_t                  _flyToggles        = 0;
+    uint32_t                  _appliedFlyToggles = 0;
+
     VkSampler _blockySampler;
     VkSampler hdrSampler;
 
@@ -147,6 +295,12 @@ class VulkanEngine {
     VkPipeline       pipeline;
     VkPipelineLayout pipelineLayout;
 
+    VkPipeline       _voxelPipeline;
+    VkPipelineLayout _voxelLayout;
+
+    VkPipeline       _cullPipeline;
+    VkPipelineLayout _cullLayout;
+
     VkPipeline       hdrPipeline;
     VkPipelineLayout hdrLayout;
 
@@ -165,20 +319,48 @@ class VulkanEngine {
     std::vector<FrameData>      c_frames;
     DescriptorAllocatorGrowable c_globalAllocator;
 
-    VkDescriptorSetLayout c_objectLayout;
     VkDescriptorSetLayout c_cameraLayout;
-    VkDescriptorSetLayout c_textureLayout;
-
-    VkDescriptorSet c_textureSet;
 
-    AllocatedBuffer c_buffer;
+    // textures, samplers and storage buffers of every draw, bound once per pass
+    BindlessDescriptors _bindless;
+    GPUDrawConstants    _drawConstants;
+
+    AllocatedBuffer c_buffer;        // GPUObject per renderable entity, persistently mapped
+    GPUObject      *_objectData;     // mapped c_buffer
+    AllocatedBuffer _materialBuffer; // GPUTexture per Block::Type
+
+    // written by the cull passes, read by the indirect draws
+    AllocatedBuffer  _drawCommandBuffer;
+    AllocatedBuffer  _drawCountBuffer;
+    AllocatedBuffer  _visibilityBuffer; // per object, kept from frame to frame
+    AllocatedBuffer  _cullDataBuffer;
+    AllocatedBuffer  _cullStatsBuffer;
+    GPUCullData     *_cullData;      // mapped _cullDataBuffer
+    GPUCullStats    *_cullStatsData; // mapped _cullStatsBuffer
+    GPUCullStats     _cullStats = {}; // of the last completed frame
+    GPUCullConstants _cullConstants;
+    uint32_t         _drawObjectCount = 0; // objects in the object buffer this frame
+
+    // every mesh in two buffers, the objects follow their mesh when compaction moves it
+    MeshArena                    _meshArena;
+    std::vector<MeshRangeHandle> _objectMeshes;
+    uint32_t                     _meshVersion = 0;
+
+    // the ground, its faces pulled from a storage buffer by the vertex shader
+    VoxelTerrain      _voxelTerrain;
+    GPUVoxelConstants _voxelConstants;
 
     void init();
 
     // shuts down the engine
     void cleanup();
 
-    void draw_test();
+    // camera, object transforms and cull constants of the frame, before the graph executes
+    void prepare_draws();
+    // begins rendering to the swapchain and depth and draws the scene or one cull phase of it
+    void record_scene(VkCommandBuffer cmd, VkAttachmentLoadOp loadOp, VkAttachmentStoreOp depthStoreOp, uint32_t phase);
+    // records the scene draws into secondaries and executes them into cmd
+    void draw_test(VkCommandBuffer cmd, uint32_t phase);
 
     // draw loop
     void draw();
@@ -200,10 +382,22 @@ class VulkanEngine {
     void init_imgui();
 
     void init_scene();
+    // material and cube draw of a new object
+    void init_object(uint32_t object, uint32_t material);
+    // draw range of the object from where the mesh is in the arena now
+    void set_object_mesh(uint32_t object, MeshRangeHandle mesh);
+
+    // one fixed step of the game state, runs on the simulation thread when it is enabled
+    void simulate(float dt);
+    void publish_snapshot(double stateTime);
+
+    // moves the body entities to the interpolated poses and writes the changed world transforms into the object buffer
+    uint32_t update_objects(const SimSnapshot &snapshot, float alpha);
 
     void init_descriptors();
 
     void init_hdr();
+    void init_render_graph();
 
     void create_vertex_buffer();
     /*Helper functions*/
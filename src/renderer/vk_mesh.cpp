@@ -193,6 +193,13 @@ bool Mesh::load_from_obj(const char *filename) {
         }
     }
 
+    std::vector<glm::vec3> positions(_vertices.size());
+    for (size_t i = 0; i < _vertices.size(); i++) {
+        positions[i] = _vertices[i].position;
+    }
+    _collision.build_cached(fullpath, positions);
+    _hull.build(positions);
+
     return true;
 }
 
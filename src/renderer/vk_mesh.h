@@ -7,6 +7,8 @@
 #include <unordered_map>
 #include <vector>
 
+#include "../collision/gjk.h"
+#include "../collision/mesh_bvh.h"
 #include "vk_types.h"
 
 struct VertexInputDescription {
@@ -49,6 +51,10 @@ struct Mesh {
 
     AllocatedBuffer _vertexBuffer;
 
+    // collision shape in mesh space, built from the obj triangles
+    MeshBVH    _collision;
+    ConvexHull _hull; // for distance queries against the whole model
+
     bool load_from_obj(const char *filename);
 };
 
@@ -0,0 +1,363 @@
+#include "block_compression.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+const uint32_t BLOCK_TEXELS   = 16;
+const uint32_t REFINE_PASSES  = 2; // least squares fits of the endpoints to the chosen indices
+const uint32_t POWER_ITERATIONS = 8;
+
+// weights of BC7's 4 bit indices, out of 64
+const uint32_t BC7_WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+// Mean of the points and the direction they spread the most in, from power iteration on their
+// covariance. dims is 3 or 4.
+static void fit_line(const float *points, uint32_t count, uint32_t dims, float mean[4], float axis[4]) {
+    for (uint32_t d = 0; d < dims; d++) {
+        mean[d] = 0.0f;
+        for (uint32_t i = 0; i < count; i++) {
+            mean[d] += points[i * dims + d];
+        }
+        mean[d] /= (float)count;
+    }
+
+    float covariance[4][4] = {};
+    for (uint32_t i = 0; i < count; i++) {
+        for (uint32_t a = 0; a < dims; a++) {
+            for (uint32_t b = 0; b < dims; b++) {
+                covariance[a][b] += (points[i * dims + a] - mean[a]) * (points[i * dims + b] - mean[b]);
+            }
+        }
+    }
+
+    // a start that isn't orthogonal to the answer for the usual blocks
+    for (uint32_t d = 0; d < dims; d++) {
+        axis[d] = 1.0f;
+    }
+    for (uint32_t iteration = 0; iteration < POWER_ITERATIONS; iteration++) {
+        float next[4] = {};
+        float length  = 0.0f;
+        for (uint32_t a = 0; a < dims; a++) {
+            for (uint32_t b = 0; b < dims; b++) {
+                next[a] += covariance[a][b] * axis[b];
+            }
+            length += next[a] * next[a];
+        }
+        if (length < 1e-12f) {
+            break; // all the same, any axis will do
+        }
+        length = std::sqrt(length);
+        for (uint32_t d = 0; d < dims; d++) {
+            axis[d] = next[d] / length;
+        }
+    }
+}
+
+// endpoints at the extremes of the points along the line
+static void line_endpoints(const float *points, uint32_t count, uint32_t dims, float low[4], float high[4]) {
+    float mean[4], axis[4];
+    fit_line(points, count, dims, mean, axis);
+
+    float minT = 0.0f;
+    float maxT = 0.0f;
+    for (uint32_t i = 0; i < count; i++) {
+        float t = 0.0f;
+        for (uint32_t d = 0; d < dims; d++) {
+            t += (points[i * dims + d] - mean[d]) * axis[d];
+        }
+        minT = std::min(minT, t);
+        maxT = std::max(maxT, t);
+    }
+    for (uint32_t d = 0; d < dims; d++) {
+        low[d]  = std::clamp(mean[d] + axis[d] * minT, 0.0f, 255.0f);
+        high[d] = std::clamp(mean[d] + axis[d] * maxT, 0.0f, 255.0f);
+    }
+}
+
+// Endpoints that minimize the squared error for fixed indices, where point i is
+// weights[i] * a + (1 - weights[i]) * b. False when the weights can't tell the two apart.
+static bool least_squares_endpoints(const float *points, const float *weights, uint32_t count, uint32_t dims, float a[4], float b[4]) {
+    float aa = 0.0f, ab = 0.0f, bb = 0.0f;
+    float ax[4] = {}, bx[4] = {};
+    for (uint32_t i = 0; i < count; i++) {
+        float wa = weights[i];
+        float wb = 1.0f - wa;
+        aa += wa * wa;
+        ab += wa * wb;
+        bb += wb * wb;
+        for (uint32_t d = 0; d < dims; d++) {
+            ax[d] += wa * points[i * dims + d];
+            bx[d] += wb * points[i * dims + d];
+        }
+    }
+
+    float determinant = aa * bb - ab * ab;
+    if (std::fabs(determinant) < 1e-6f) {
+        return false;
+    }
+    for (uint32_t d = 0; d < dims; d++) {
+        a[d] = std::clamp((ax[d] * bb - bx[d] * ab) / determinant, 0.0f, 255.0f);
+        b[d] = std::clamp((bx[d] * aa - ax[d] * ab) / determinant, 0.0f, 255.0f);
+    }
+    return true;
+}
+
+/*BC1*/
+
+static uint16_t to_565(const float color[3]) {
+    uint32_t r = (uint32_t)std::lround(color[0] * 31.0f / 255.0f);
+    uint32_t g = (uint32_t)std::lround(color[1] * 63.0f / 255.0f);
+    uint32_t b = (uint32_t)std::lround(color[2] * 31.0f / 255.0f);
+    return (uint16_t)(r << 11 | g << 5 | b);
+}
+
+static void from_565(uint16_t packed, float color[3]) {
+    uint32_t r = packed >> 11;
+    uint32_t g = (packed >> 5) & 63;
+    uint32_t b = packed & 31;
+    color[0]   = (float)(r << 3 | r >> 2);
+    color[1]   = (float)(g << 2 | g >> 4);
+    color[2]   = (float)(b << 3 | b >> 2);
+}
+
+struct BC1Fit {
+    uint16_t color0;
+    uint16_t color1;
+    uint32_t indices;
+    float    error;
+};
+
+// indices and error for two endpoints, ordered for the mode first
+static BC1Fit fit_bc1(const float *texels, const bool *transparent, uint16_t a, uint16_t b, bool threeColor) {
+    BC1Fit fit = {};
+    fit.color0 = threeColor ? std::min(a, b) : std::max(a, b);
+    fit.color1 = threeColor ? std::max(a, b) : std::min(a, b);
+
+    // equal endpoints read as the 3 color mode, index 0 is right for both
+    float palette[4][3];
+    from_565(fit.color0, palette[0]);
+    from_565(fit.color1, palette[1]);
+    uint32_t paletteSize = 4;
+    if (fit.color0 == fit.color1) {
+        paletteSize = 1;
+    } else if (threeColor) {
+        paletteSize = 3;
+        for (uint32_t c = 0; c < 3; c++) {
+            palette[2][c] = (palette[0][c] + palette[1][c]) / 2.0f;
+        }
+    } else {
+        for (uint32_t c = 0; c < 3; c++) {
+            palette[2][c] = (2.0f * palette[0][c] + palette[1][c]) / 3.0f;
+            palette[3][c] = (palette[0][c] + 2.0f * palette[1][c]) / 3.0f;
+        }
+    }
+
+    for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+        if (transparent[i]) {
+            fit.indices |= 3u << (2 * i);
+            continue;
+        }
+        uint32_t best      = 0;
+        float    bestError = INFINITY;
+        for (uint32_t p = 0; p < paletteSize; p++) {
+            float error = 0.0f;
+            for (uint32_t c = 0; c < 3; c++) {
+                float difference = palette[p][c] - texels[i * 3 + c];
+                error += difference * difference;
+            }
+            if (error < bestError) {
+                best      = p;
+                bestError = error;
+            }
+        }
+        fit.indices |= best << (2 * i);
+        fit.error += bestError;
+    }
+    return fit;
+}
+
+void encode_bc1(const uint8_t texels[64], uint8_t block[8]) {
+    float    colors[BLOCK_TEXELS * 3];
+    float    opaque[BLOCK_TEXELS * 3];
+    bool     transparent[BLOCK_TEXELS];
+    uint32_t opaqueCount = 0;
+    bool     threeColor  = false;
+    for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+        transparent[i] = texels[i * 4 + 3] < 128;
+        threeColor     = threeColor || transparent[i];
+        for (uint32_t c = 0; c < 3; c++) {
+            colors[i * 3 + c] = texels[i * 4 + c];
+            if (!transparent[i]) {
+                opaque[opaqueCount * 3 + c] = texels[i * 4 + c];
+            }
+        }
+        opaqueCount += transparent[i] ? 0 : 1;
+    }
+
+    BC1Fit best = {0, 0, 0xFFFFFFFF, 0.0f};
+    if (opaqueCount > 0) {
+        float low[4], high[4];
+        line_endpoints(opaque, opaqueCount, 3, low, high);
+        best = fit_bc1(colors, transparent, to_565(high), to_565(low), threeColor);
+
+        for (uint32_t pass = 0; pass < REFINE_PASSES && best.error > 0.0f; pass++) {
+            // how much of color0 each opaque texel is
+            float const weights4[4] = {1.0f, 0.0f, 2.0f / 3.0f, 1.0f / 3.0f};
+            float const weights3[4] = {1.0f, 0.0f, 0.5f, 0.0f};
+            float       weights[BLOCK_TEXELS];
+            uint32_t    count = 0;
+            for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+                if (!transparent[i]) {
+                    uint32_t index   = (best.indices >> (2 * i)) & 3;
+                    weights[count++] = threeColor ? weights3[index] : weights4[index];
+                }
+            }
+
+            float a[4], b[4];
+            if (!least_squares_endpoints(opaque, weights, count, 3, a, b)) {
+                break;
+            }
+            BC1Fit refined = fit_bc1(colors, transparent, to_565(a), to_565(b), threeColor);
+            if (refined.error >= best.error) {
+                break;
+            }
+            best = refined;
+        }
+    }
+
+    block[0] = (uint8_t)best.color0;
+    block[1] = (uint8_t)(best.color0 >> 8);
+    block[2] = (uint8_t)best.color1;
+    block[3] = (uint8_t)(best.color1 >> 8);
+    memcpy(block + 4, &best.indices, sizeof(uint32_t));
+}
+
+/*BC7*/
+
+struct BC7Fit {
+    uint8_t endpoints[2][4]; // 7 bits each
+    uint8_t pbits[2];
+    uint8_t indices[BLOCK_TEXELS];
+    float   error;
+};
+
+// the 7 bit value and p-bit closest to a color, the p-bit is the low bit of all four channels
+static void quantize_bc7(const float color[4], uint8_t endpoint[4], uint8_t &pbit) {
+    float bestError = INFINITY;
+    for (uint8_t p = 0; p < 2; p++) {
+        uint8_t quantized[4];
+        float   error = 0.0f;
+        for (uint32_t c = 0; c < 4; c++) {
+            quantized[c]     = (uint8_t)std::clamp(std::lround((color[c] - p) / 2.0f), 0l, 127l);
+            float difference = (float)(quantized[c] << 1 | p) - color[c];
+            error += difference * difference;
+        }
+        if (error < bestError) {
+            bestError = error;
+            pbit      = p;
+            memcpy(endpoint, quantized, 4);
+        }
+    }
+}
+
+static BC7Fit fit_bc7(const float *texels, const float a[4], const float b[4]) {
+    BC7Fit fit;
+    quantize_bc7(a, fit.endpoints[0], fit.pbits[0]);
+    quantize_bc7(b, fit.endpoints[1], fit.pbits[1]);
+
+    uint32_t ends[2][4];
+    for (uint32_t e = 0; e < 2; e++) {
+        for (uint32_t c = 0; c < 4; c++) {
+            ends[e][c] = fit.endpoints[e][c] << 1 | fit.pbits[e];
+        }
+    }
+    float palette[16][4];
+    for (uint32_t p = 0; p < 16; p++) {
+        for (uint32_t c = 0; c < 4; c++) {
+            palette[p][c] = (float)(((64 - BC7_WEIGHTS[p]) * ends[0][c] + BC7_WEIGHTS[p] * ends[1][c] + 32) >> 6);
+        }
+    }
+
+    fit.error = 0.0f;
+    for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+        uint8_t best      = 0;
+        float   bestError = INFINITY;
+        for (uint8_t p = 0; p < 16; p++) {
+            float error = 0.0f;
+            for (uint32_t c = 0; c < 4; c++) {
+                float difference = palette[p][c] - texels[i * 4 + c];
+                error += difference * difference;
+            }
+            if (error < bestError) {
+                best      = p;
+                bestError = error;
+            }
+        }
+        fit.indices[i] = best;
+        fit.error += bestError;
+    }
+    return fit;
+}
+
+// little endian bit stream of one block
+struct BitWriter {
+    uint8_t *bytes;
+    uint32_t position = 0;
+
+    void write(uint32_t value, uint32_t bits) {
+        for (uint32_t i = 0; i < bits; i++, position++) {
+            bytes[position / 8] |= ((value >> i) & 1) << (position % 8);
+        }
+    }
+};
+
+void encode_bc7(const uint8_t texels[64], uint8_t block[16]) {
+    float colors[BLOCK_TEXELS * 4];
+    for (uint32_t i = 0; i < BLOCK_TEXELS * 4; i++) {
+        colors[i] = texels[i];
+    }
+
+    float low[4], high[4];
+    line_endpoints(colors, BLOCK_TEXELS, 4, low, high);
+    BC7Fit best = fit_bc7(colors, low, high);
+
+    for (uint32_t pass = 0; pass < REFINE_PASSES && best.error > 0.0f; pass++) {
+        float weights[BLOCK_TEXELS];
+        for (uint32_t i = 0; i < BLOCK_TEXELS; i++) {
+            weights[i] = 1.0f - BC7_WEIGHTS[best.indices[i]] / 64.0f;
+        }
+        float a[4], b[4];
+        if (!least_squares_endpoints(colors, weights, BLOCK_TEXELS, 4, a, b)) {
+            break;
+        }
+        BC7Fit refined = fit_bc7(colors, a, b);
+        if (refined.error >= best.error) {
+            break;
+        }
+        best = refined;
+    }
+
+    // the first index is stored without its top bit, so it has to be under 8
+    if (best.indices[0] >= 8) {
+        std::swap(best.endpoints[0], best.endpoints[1]);
+        std::swap(best.pbits[0], best.pbits[1]);
+        for (uint8_t &index : best.indices) {
+            index = 15 - index;
+        }
+    }
+
+    memset(block, 0, 16);
+    BitWriter writer = {block};
+    writer.write(1 << 6, 7); // mode 6
+    for (uint32_t c = 0; c < 4; c++) {
+        writer.write(best.endpoints[0][c], 7);
+        writer.write(best.endpoints[1][c], 7);
+    }
+    writer.write(best.pbits[0], 1);
+    writer.write(best.pbits[1], 1);
+    writer.write(best.indices[0], 3);
+    for (uint32_t i = 1; i < BLOCK_TEXELS; i++) {
+        writer.write(best.indices[i], 4);
+    }
+}
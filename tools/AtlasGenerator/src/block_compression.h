@@ -0,0 +1,11 @@
+#pragma once
+
+#include <cstdint>
+
+// One 4x4 block of RGBA8 texels, row by row, in and its compressed bytes out. Endpoints are fit in
+// the space the texels are in, sRGB for the block textures, which is where the hardware interpolates.
+
+// 4 colors, or 3 and transparent black when any texel has alpha under 128
+void encode_bc1(const uint8_t texels[64], uint8_t block[8]);
+// mode 6: one RGBA line with 16 steps and a p-bit per endpoint
+void encode_bc7(const uint8_t texels[64], uint8_t block[16]);
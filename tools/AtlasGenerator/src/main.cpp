@@ -1,10 +1,14 @@
 #include <algorithm>
+#include <atomic>
+#include <bit>
 #include <cassert>
+#include <cmath>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
 #include <ostream>
 #include <string>
+#include <thread>
 #include <utility>
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -15,32 +19,174 @@
 #include <iostream>
 #include <vector>
 
+#include "block_compression.h"
+#include "block_texture.h"
+
 namespace fs = std::filesystem;
 
-bool is_image_size_valid(const std::string &imagePath, int targetWidth, int targetHeight) {
-    int width, height, channels;
-    unsigned char *image = stbi_load(imagePath.c_str(), &width, &height, &channels, 4); // 3 channels for RGB
+// Function to load an image from a file using stb_image
+std::vector<unsigned char> load_image(const std::string &filePath, int &width, int &height, int &channels) {}
+
+const uint32_t IMAGE_SIZE = 64;
+const uint32_t PIXEL_TYPE = STBI_rgb_alpha;
+
+static float srgb_to_linear(uint8_t value) {
+    float c = value / 255.0f;
+    return c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+}
+
+static uint8_t linear_to_srgb(float c) {
+    c = c <= 0.0031308f ? c * 12.92f : 1.055f * std::pow(c, 1.0f / 2.4f) - 0.055f;
+    return (uint8_t)std::lround(std::clamp(c, 0.0f, 1.0f) * 255.0f);
+}
 
-    if (!image) {
-        std::cerr << "Error loading image: " << imagePath << std::endl;
-        return false;
+// Decodes every file on all cores, each worker takes the next file until all are done. An image that
+// doesn't load or isn't IMAGE_SIZE square is null.
+static std::vector<stbi_uc *> load_images(const std::vector<std::string> &files) {
+    std::vector<stbi_uc *>   images(files.size(), nullptr);
+    std::atomic<size_t>      nextFile = 0;
+    std::vector<std::thread> workers;
+    for (uint32_t w = 0; w < std::max(std::thread::hardware_concurrency(), 1u); w++) {
+        workers.emplace_back([&]() {
+            for (size_t i = nextFile++; i < files.size(); i = nextFile++) {
+                int      width, height, channels;
+                stbi_uc *image = stbi_load(files[i].c_str(), &width, &height, &channels, PIXEL_TYPE);
+                if (image != nullptr && (width != IMAGE_SIZE || height != IMAGE_SIZE)) {
+                    stbi_image_free(image);
+                    image = nullptr;
+                }
+                images[i] = image;
+            }
+        });
     }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+    return images;
+}
 
-    bool isValid = (width == targetWidth) && (height == targetHeight);
+// 2x2 box filter in linear light, colors weighted by alpha so transparent texels don't darken the edges
+static std::vector<uint8_t> next_level(const std::vector<uint8_t> &image, uint32_t size) {
+    uint32_t             next = std::max(size / 2, 1u);
+    std::vector<uint8_t> result(next * next * PIXEL_TYPE);
+    for (uint32_t y = 0; y < next; y++) {
+        for (uint32_t x = 0; x < next; x++) {
+            float color[3] = {};
+            float alpha    = 0.0f;
+            for (uint32_t i = 0; i < 4; i++) {
+                uint32_t       sx    = std::min(x * 2 + (i & 1), size - 1);
+                uint32_t       sy    = std::min(y * 2 + (i >> 1), size - 1);
+                const uint8_t *texel = &image[(sy * size + sx) * PIXEL_TYPE];
+                float          a     = texel[3] / 255.0f;
+                for (uint32_t c = 0; c < 3; c++) {
+                    color[c] += srgb_to_linear(texel[c]) * a;
+                }
+                alpha += a;
+            }
+            uint8_t *out = &result[(y * next + x) * PIXEL_TYPE];
+            for (uint32_t c = 0; c < 3; c++) {
+                out[c] = alpha > 0.0f ? linear_to_srgb(color[c] / alpha) : 0;
+            }
+            out[3] = (uint8_t)std::lround(alpha / 4.0f * 255.0f);
+        }
+    }
+    return result;
+}
 
-    stbi_image_free(image); // Release memory allocated by stbi_load
+// one level of one layer into its blocks, row by row
+static void encode_level(const std::vector<uint8_t> &image, uint32_t levelSize, BlockFormat format, uint8_t *blocks) {
+    if (format == BlockFormat::RGBA8_SRGB) {
+        memcpy(blocks, image.data(), image.size());
+        return;
+    }
 
-    return isValid;
+    uint32_t blocksPerRow = (levelSize + 3) / 4;
+    for (uint32_t by = 0; by < blocksPerRow; by++) {
+        for (uint32_t bx = 0; bx < blocksPerRow; bx++) {
+            // levels under 4 texels repeat their edge
+            uint8_t texels[64];
+            for (uint32_t i = 0; i < 16; i++) {
+                uint32_t x = std::min(bx * 4 + i % 4, levelSize - 1);
+                uint32_t y = std::min(by * 4 + i / 4, levelSize - 1);
+                memcpy(&texels[i * 4], &image[(y * levelSize + x) * PIXEL_TYPE], 4);
+            }
+            uint8_t *block = blocks + (by * blocksPerRow + bx) * block_bytes(format);
+            if (format == BlockFormat::BC1_SRGB) {
+                encode_bc1(texels, block);
+            } else {
+                encode_bc7(texels, block);
+            }
+        }
+    }
 }
 
-// Function to load an image from a file using stb_image
-std::vector<unsigned char> load_image(const std::string &filePath, int &width, int &height, int &channels) {}
+// Cuts the atlas into its cells and cooks each with a full mip chain, in the layout of block_texture.h.
+// Every worker takes the next cell until all are done.
+static void write_block_texture(const unsigned char *atlas, int atlasWidth, int atlasHeight, BlockFormat format, const std::string &fileName) {
+    uint32_t cellsX = atlasWidth / IMAGE_SIZE;
+    uint32_t layers = cellsX * (atlasHeight / IMAGE_SIZE);
+    uint32_t levels = std::bit_width(IMAGE_SIZE);
+
+    uint64_t levelOffsets[BLOCK_TEXTURE_MAX_LEVELS];
+    uint64_t size = 0;
+    for (uint32_t level = 0; level < levels; level++) {
+        levelOffsets[level] = size;
+        size += block_level_bytes(format, IMAGE_SIZE, level, layers);
+    }
+    std::vector<uint8_t> blocks(size);
+
+    std::atomic<uint32_t>    nextLayer = 0;
+    std::vector<std::thread> workers;
+    for (uint32_t w = 0; w < std::max(std::thread::hardware_concurrency(), 1u); w++) {
+        workers.emplace_back([&]() {
+            for (uint32_t layer = nextLayer++; layer < layers; layer = nextLayer++) {
+                std::vector<uint8_t> image(IMAGE_SIZE * IMAGE_SIZE * PIXEL_TYPE);
+                uint32_t             cellX = layer % cellsX;
+                uint32_t             cellY = layer / cellsX;
+                for (uint32_t y = 0; y < IMAGE_SIZE; y++) {
+                    const unsigned char *row = atlas + ((cellY * IMAGE_SIZE + y) * atlasWidth + cellX * IMAGE_SIZE) * PIXEL_TYPE;
+                    memcpy(&image[y * IMAGE_SIZE * PIXEL_TYPE], row, IMAGE_SIZE * PIXEL_TYPE);
+                }
 
-const uint32_t IMAGE_SIZE = 64;
-const uint32_t PIXEL_TYPE = STBI_rgb_alpha;
+                for (uint32_t level = 0; level < levels; level++) {
+                    uint32_t levelSize    = block_level_size(IMAGE_SIZE, level);
+                    uint32_t blocksPerRow = block_level_blocks(format, IMAGE_SIZE, level);
+                    encode_level(image, levelSize, format, &blocks[levelOffsets[level] + (uint64_t)layer * blocksPerRow * blocksPerRow * block_bytes(format)]);
+                    image = next_level(image, levelSize);
+                }
+            }
+        });
+    }
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+
+    BlockTextureHeader header = {BLOCK_TEXTURE_MAGIC, (uint32_t)format, IMAGE_SIZE, layers, levels};
+    FILE              *file   = fopen(fileName.c_str(), "wb");
+    if (file == nullptr) {
+        printf("Failed to write %s\n", fileName.c_str());
+        return;
+    }
+    fwrite(&header, sizeof(header), 1, file);
+    fwrite(blocks.data(), 1, blocks.size(), file);
+    fclose(file);
+    printf("%s: %u layers, %u levels, %zu KB\n", fileName.c_str(), layers, levels, blocks.size() / 1024);
+}
+
+// Writes the atlas as png, cooked uncompressed next to it and, unless there is no format, block
+// compressed. The engine loads the first of them the gpu can take, none needs decoding but the png.
+static void write_atlas(const unsigned char *atlas, int atlasWidth, int atlasHeight, int atlasIndex, const BlockFormat *format) {
+    std::ostringstream atlasFileName;
+    atlasFileName << "texture_atlas_" << atlasIndex;
+    stbi_write_png((atlasFileName.str() + ".png").c_str(), atlasWidth, atlasHeight, PIXEL_TYPE, atlas, 0);
+    write_block_texture(atlas, atlasWidth, atlasHeight, BlockFormat::RGBA8_SRGB, atlasFileName.str() + ".tex");
+    if (format != nullptr) {
+        write_block_texture(atlas, atlasWidth, atlasHeight, *format, atlasFileName.str() + ".bctex");
+    }
+}
 
 // Function to create a texture atlas from images in a directory
-void create_texture_atlas(std::string directoryPath, int atlasWidth, int atlasHeight) {
+void create_texture_atlas(std::string directoryPath, int atlasWidth, int atlasHeight, const BlockFormat *format) {
     unsigned char *atlas = new unsigned char[atlasWidth * atlasHeight * PIXEL_TYPE];
     int atlasIndex = 0;
     int xBlock = 0;
@@ -66,16 +212,15 @@ void create_texture_atlas(std::string directoryPath, int atlasWidth, int atlasHe
     }
 
     std::sort(files.begin(), files.end());
-    for (const auto imagePath : files) {
-        int width, height, channels;
-
-        bool isValid = is_image_size_valid(imagePath, IMAGE_SIZE, IMAGE_SIZE);
-        if (!isValid) {
+    std::vector<stbi_uc *> images = load_images(files);
+    for (size_t i = 0; i < files.size(); i++) {
+        const std::string &imagePath = files[i];
+        stbi_uc *imageData = images[i];
+        if (imageData == nullptr) {
             printf("Invalid image format: %s\n", imagePath.c_str());
             std::remove(imagePath.c_str());
             continue;
         }
-        stbi_uc *imageData = stbi_load(imagePath.c_str(), &width, &height, &channels, 4);
 
         unsigned char *pixelData = (unsigned char *)imageData;
         uint32_t topLeftOffset = xBlock * IMAGE_SIZE * PIXEL_TYPE + yBlock * maxWidthBlocks * PIXEL_TYPE * IMAGE_SIZE * IMAGE_SIZE;
@@ -84,10 +229,9 @@ void create_texture_atlas(std::string directoryPath, int atlasWidth, int atlasHe
         for (int y = 0; y < IMAGE_SIZE; y++) {
             int offsetAtlas = topLeftOffset + y * atlasWidth * PIXEL_TYPE;
             int offset = y * IMAGE_SIZE * PIXEL_TYPE;
-            for (int x = 0; x < IMAGE_SIZE * PIXEL_TYPE; x++) {
-                atlas[offsetAtlas + x] = pixelData[x + offset];
-            }
+            memcpy(&atlas[offsetAtlas], &pixelData[offset], IMAGE_SIZE * PIXEL_TYPE);
         }
+        stbi_image_free(imageData);
 
         xBlock++;
 
@@ -97,9 +241,7 @@ void create_texture_atlas(std::string directoryPath, int atlasWidth, int atlasHe
 
             if (yBlock == maxHeightBlocks) {
 
-                std::ostringstream atlasFileName;
-                atlasFileName << "texture_atlas_" << atlasIndex++ << ".png";
-                stbi_write_png(atlasFileName.str().c_str(), atlasWidth, atlasHeight, PIXEL_TYPE, atlas, 0);
+                write_atlas(atlas, atlasWidth, atlasHeight, atlasIndex++, format);
                 has_started = false;
                 // Reset the buffer
                 for (int i = 0; i < atlasWidth * atlasHeight * PIXEL_TYPE; i++) {
@@ -130,13 +272,17 @@ void create_texture_atlas(std::string directoryPath, int atlasWidth, int atlasHe
         //     }
         // }
 
-        std::ostringstream atlasFileName;
-        atlasFileName << "texture_atlas_" << atlasIndex++ << ".png";
-        stbi_write_png(atlasFileName.str().c_str(), atlasWidth, atlasHeight, PIXEL_TYPE, atlas, 0);
+        write_atlas(atlas, atlasWidth, atlasHeight, atlasIndex++, format);
     }
 }
 
 int main(int argc, char **argv) {
+    // block compression of the atlas next to the png: bc7 (default), bc1 or none
+    std::string formatName = argc > 3 ? std::string(argv[3]) : "bc7";
+    if (argc < 3 || argc > 4 || (formatName != "bc7" && formatName != "bc1" && formatName != "none")) {
+        fprintf(stderr, "usage: %s <directory> <atlasSize> [bc7|bc1|none]\n", argv[0]);
+        return 1;
+    }
 
     std::string directoryPath = std::string(argv[1]);
 
@@ -146,8 +292,10 @@ int main(int argc, char **argv) {
     int atlasWidth = std::stoi(argv[2]);
     int atlasHeight = std::stoi(argv[2]);
 
+    BlockFormat format = formatName == "bc1" ? BlockFormat::BC1_SRGB : BlockFormat::BC7_SRGB;
+
     // Create the texture atlas
-    create_texture_atlas(directoryPath, atlasWidth, atlasHeight);
+    create_texture_atlas(directoryPath, atlasWidth, atlasHeight, formatName == "none" ? nullptr : &format);
 
     std::cout << "Texture atlas created successfully." << std::endl;
 